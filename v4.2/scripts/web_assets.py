@@ -0,0 +1,52 @@
+# 构建前把 data/web_interface.html 精简、压缩后生成 include/web_ui_gz.h
+# 网页作为常量数组链接进固件（rodata），handleRoot 直接从 flash 发送，不需要挂载文件系统
+# ETag 为压缩内容的哈希；只在源文件比头文件新时重新生成，内容不变时输出逐字节相同
+
+import gzip
+import hashlib
+import os
+import re
+
+Import("env")
+
+WEB_SOURCE = "web_interface.html"
+HEADER_NAME = "web_ui_gz.h"
+
+
+def minify_html(text):
+    # 保守精简：去掉 HTML 注释、行首尾空白和空行；保留换行，脚本的自动分号插入不受影响
+    text = re.sub(r"<!--(?!\[).*?-->", "", text, flags=re.S)
+    lines = (line.strip() for line in text.splitlines())
+    return "\n".join(line for line in lines if line) + "\n"
+
+
+def write_header(target, packed):
+    etag = hashlib.sha256(packed).hexdigest()[:16]
+    with open(target, "w", newline="\n") as f:
+        f.write("// 由 scripts/web_assets.py 从 data/%s 生成，不要手工修改\n" % WEB_SOURCE)
+        f.write("#ifndef WEB_UI_GZ_H\n#define WEB_UI_GZ_H\n\n")
+        f.write("#include <Arduino.h>\n\n")
+        f.write('#define WEB_UI_GZ_ETAG "\\"%s\\""\n' % etag)
+        f.write("#define WEB_UI_GZ_LENGTH %d\n\n" % len(packed))
+        f.write("static const uint8_t WEB_UI_GZ[WEB_UI_GZ_LENGTH] PROGMEM = {\n")
+        for i in range(0, len(packed), 16):
+            f.write("    " + ", ".join("0x%02x" % b for b in packed[i:i + 16]) + ",\n")
+        f.write("};\n\n#endif // WEB_UI_GZ_H\n")
+    return etag
+
+
+def build_web_ui(data_dir, include_dir):
+    source = os.path.join(data_dir, WEB_SOURCE)
+    target = os.path.join(include_dir, HEADER_NAME)
+    if os.path.exists(target) and os.path.getmtime(target) >= os.path.getmtime(source):
+        return
+    with open(source, "r", encoding="utf-8") as f:
+        raw = f.read()
+    minified = minify_html(raw).encode("utf-8")
+    packed = gzip.compress(minified, compresslevel=9, mtime=0)
+    etag = write_header(target, packed)
+    print("[web_assets] %s: %d -> %d -> %d bytes, ETag %s" %
+          (WEB_SOURCE, len(raw.encode("utf-8")), len(minified), len(packed), etag))
+
+
+build_web_ui(env.subst("$PROJECT_DATA_DIR"), env.subst("$PROJECT_INCLUDE_DIR"))
@@ -0,0 +1,221 @@
+#include "capture_replay.h"
+#include <fstream>
+#include "i2c_communicator.h"
+
+// /custom_command 接受的十六进制字符上限（web_server.cpp）
+#define CUSTOM_COMMAND_MAX_BYTES 25
+
+static uint32_t getLE32(const uint8_t* in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+static std::string toHex(const std::vector<uint8_t>& bytes) {
+    std::string hex;
+    char byte[4];
+    for (size_t i = 0; i < bytes.size(); i++) {
+        snprintf(byte, sizeof(byte), i ? " %02X" : "%02X", bytes[i]);
+        hex += byte;
+    }
+    return hex;
+}
+
+static const char* kindName(uint8_t kind) {
+    switch (kind) {
+        case CAPTURE_WRITE:   return "write";
+        case CAPTURE_READ:    return "read";
+        case CAPTURE_COM_REQ: return "comreq";
+        default:              return "?";
+    }
+}
+
+static const char* replySourceName(uint8_t source) {
+    switch (source) {
+        case REPLY_NONE:    return "notify";
+        case REPLY_IRQ:     return "irq";
+        case REPLY_POLL:    return "poll";
+        case REPLY_TIMEOUT: return "timeout";
+        default:            return "?";
+    }
+}
+
+bool loadCapture(const char* path, CaptureDump& dump) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        fprintf(stderr, "Cannot open capture: %s\n", path);
+        return false;
+    }
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (bytes.size() < CAPTURE_HEADER_SIZE || memcmp(bytes.data(), CAPTURE_MAGIC, 4) != 0) {
+        fprintf(stderr, "%s is not an I2C capture\n", path);
+        return false;
+    }
+    if (bytes[4] != CAPTURE_VERSION) {
+        fprintf(stderr, "Unsupported capture version %d\n", bytes[4]);
+        return false;
+    }
+    
+    uint16_t count = bytes[6] | (bytes[7] << 8);
+    dump.overwritten = getLE32(&bytes[8]);
+    dump.dumpedAtUs = getLE32(&bytes[12]);
+    dump.records.clear();
+    size_t pos = bytes[5];
+    for (uint16_t i = 0; i < count; i++) {
+        if (pos + CAPTURE_RECORD_HEADER > bytes.size() ||
+            pos + CAPTURE_RECORD_HEADER + bytes[pos + 7] > bytes.size()) {
+            fprintf(stderr, "Capture truncated at record %u\n", i);
+            return false;
+        }
+        CaptureRecord record;
+        record.timeUs = getLE32(&bytes[pos]);
+        record.kind = bytes[pos + 4] & 0x0F;
+        record.module = bytes[pos + 4] >> 4;
+        record.address = bytes[pos + 5];
+        record.status = bytes[pos + 6];
+        const uint8_t* data = &bytes[pos + CAPTURE_RECORD_HEADER];
+        record.data.assign(data, data + bytes[pos + 7]);
+        pos += CAPTURE_RECORD_HEADER + bytes[pos + 7];
+        dump.records.push_back(record);
+    }
+    return true;
+}
+
+bool saveCapture(const char* path, BusCapture& capture) {
+    static uint8_t buffer[CAPTURE_DUMP_MAX];
+    size_t length = capture.dump(buffer);
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        fprintf(stderr, "Cannot write capture: %s\n", path);
+        return false;
+    }
+    file.write((const char*)buffer, length);
+    return (bool)file;
+}
+
+void printCapture(const CaptureDump& dump) {
+    printf("%zu records, %u overwritten before the dump\n", dump.records.size(), dump.overwritten);
+    if (dump.records.empty()) return;
+    
+    uint32_t base = dump.records.front().timeUs;
+    for (const CaptureRecord& r : dump.records) {
+        printf("%10.3f ms  #%u 0x%02X  %-6s ", (uint32_t)(r.timeUs - base) / 1000.0,
+               r.module, r.address, kindName(r.kind));
+        switch (r.kind) {
+            case CAPTURE_WRITE:
+                printf("%-9s %s\n", r.status ? ("err " + std::to_string(r.status)).c_str() : "ok",
+                       toHex(r.data).c_str());
+                break;
+            case CAPTURE_READ:
+                printf("%2zu/%-6u %s\n", r.data.size(), r.status, toHex(r.data).c_str());
+                break;
+            default:
+                printf("%s\n", replySourceName(r.status));
+                break;
+        }
+    }
+}
+
+void printCurlReplay(const CaptureDump& dump, const std::string& baseUrl) {
+    // 只能重放写入：应答和 Notify 由设备上的固件照常读取
+    printf("#!/bin/sh\n");
+    printf("# %zu records; reads and COM_REQ waits are handled by the device firmware\n", dump.records.size());
+    uint32_t last = 0;
+    bool first = true;
+    for (const CaptureRecord& r : dump.records) {
+        if (r.kind != CAPTURE_WRITE || r.data.empty()) continue;
+        if (r.data.size() > CUSTOM_COMMAND_MAX_BYTES) {
+            printf("# skipped 0x%02X: %zu bytes exceed /custom_command\n", r.data[0], r.data.size());
+            continue;
+        }
+        if (!first && r.timeUs - last >= 1000) {
+            printf("sleep %.3f\n", (r.timeUs - last) / 1e6);
+        }
+        first = false;
+        last = r.timeUs;
+        
+        std::string hex;
+        char byte[3];
+        for (uint8_t b : r.data) {
+            snprintf(byte, sizeof(byte), "%02X", b);
+            hex += byte;
+        }
+        printf("curl -s '%s/custom_command?cmd=%s%s'\n", baseUrl.c_str(), hex.c_str(),
+               r.module ? ("&id=" + std::to_string(r.module)).c_str() : "");
+    }
+}
+
+// 等待 COM_REQ 拉高；返回等待的微秒数，超时返回 -1
+static long waitComReq(uint8_t pin, uint32_t timeoutMs) {
+    unsigned long start = micros();
+    while (digitalRead(pin) != HIGH) {
+        if (micros() - start >= timeoutMs * 1000UL) return -1;
+        delayMicroseconds(20);
+    }
+    return (long)(micros() - start);
+}
+
+uint32_t replayCapture(const CaptureDump& dump, TwoWire& wire, const ReplayOptions& options) {
+    uint32_t writes = 0, reads = 0, waits = 0;
+    uint32_t mismatches = 0, dataDiffs = 0, missingNotifies = 0;
+    bool skipReads = false;      // 未重现的主动 Notify 之后的读取
+    unsigned long replayStart = micros();
+    uint32_t base = dump.records.empty() ? 0 : dump.records.front().timeUs;
+    
+    for (size_t i = 0; i < dump.records.size(); i++) {
+        const CaptureRecord& r = dump.records[i];
+        if (options.realtime) {
+            uint32_t offset = r.timeUs - base;
+            while (micros() - replayStart < offset) delayMicroseconds(50);
+        }
+        
+        if (r.kind != CAPTURE_READ) skipReads = false;
+        
+        if (r.kind == CAPTURE_WRITE) {
+            writes++;
+            wire.beginTransmission(r.address);
+            wire.write(r.data.data(), r.data.size());
+            uint8_t error = wire.endTransmission();
+            if (error != r.status) {
+                mismatches++;
+                printf("#%zu write %s: error %d, captured %d\n", i, toHex(r.data).c_str(), error, r.status);
+            }
+        } else if (r.kind == CAPTURE_COM_REQ) {
+            waits++;
+            // 捕获时已超时的等待不再重复
+            if (r.status == REPLY_TIMEOUT) continue;
+            long us = waitComReq(options.comReqPin, COM_REQ_REPLY_TIMEOUT_MS);
+            if (us < 0 && r.status == REPLY_NONE) {
+                // 温度告警等主动 Notify 不由主机的写入引起，回放时不会出现
+                missingNotifies++;
+                skipReads = true;
+            } else if (us < 0) {
+                mismatches++;
+                printf("#%zu COM_REQ did not rise (captured %s)\n", i, replySourceName(r.status));
+            }
+        } else if (r.kind == CAPTURE_READ && !skipReads) {
+            reads++;
+            std::vector<uint8_t> got;
+            wire.requestFrom(r.address, r.status);
+            while (wire.available()) got.push_back(wire.read());
+            // 帧头（CMD/SIZE/RESULT）必须一致，数据部分（运行时间、温度等）允许不同
+            size_t header = std::min<size_t>(3, r.data.size());
+            bool headerMatches = got.size() == r.data.size() &&
+                                 std::equal(r.data.begin(), r.data.begin() + header, got.begin());
+            if (!headerMatches) {
+                mismatches++;
+                printf("#%zu read: got %s, captured %s\n", i, toHex(got).c_str(), toHex(r.data).c_str());
+            } else if (got != r.data) {
+                dataDiffs++;
+                if (options.strictData) {
+                    mismatches++;
+                    printf("#%zu read data: got %s, captured %s\n", i, toHex(got).c_str(), toHex(r.data).c_str());
+                }
+            }
+        }
+    }
+    
+    printf("Replayed %zu records in %.1f ms: %u writes, %u reads, %u COM_REQ waits\n",
+           dump.records.size(), (micros() - replayStart) / 1000.0, writes, reads, waits);
+    printf("%u mismatches, %u reads with different data, %u module notifies not reproduced\n",
+           mismatches, dataDiffs, missingNotifies);
+    return mismatches;
+}
@@ -0,0 +1,49 @@
+#ifndef CAPTURE_REPLAY_H
+#define CAPTURE_REPLAY_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <string>
+#include <vector>
+#include "bus_capture.h"
+
+// 解码后的一条捕获记录
+struct CaptureRecord {
+    uint32_t timeUs;
+    uint8_t kind;                // CaptureKind
+    uint8_t module;
+    uint8_t address;
+    uint8_t status;
+    std::vector<uint8_t> data;
+};
+
+// 解码后的 /i2c_capture 导出
+struct CaptureDump {
+    uint32_t overwritten;        // 导出前被覆盖的记录数
+    uint32_t dumpedAtUs;
+    std::vector<CaptureRecord> records;
+};
+
+// 回放选项
+struct ReplayOptions {
+    bool realtime;               // 按记录的时间间隔回放（否则只等待 COM_REQ）
+    bool strictData;             // 应答数据不同也算失败（默认只比较 CMD/SIZE/RESULT）
+    uint8_t comReqPin;
+};
+
+// 读取导出文件；格式错误时打印原因并返回 false
+bool loadCapture(const char* path, CaptureDump& dump);
+
+// 把 BusCapture 的内容写入导出文件（与 /i2c_capture 相同）
+bool saveCapture(const char* path, BusCapture& capture);
+
+// 以文本形式逐条打印
+void printCapture(const CaptureDump& dump);
+
+// 打印在真实设备上回放写入的 curl 脚本（经 /custom_command，baseUrl 如 http://192.168.4.1）
+void printCurlReplay(const CaptureDump& dump, const std::string& baseUrl);
+
+// 在 wire 上按顺序重放写入、等待 COM_REQ 并比较读取结果；返回不一致的记录数
+uint32_t replayCapture(const CaptureDump& dump, TwoWire& wire, const ReplayOptions& options);
+
+#endif // CAPTURE_REPLAY_H
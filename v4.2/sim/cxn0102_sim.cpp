@@ -0,0 +1,629 @@
+#include "cxn0102_sim.h"
+#include "config.h"
+#include <chrono>
+
+// 状态位与 cxn0102_protocol.h 的 CxnState 相同；状态限制按 test/help.txt 独立建表，
+// 不复用固件的 cxnAllowedStates，以便发现固件一侧的表格错误
+enum SimState : uint8_t {
+    ST_READY   = 1 << 0,
+    ST_ACTIVE  = 1 << 1,
+    ST_OPTICAL = 1 << 2,
+    ST_BIPHASE = 1 << 3,
+    ST_RA      = ST_READY | ST_ACTIVE
+};
+
+// OP0 取 help.txt 的值；alternate 为固件实际使用的另一种长度（0x35/0x39 带保存标志，
+// 0x47/0x49 为 U/V 两个分量），-1 表示没有
+// op0 为 -1 的是厂商命令：固定 2 字节，第二个字节是参数而不是 OP0
+struct SimCommand {
+    uint8_t cmd;
+    int8_t op0;
+    int8_t alternate;
+    uint8_t states;
+};
+
+static const SimCommand COMMANDS[] = {
+    {0x01, 0x00, -1, ST_READY},     // Start Input
+    {0x02, 0x00, -1, ST_ACTIVE},    // Stop Input
+    {0x03, 0x01, -1, ST_RA},        // Mute
+    {0x07, 0x05, -1, ST_RA},        // Save All
+    {0x08, 0x00, -1, ST_READY},     // Factory Reset
+    {0x0B, 0x01, -1, ST_RA},        // Shutdown / Reboot
+    {0x0C, 0x01, -1, ST_ACTIVE},    // Stop Input With Picture
+    {0x25, 0x00, -1, ST_RA},
+    {0x26, 0x09, -1, ST_RA},
+    {0x27, 0x00, -1, ST_RA},
+    {0x28, 0x0D, -1, ST_RA},
+    {0x29, 0x00, -1, ST_RA},
+    {0x2A, 0x04, -1, ST_RA},
+    {0x32, 0x00, -1, ST_READY},
+    {0x33, 0x00, -1, ST_OPTICAL},
+    {0x34, 0x00, -1, ST_OPTICAL},
+    {0x35, 0x00, 0x01, ST_OPTICAL},
+    {0x36, 0x00, -1, ST_READY},
+    {0x37, 0x00, -1, ST_BIPHASE},
+    {0x38, 0x00, -1, ST_BIPHASE},
+    {0x39, 0x00, 0x01, ST_BIPHASE},
+    {0x40, 0x00, -1, ST_RA},
+    {0x41, 0x0A, -1, ST_RA},
+    {0x42, 0x00, -1, ST_RA},
+    {0x43, 0x01, -1, ST_ACTIVE},
+    {0x44, 0x00, -1, ST_RA},
+    {0x45, 0x01, -1, ST_ACTIVE},
+    {0x46, 0x00, -1, ST_RA},
+    {0x47, 0x01, 0x02, ST_ACTIVE},
+    {0x48, 0x00, -1, ST_RA},
+    {0x49, 0x01, 0x02, ST_ACTIVE},
+    {0x4E, 0x00, -1, ST_RA},
+    {0x4F, 0x01, -1, ST_ACTIVE},
+    {0x82, 0x08, -1, ST_RA},        // 以下四个命令的 OP0 只覆盖帧头，数据紧随其后
+    {0x84, 0x08, -1, ST_RA},
+    {0x92, 0x00, -1, ST_RA},
+    {0x94, 0x00, -1, ST_RA},
+    {0x9F, 0x04, -1, ST_RA},
+    {0x60, -1, -1, ST_RA},          // Mute / Unmute（厂商命令，0x00 静音）
+    {0xA0, 0x00, -1, ST_RA},
+    {0xA1, 0x00, -1, ST_RA},
+    {0xA2, 0x00, -1, ST_RA},
+    {0xA3, 0x11, -1, ST_READY},
+    {0xB2, 0x00, -1, ST_RA},
+    {0xB4, 0x00, -1, ST_RA},
+};
+
+static const SimCommand* findCommand(uint8_t cmd) {
+    for (const SimCommand& command : COMMANDS) {
+        if (command.cmd == cmd) return &command;
+    }
+    return nullptr;
+}
+
+static bool carriesData(uint8_t cmd) {
+    return cmd == 0x82 || cmd == 0x84 || cmd == 0x9F;
+}
+
+static uint32_t bigEndian32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static const uint32_t EVENT_SPIN_US = 200;   // 事件到期前最后一段改为忙等，减少调度误差
+static const uint32_t COM_REQ_GAP_US = 20;   // 连续两帧之间 COM_REQ 的低电平时间
+static const uint8_t ADJUST_LIMIT = 16;      // 简单调整的步进范围 ±ADJUST_LIMIT
+
+SimConfig SimConfig::defaults() {
+    SimConfig config = {};
+    config.address = I2C_ADDRESS;
+    config.comReqPin = COM_REQ_PIN;
+    config.sdaPin = SDA_PIN;
+    config.sclPin = SCL_PIN;
+    config.turnaroundUs = 800;
+    config.blockTurnaroundUs = 3000;
+    config.lateComReqUs = (COM_REQ_REPLY_TIMEOUT_MS + 10) * 1000;
+    config.bootMs = 200;
+    config.maxClockHz = 0;
+    config.stuckPulses = 3;
+    config.splitReads = true;
+    config.acceptPQAll = true;
+    config.seed = 1;
+    return config;
+}
+
+Cxn0102Sim::Cxn0102Sim(const SimConfig& config)
+    : config(config), wire(nullptr), running(false), rng(config.seed),
+      state(0), bootCount(0), active(), saved(), mute(0), testPattern(0), adjustStep(0),
+      updateTarget(0), runtimeBase(3600 * 1234), nextFrameId(1), readPos(0),
+      frontTouched(false), comReqHigh(false), sdaStuck(false), stuckPulses(0), counters() {
+    factoryDefaults();
+}
+
+Cxn0102Sim::~Cxn0102Sim() {
+    {
+        std::lock_guard<std::recursive_mutex> guard(mutex);
+        running = false;
+        eventsChanged.notify_all();
+    }
+    if (eventThread.joinable()) eventThread.join();
+    if (wire) wire->detachSlave(config.address);
+    sim::setPinObserver(nullptr, nullptr);
+}
+
+void Cxn0102Sim::begin(TwoWire& bus) {
+    wire = &bus;
+    sim::driveLevel(config.comReqPin, LOW);
+    sim::setPinObserver(onPinChange, this);
+    bus.attachSlave(config.address, this);
+    
+    running = true;
+    eventThread = std::thread(&Cxn0102Sim::eventLoop, this);
+    std::lock_guard<std::recursive_mutex> guard(mutex);
+    uint32_t expected = bootCount;
+    schedule(config.bootMs * 1000, [this, expected]() {
+        if (bootCount == expected) boot();
+    });
+}
+
+void Cxn0102Sim::factoryDefaults() {
+    memset(&active, 0, sizeof(active));
+    active.geometry[3] = 0x64;            // OP4 固定为 0x64
+    memset(active.pq, 0, sizeof(active.pq));
+    saved = active;
+    mute = 0;
+}
+
+uint8_t Cxn0102Sim::getState() {
+    std::lock_guard<std::recursive_mutex> guard(mutex);
+    return state;
+}
+
+size_t Cxn0102Sim::pendingFrames() {
+    std::lock_guard<std::recursive_mutex> guard(mutex);
+    return outbox.size();
+}
+
+SimCounters Cxn0102Sim::getCounters() {
+    std::lock_guard<std::recursive_mutex> guard(mutex);
+    return counters;
+}
+
+bool Cxn0102Sim::chance(double probability) {
+    if (probability <= 0) return false;
+    return std::uniform_real_distribution<double>(0.0, 1.0)(rng) < probability;
+}
+
+// ---- 事件线程 ----
+
+void Cxn0102Sim::schedule(uint32_t delayUs, std::function<void()> fn) {
+    std::lock_guard<std::recursive_mutex> guard(mutex);
+    events.emplace(micros() + delayUs, std::move(fn));
+    eventsChanged.notify_all();
+}
+
+void Cxn0102Sim::eventLoop() {
+    std::unique_lock<std::recursive_mutex> guard(mutex);
+    while (running) {
+        if (events.empty()) {
+            eventsChanged.wait(guard);
+            continue;
+        }
+        unsigned long due = events.begin()->first;
+        unsigned long now = micros();
+        if (due > now + EVENT_SPIN_US) {
+            eventsChanged.wait_for(guard, std::chrono::microseconds(due - now - EVENT_SPIN_US));
+            continue;
+        }
+        if (due > now) {
+            guard.unlock();
+            sim::spinMicros(due - now);
+            guard.lock();
+            continue;
+        }
+        std::function<void()> fn = std::move(events.begin()->second);
+        events.erase(events.begin());
+        fn();
+    }
+}
+
+void Cxn0102Sim::onPinChange(uint8_t pin, uint8_t level, void* ctx) {
+    Cxn0102Sim* self = static_cast<Cxn0102Sim*>(ctx);
+    if (pin != self->config.sclPin || level != HIGH) return;
+    
+    std::lock_guard<std::recursive_mutex> guard(self->mutex);
+    if (!self->sdaStuck) return;
+    // 卡在读周期的从机每个 SCL 脉冲送出一位，送完当前字节后释放 SDA
+    self->counters.sclPulses++;
+    if (++self->stuckPulses >= self->config.stuckPulses) {
+        self->sdaStuck = false;
+        sim::driveLevel(self->config.sdaPin, HIGH);
+    }
+}
+
+// ---- 总线访问 ----
+
+uint8_t Cxn0102Sim::onWrite(const uint8_t* data, size_t length, uint32_t clockHz) {
+    std::lock_guard<std::recursive_mutex> guard(mutex);
+    // 关机或重启中的模块不应答
+    if (!state) return 2;
+    
+    if (config.maxClockHz && clockHz > config.maxClockHz && chance(0.5)) {
+        counters.busErrors++;
+        return 4;
+    }
+    if (chance(config.faults.nack)) {
+        counters.nacks++;
+        return 2;
+    }
+    if (chance(config.faults.busError)) {
+        counters.busErrors++;
+        return 4;
+    }
+    if (chance(config.faults.stuckSda)) {
+        counters.stuckSda++;
+        sdaStuck = true;
+        stuckPulses = 0;
+        sim::driveLevel(config.sdaPin, LOW);
+        return 4;
+    }
+    
+    discardStale();
+    counters.writes++;
+    if (frameValid(data, length)) {
+        execute(data, length);
+    }
+    return 0;
+}
+
+size_t Cxn0102Sim::onRead(uint8_t* out, size_t length, uint32_t clockHz) {
+    (void)clockHz;
+    std::lock_guard<std::recursive_mutex> guard(mutex);
+    if (!state) return 0;
+    counters.reads++;
+    
+    size_t n = length;
+    if (n && chance(config.faults.shortRead)) {
+        counters.shortReads++;
+        n = rng() % n;
+    }
+    
+    if (outbox.empty()) {
+        memset(out, 0x00, n);
+        return n;
+    }
+    
+    // 不支持分段读取时每次都从帧头开始
+    const std::vector<uint8_t>& frame = outbox.front().bytes;
+    size_t start = config.splitReads ? readPos : 0;
+    size_t available = frame.size() - start;
+    size_t copied = n < available ? n : available;
+    memcpy(out, frame.data() + start, copied);
+    memset(out + copied, 0x00, n - copied);
+    
+    frontTouched = true;
+    if (start + copied >= frame.size()) {
+        consumeFront();
+    } else if (config.splitReads) {
+        readPos = start + copied;
+    }
+    return n;
+}
+
+void Cxn0102Sim::injectNotify(const uint8_t* frame, uint8_t length, uint32_t delayUs) {
+    std::vector<uint8_t> bytes(frame, frame + length);
+    std::lock_guard<std::recursive_mutex> guard(mutex);
+    uint32_t expected = bootCount;
+    schedule(delayUs, [this, bytes, expected]() {
+        if (bootCount != expected || !state) return;
+        counters.notifies++;
+        queueFrame(bytes, false);
+    });
+}
+
+// ---- COM_REQ 与待读帧 ----
+
+void Cxn0102Sim::setComReq(bool high) {
+    if (comReqHigh == high) return;
+    comReqHigh = high;
+    sim::driveLevel(config.comReqPin, high ? HIGH : LOW);
+}
+
+void Cxn0102Sim::raiseFor(uint32_t id) {
+    if (!outbox.empty() && outbox.front().id == id) setComReq(true);
+}
+
+void Cxn0102Sim::armFront(uint32_t delayUs) {
+    if (outbox.empty()) return;
+    // lateComReq 故障：推迟到固件的等待上限之后才拉高
+    uint32_t id = outbox.front().id;
+    if (chance(config.faults.lateComReq)) {
+        counters.lateComReqs++;
+        delayUs = config.lateComReqUs;
+    }
+    if (delayUs) {
+        schedule(delayUs, [this, id]() { raiseFor(id); });
+    } else {
+        raiseFor(id);
+    }
+}
+
+void Cxn0102Sim::queueFrame(const std::vector<uint8_t>& bytes, bool isReply) {
+    Frame frame = {nextFrameId++, isReply, bytes};
+    outbox.push_back(frame);
+    if (outbox.size() == 1) armFront(0);
+}
+
+void Cxn0102Sim::consumeFront() {
+    outbox.pop_front();
+    readPos = 0;
+    frontTouched = false;
+    setComReq(false);
+    // 下一帧在短暂的低电平后重新拉高，保证固件能看到新的上升沿
+    armFront(COM_REQ_GAP_US);
+}
+
+void Cxn0102Sim::discardStale() {
+    if (outbox.empty()) return;
+    
+    // 新的请求开始：读过一部分的队首帧和之前请求未读的应答不再有效
+    uint32_t frontId = outbox.front().id;
+    if (frontTouched) {
+        outbox.pop_front();
+        counters.discarded++;
+    }
+    for (auto it = outbox.begin(); it != outbox.end();) {
+        if (it->reply) {
+            it = outbox.erase(it);
+            counters.discarded++;
+        } else {
+            ++it;
+        }
+    }
+    if (outbox.empty() || outbox.front().id != frontId) {
+        readPos = 0;
+        frontTouched = false;
+        setComReq(false);
+        armFront(COM_REQ_GAP_US);
+    }
+}
+
+void Cxn0102Sim::reply(const uint8_t* frame, uint8_t length, uint32_t delayUs) {
+    std::vector<uint8_t> bytes(frame, frame + length);
+    uint32_t expected = bootCount;
+    schedule(delayUs, [this, bytes, expected]() {
+        if (bootCount != expected || !state) return;
+        counters.replies++;
+        queueFrame(bytes, true);
+    });
+}
+
+void Cxn0102Sim::commandError(uint8_t cmd, uint8_t result) {
+    uint8_t frame[] = {0x12, 0x04, result, cmd, state, 0x00};
+    std::vector<uint8_t> bytes(frame, frame + sizeof(frame));
+    counters.notifies++;
+    queueFrame(bytes, false);
+}
+
+// ---- 命令 ----
+
+bool Cxn0102Sim::frameValid(const uint8_t* data, size_t length) {
+    uint8_t cmd = length ? data[0] : 0x00;
+    if (length < 2) {
+        counters.formatErrors++;
+        commandError(cmd, SIM_ERROR_FORMAT);
+        return false;
+    }
+    
+    const SimCommand* command = findCommand(cmd);
+    if (!command || (cmd == 0x41 && !config.acceptPQAll)) {
+        counters.unknownCommands++;
+        commandError(cmd, SIM_ERROR_UNKNOWN);
+        return false;
+    }
+    
+    uint8_t op0 = data[1];
+    bool sizeOk = op0 == command->op0 || op0 == command->alternate;
+    if (command->op0 < 0) {
+        sizeOk = length == 2;
+    } else if (carriesData(cmd)) {
+        sizeOk = sizeOk && length >= 2u + op0 && bigEndian32(data + 2) == length - 10;
+    } else {
+        sizeOk = sizeOk && length == 2u + op0;
+    }
+    if (!sizeOk) {
+        counters.formatErrors++;
+        commandError(cmd, SIM_ERROR_FORMAT);
+        return false;
+    }
+    
+    if (!(command->states & state) || (cmd == 0x9F && !updateTarget)) {
+        counters.stateErrors++;
+        commandError(cmd, SIM_ERROR_STATE);
+        return false;
+    }
+    return true;
+}
+
+void Cxn0102Sim::execute(const uint8_t* data, size_t length) {
+    uint8_t cmd = data[0];
+    const uint8_t* op = data + 2;
+    uint8_t frame[32];
+    
+    switch (cmd) {
+        case 0x01: state = ST_ACTIVE; break;
+        case 0x02: state = ST_READY; break;
+        case 0x0C: state = ST_READY; break;
+        case 0x03: mute = op[0]; break;
+        case 0x60: mute = data[1] == 0x00; break;
+        
+        case 0x07:
+            // OP3 输出位置，OP4 光轴/双相位，OP5 画质
+            if (op[2] == 0x01) memcpy(saved.geometry, active.geometry, sizeof(saved.geometry));
+            if (op[2] == 0x02) saved.geometry[2] = active.geometry[2];
+            if (op[3] == 0x01 || op[3] == 0x02) memcpy(saved.optical, active.optical, sizeof(saved.optical));
+            if (op[3] == 0x01 || op[3] == 0x03) memcpy(saved.biPhase, active.biPhase, sizeof(saved.biPhase));
+            if (op[4] == 0x01) memcpy(saved.pq, active.pq, sizeof(saved.pq));
+            break;
+        
+        case 0x08: factoryDefaults(); break;
+        
+        case 0x0B:
+            if (op[0] == 0x01) {
+                reboot();
+            } else {
+                // 关机后不再应答，直到模拟器重新启动
+                state = 0;
+                bootCount++;
+                outbox.clear();
+                readPos = 0;
+                setComReq(false);
+            }
+            break;
+        
+        case 0x25:
+            frame[0] = 0x25;
+            frame[1] = 1 + sizeof(active.geometry);
+            frame[2] = 0x00;
+            memcpy(frame + 3, active.geometry, sizeof(active.geometry));
+            reply(frame, 3 + sizeof(active.geometry), config.turnaroundUs);
+            break;
+        case 0x26: memcpy(active.geometry, op, sizeof(active.geometry)); break;
+        
+        case 0x27:
+            frame[0] = 0x27;
+            frame[1] = 1 + sizeof(active.optical);
+            frame[2] = 0x00;
+            memcpy(frame + 3, active.optical, sizeof(active.optical));
+            reply(frame, 3 + sizeof(active.optical), config.turnaroundUs);
+            break;
+        case 0x28: memcpy(active.optical, op, sizeof(active.optical)); break;
+        
+        case 0x29:
+            frame[0] = 0x29;
+            frame[1] = 1 + sizeof(active.biPhase);
+            frame[2] = 0x00;
+            memcpy(frame + 3, active.biPhase, sizeof(active.biPhase));
+            reply(frame, 3 + sizeof(active.biPhase), config.turnaroundUs);
+            break;
+        case 0x2A: memcpy(active.biPhase, op, sizeof(active.biPhase)); break;
+        
+        case 0x32:
+        case 0x36:
+            state = cmd == 0x32 ? ST_OPTICAL : ST_BIPHASE;
+            adjustStep = ADJUST_LIMIT;
+            break;
+        case 0x33:
+        case 0x34:
+        case 0x37:
+        case 0x38: {
+            // 步进 R0 水平偏移 / 双相位 AA；到达范围端点后自动结束调整
+            bool plus = cmd == 0x33 || cmd == 0x37;
+            int8_t& value = (int8_t&)(cmd <= 0x34 ? active.optical[0] : active.biPhase[3]);
+            value += plus ? 1 : -1;
+            adjustStep += plus ? 1 : -1;
+            if (adjustStep == 0 || adjustStep == 2 * ADJUST_LIMIT) state = ST_READY;
+            break;
+        }
+        case 0x35:
+        case 0x39:
+            if (data[1] && op[0] == 0x01) {
+                if (cmd == 0x35) memcpy(saved.optical, active.optical, sizeof(saved.optical));
+                if (cmd == 0x39) memcpy(saved.biPhase, active.biPhase, sizeof(saved.biPhase));
+            }
+            state = ST_READY;
+            break;
+        
+        case 0x40:
+            frame[0] = 0x40;
+            frame[1] = 1 + sizeof(active.pq);
+            frame[2] = 0x00;
+            memcpy(frame + 3, active.pq, sizeof(active.pq));
+            reply(frame, 3 + sizeof(active.pq), config.turnaroundUs);
+            break;
+        case 0x41: memcpy(active.pq, op, sizeof(active.pq)); break;
+        
+        // 单项画质：0x41 中的位置为 亮度、对比度、色调 U/V、饱和度 U/V、锐度
+        case 0x42:
+        case 0x44:
+        case 0x4E: {
+            uint8_t index = cmd == 0x42 ? 0 : cmd == 0x44 ? 1 : 6;
+            uint8_t value[] = {cmd, 0x02, 0x00, active.pq[index]};
+            reply(value, sizeof(value), config.turnaroundUs);
+            break;
+        }
+        case 0x46:
+        case 0x48: {
+            uint8_t index = cmd == 0x46 ? 2 : 4;
+            uint8_t value[] = {cmd, 0x03, 0x00, active.pq[index], active.pq[index + 1]};
+            reply(value, sizeof(value), config.turnaroundUs);
+            break;
+        }
+        case 0x43: active.pq[0] = op[0]; break;
+        case 0x45: active.pq[1] = op[0]; break;
+        case 0x47:
+        case 0x49: {
+            uint8_t index = cmd == 0x47 ? 2 : 4;
+            active.pq[index] = op[0];
+            active.pq[index + 1] = data[1] == 2 ? op[1] : op[0];
+            break;
+        }
+        case 0x4F: active.pq[6] = op[0]; break;
+        
+        case 0x82:
+        case 0x84:
+        case 0x9F: {
+            // OP1~OP4 数据长度，OP5~OP8 逐字节求和的校验和
+            uint32_t sum = 0;
+            for (size_t i = 10; i < length; i++) sum += data[i];
+            bool ok = sum == bigEndian32(data + 6);
+            if (ok) {
+                counters.blocks++;
+                counters.updateBytes += length - 10;
+            } else {
+                counters.blockErrors++;
+            }
+            uint8_t ack[] = {cmd, 0x01, (uint8_t)(ok ? 0x00 : 0x01)};
+            reply(ack, sizeof(ack), config.blockTurnaroundUs);
+            break;
+        }
+        case 0x92:
+        case 0x94: {
+            updateTarget = cmd;
+            uint8_t ack[] = {cmd, 0x01, 0x00};
+            reply(ack, sizeof(ack), config.turnaroundUs);
+            break;
+        }
+        
+        case 0xA0: {
+            uint8_t value[] = {0xA0, 0x04, 0x00, (uint8_t)(42 + rng() % 6), 85, 95};
+            reply(value, sizeof(value), config.turnaroundUs);
+            break;
+        }
+        case 0xA1: {
+            uint32_t runtime = runtimeBase + millis() / 1000;
+            uint8_t value[] = {0xA1, 0x05, 0x00, (uint8_t)runtime, (uint8_t)(runtime >> 8),
+                               (uint8_t)(runtime >> 16), (uint8_t)(runtime >> 24)};
+            reply(value, sizeof(value), config.turnaroundUs);
+            break;
+        }
+        case 0xA2: {
+            // 固件版、参数版、数据版各 4 字节
+            uint8_t value[15] = {0xA2, 0x0D, 0x00};
+            memcpy(value + 3, "1.02P003D007", 12);
+            reply(value, sizeof(value), config.turnaroundUs);
+            break;
+        }
+        case 0xA3: testPattern = op[0]; break;
+        case 0xB2: {
+            uint8_t value[15] = {0xB2, 0x0D, 0x00};
+            memcpy(value + 3, "SIM240101A01", 12);
+            reply(value, sizeof(value), config.turnaroundUs);
+            break;
+        }
+        case 0xB4: {
+            uint8_t value[11] = {0xB4, 0x09, 0x00, 0x00, 0x00, 0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC};
+            reply(value, sizeof(value), config.turnaroundUs);
+            break;
+        }
+    }
+}
+
+void Cxn0102Sim::reboot() {
+    // 重启：丢弃待读帧和所有未到期的应答，参数恢复为已保存的值
+    state = 0;
+    bootCount++;
+    updateTarget = 0;
+    outbox.clear();
+    readPos = 0;
+    frontTouched = false;
+    setComReq(false);
+    uint32_t expected = bootCount;
+    schedule(config.bootMs * 1000, [this, expected]() {
+        if (bootCount == expected) boot();
+    });
+}
+
+void Cxn0102Sim::boot() {
+    state = ST_READY;
+    active = saved;
+    adjustStep = 0;
+    uint8_t frame[] = {0x00, 0x02, 0x00, 0x00};
+    counters.notifies++;
+    queueFrame(std::vector<uint8_t>(frame, frame + sizeof(frame)), false);
+}
@@ -0,0 +1,167 @@
+#ifndef CXN0102_SIM_H
+#define CXN0102_SIM_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+// 注入故障的概率（0~1，每次总线访问独立抽取）
+struct SimFaults {
+    double nack;             // 写入地址 NACK（endTransmission 返回 2）
+    double busError;         // 写入中途总线错误（返回 4），帧被丢弃
+    double shortRead;        // 读取提前结束
+    double lateComReq;       // 应答就绪后 COM_REQ 迟于固件的等待上限才拉高
+    double stuckSda;         // 写入时从机卡住并拉低 SDA，需 SCL 脉冲释放
+};
+
+// 模拟器配置
+struct SimConfig {
+    uint8_t address;
+    uint8_t comReqPin;
+    uint8_t sdaPin;
+    uint8_t sclPin;
+    uint32_t turnaroundUs;       // 读取类命令写入结束到 COM_REQ 拉高
+    uint32_t blockTurnaroundUs;  // 更新块（0x9F）的处理时间
+    uint32_t lateComReqUs;       // lateComReq 故障时 COM_REQ 的延迟
+    uint32_t bootMs;             // 重启到 Boot Completed
+    uint32_t maxClockHz;         // 速率高于此值时写入一半出错（0 = 不限制）
+    uint8_t stuckPulses;         // 释放卡住的 SDA 需要的 SCL 脉冲数
+    bool splitReads;             // 是否支持分段读取（否则每次读取都从帧头开始）
+    bool acceptPQAll;            // 是否支持 0x41（否则回 Command Error）
+    SimFaults faults;
+    uint32_t seed;
+    
+    // 与 config.h 中的引脚和地址一致的默认配置
+    static SimConfig defaults();
+};
+
+// 模拟器计数
+struct SimCounters {
+    uint32_t writes;             // 被接受的写入帧
+    uint32_t reads;
+    uint32_t replies;            // 读取类命令与更新命令的应答帧
+    uint32_t notifies;           // 主动 Notify（Boot、Command Error、注入）
+    uint32_t stateErrors;        // 违反状态限制（回 Command Error）
+    uint32_t formatErrors;       // OP0 或帧长度与规格不符
+    uint32_t unknownCommands;
+    uint32_t discarded;          // 被新写入丢弃的未读应答或读了一部分的帧
+    uint32_t blocks;             // 接受的 0x9F 块
+    uint32_t blockErrors;        // 长度或校验和错误的块
+    uint32_t updateBytes;
+    uint32_t nacks;
+    uint32_t busErrors;
+    uint32_t shortReads;
+    uint32_t lateComReqs;
+    uint32_t stuckSda;
+    uint32_t sclPulses;          // 卡住期间收到的 SCL 脉冲
+};
+
+// Command Error Notify（0x12）的 RESULT（模拟器约定）
+enum SimCommandError : uint8_t {
+    SIM_ERROR_STATE   = 0x01,    // 当前状态不允许
+    SIM_ERROR_FORMAT  = 0x02,    // OP0/长度错误
+    SIM_ERROR_UNKNOWN = 0x03     // 不支持的命令
+};
+
+// CXN0102 I2C 从机模型：实现 test/help.txt 的命令集、状态限制、COM_REQ 和 Notify
+// 挂在模拟 Wire 上，固件模块不经修改即可对其运行
+//
+// 应答与 Notify 按产生顺序排队，队首就绪时拉高 COM_REQ，整帧读完后拉低
+// 支持分段读取时未读完的部分留给下一次读取；收到新的写入时丢弃读过一部分的队首帧
+// 和所有未读的应答（主动 Notify 保留）
+class Cxn0102Sim : public I2CSlave {
+public:
+    explicit Cxn0102Sim(const SimConfig& config);
+    ~Cxn0102Sim();
+    
+    // 挂到总线并启动事件线程；bootMs 后发出 Boot Completed
+    void begin(TwoWire& wire);
+    
+    uint8_t onWrite(const uint8_t* data, size_t length, uint32_t clockHz) override;
+    size_t onRead(uint8_t* out, size_t length, uint32_t clockHz) override;
+    
+    // 在 delayUs 后发出一个 Notify 帧（例如温度告警 0x11）
+    void injectNotify(const uint8_t* frame, uint8_t length, uint32_t delayUs = 0);
+    
+    // 当前状态（CxnState 之一，0 = 关机或重启中）
+    uint8_t getState();
+    
+    // 待读取的应答/Notify 帧数
+    size_t pendingFrames();
+    
+    SimCounters getCounters();
+    
+private:
+    struct Frame {
+        uint32_t id;
+        bool reply;              // 请求的应答（否则为主动 Notify）
+        std::vector<uint8_t> bytes;
+    };
+    
+    // 模块参数（当前值与 0x07 保存的值）
+    struct Params {
+        uint8_t geometry[9];
+        uint8_t optical[13];
+        uint8_t biPhase[4];
+        uint8_t pq[10];
+    };
+    
+    SimConfig config;
+    TwoWire* wire;
+    
+    std::recursive_mutex mutex;
+    std::condition_variable_any eventsChanged;
+    std::multimap<unsigned long, std::function<void()>> events;  // micros() 到期时间
+    std::thread eventThread;
+    bool running;
+    std::mt19937 rng;
+    
+    uint8_t state;
+    uint32_t bootCount;          // 重启时递增，使重启前安排的事件失效
+    Params active;
+    Params saved;
+    uint8_t mute;
+    uint8_t testPattern;
+    uint8_t adjustStep;          // 简单光轴/双相位调整的当前步进位置
+    uint8_t updateTarget;        // 0x92/0x94，0 = 未在分块更新
+    uint32_t runtimeBase;
+    
+    std::deque<Frame> outbox;
+    uint32_t nextFrameId;
+    size_t readPos;
+    bool frontTouched;           // 队首帧已被读过（可能只读了一部分）
+    bool comReqHigh;
+    bool sdaStuck;
+    uint8_t stuckPulses;
+    
+    SimCounters counters;
+    
+    bool chance(double probability);
+    void schedule(uint32_t delayUs, std::function<void()> fn);
+    void eventLoop();
+    static void onPinChange(uint8_t pin, uint8_t level, void* ctx);
+    
+    bool frameValid(const uint8_t* data, size_t length);
+    void execute(const uint8_t* data, size_t length);
+    void commandError(uint8_t cmd, uint8_t result);
+    void reply(const uint8_t* frame, uint8_t length, uint32_t delayUs);
+    void reboot();
+    void boot();
+    void factoryDefaults();
+    
+    void queueFrame(const std::vector<uint8_t>& bytes, bool isReply);
+    void discardStale();
+    void armFront(uint32_t delayUs);
+    void raiseFor(uint32_t id);
+    void setComReq(bool high);
+    void consumeFront();
+};
+
+#endif // CXN0102_SIM_H
@@ -0,0 +1,105 @@
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+// 主机模拟用的 Arduino 运行环境：时间取自 steady_clock，引脚为开漏线模型
+// 只覆盖模拟构建中的固件模块（I2C 通信、命令、设备信息、更新）用到的接口
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include "WString.h"
+#include "freertos/FreeRTOS.h"
+
+#define IRAM_ATTR
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT             0x01
+#define OUTPUT            0x03
+#define INPUT_PULLUP      0x05
+#define OUTPUT_OPEN_DRAIN 0x13
+
+#define RISING  0x01
+#define FALLING 0x02
+#define CHANGE  0x03
+
+#define SIM_PIN_COUNT 32
+
+typedef uint8_t byte;
+
+template <class T, class L, class H>
+inline T constrain(T value, L low, H high) {
+    return value < low ? low : (value > high ? high : value);
+}
+using std::min;
+using std::max;
+
+inline long map(long value, long inMin, long inMax, long outMin, long outMax) {
+    return (value - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+inline bool isDigit(int c) { return c >= '0' && c <= '9'; }
+
+// 串口输出到 stdout；enabled = false 时丢弃（工作负载运行时默认静默）
+class HardwareSerial {
+public:
+    bool enabled = true;
+    
+    void begin(unsigned long) {}
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+    size_t print(const String& text) { return print(text.c_str()); }
+    size_t print(const char* text);
+    size_t print(char c) { char text[2] = {c, 0}; return print(text); }
+    size_t print(int value) { return printf("%d", value); }
+    size_t print(unsigned int value) { return printf("%u", value); }
+    size_t print(long value) { return printf("%ld", value); }
+    size_t print(unsigned long value) { return printf("%lu", value); }
+    size_t print(double value) { return printf("%.2f", value); }
+    size_t println() { return print("\n"); }
+    template <class T>
+    size_t println(const T& value) { size_t n = print(value); return n + println(); }
+};
+extern HardwareSerial Serial;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+#define digitalPinToInterrupt(pin) (pin)
+void attachInterruptArg(uint8_t pin, void (*handler)(void*), void* arg, int mode);
+void detachInterrupt(uint8_t pin);
+
+// CPU 周期计数按 160 MHz 由 steady_clock 换算
+class EspClass {
+public:
+    uint32_t getCycleCount();
+    uint32_t getCpuFreqMHz() { return 160; }
+};
+extern EspClass ESP;
+
+// 模拟器一侧的接口
+namespace sim {
+
+// 从机驱动引脚：线电平 = 主机电平与从机电平相与（开漏），上升沿触发已注册的中断
+void driveLevel(uint8_t pin, uint8_t level);
+
+// 线电平变化时回调（在引起变化的线程中），用于模拟从机观察 SCL 脉冲
+typedef void (*PinObserver)(uint8_t pin, uint8_t level, void* ctx);
+void setPinObserver(PinObserver observer, void* ctx);
+
+// 忙等指定微秒（模拟总线传输时间，比 sleep 精确）
+void spinMicros(uint32_t us);
+
+}  // namespace sim
+
+#endif // SIM_ARDUINO_H
@@ -0,0 +1,30 @@
+#ifndef SIM_EEPROM_H
+#define SIM_EEPROM_H
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+// 内存中的 EEPROM（每次运行从全 0xFF 开始，即未保存过设置）
+class EEPROMClass {
+public:
+    bool begin(size_t size) {
+        data.assign(size, 0xFF);
+        return true;
+    }
+    uint8_t read(int address) const {
+        return address >= 0 && (size_t)address < data.size() ? data[address] : 0xFF;
+    }
+    void write(int address, uint8_t value) {
+        if (address >= 0 && (size_t)address < data.size()) data[address] = value;
+    }
+    bool commit() { return true; }
+    size_t length() const { return data.size(); }
+    
+private:
+    std::vector<uint8_t> data;
+};
+
+extern EEPROMClass EEPROM;
+
+#endif // SIM_EEPROM_H
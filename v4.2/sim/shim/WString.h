@@ -0,0 +1,74 @@
+#ifndef SIM_WSTRING_H
+#define SIM_WSTRING_H
+
+#include <stdlib.h>
+#include <string>
+
+// 以 std::string 实现的 Arduino String（只包含固件模块用到的部分）
+class String {
+public:
+    String() {}
+    String(const char* text) : s(text ? text : "") {}
+    String(const std::string& text) : s(text) {}
+    String(char c) : s(1, c) {}
+    String(unsigned char value) : s(std::to_string(value)) {}
+    String(int value) : s(std::to_string(value)) {}
+    String(unsigned int value) : s(std::to_string(value)) {}
+    String(long value) : s(std::to_string(value)) {}
+    String(unsigned long value) : s(std::to_string(value)) {}
+    String(double value, unsigned char decimals = 2) {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+        s = buffer;
+    }
+    
+    const char* c_str() const { return s.c_str(); }
+    unsigned int length() const { return s.size(); }
+    bool isEmpty() const { return s.empty(); }
+    void reserve(unsigned int size) { s.reserve(size); }
+    
+    char operator[](unsigned int index) const { return index < s.size() ? s[index] : 0; }
+    char charAt(unsigned int index) const { return (*this)[index]; }
+    
+    String& operator+=(const String& other) { s += other.s; return *this; }
+    String& operator+=(const char* other) { s += other ? other : ""; return *this; }
+    String& operator+=(char c) { s += c; return *this; }
+    String& operator+=(int value) { s += std::to_string(value); return *this; }
+    String& operator+=(unsigned int value) { s += std::to_string(value); return *this; }
+    String& operator+=(long value) { s += std::to_string(value); return *this; }
+    String& operator+=(unsigned long value) { s += std::to_string(value); return *this; }
+    
+    bool operator==(const String& other) const { return s == other.s; }
+    bool operator==(const char* other) const { return s == (other ? other : ""); }
+    bool operator!=(const String& other) const { return s != other.s; }
+    bool operator!=(const char* other) const { return !(*this == other); }
+    bool equals(const String& other) const { return s == other.s; }
+    
+    int indexOf(char c, unsigned int from = 0) const { return find(s.find(c, from)); }
+    int indexOf(const String& text, unsigned int from = 0) const { return find(s.find(text.s, from)); }
+    String substring(unsigned int from) const { return from < s.size() ? s.substr(from) : ""; }
+    String substring(unsigned int from, unsigned int to) const {
+        if (to > s.size()) to = s.size();
+        return from < to ? s.substr(from, to - from) : "";
+    }
+    bool startsWith(const String& prefix) const { return s.compare(0, prefix.s.size(), prefix.s) == 0; }
+    
+    long toInt() const { return strtol(s.c_str(), nullptr, 10); }
+    void trim() {
+        size_t start = s.find_first_not_of(" \t\r\n");
+        size_t end = s.find_last_not_of(" \t\r\n");
+        s = start == std::string::npos ? "" : s.substr(start, end - start + 1);
+    }
+    
+    friend String operator+(const String& a, const String& b) { return a.s + b.s; }
+    friend String operator+(const String& a, const char* b) { return a.s + (b ? b : ""); }
+    friend String operator+(const char* a, const String& b) { return (a ? a : "") + b.s; }
+    friend String operator+(const String& a, char b) { return a.s + b; }
+    
+private:
+    std::string s;
+    
+    static int find(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+};
+
+#endif // SIM_WSTRING_H
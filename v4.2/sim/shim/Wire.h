@@ -0,0 +1,68 @@
+#ifndef SIM_WIRE_H
+#define SIM_WIRE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <map>
+#include <mutex>
+
+#define I2C_BUFFER_LENGTH 128
+
+// 挂在模拟总线上的从机；Wire 按地址转发，调用发生在主机访问总线的线程中
+class I2CSlave {
+public:
+    virtual ~I2CSlave() {}
+    
+    // 主机写入一帧（START..STOP）；返回 endTransmission 的结果（0 成功，2/3 NACK，4/5 总线错误/超时）
+    virtual uint8_t onWrite(const uint8_t* data, size_t length, uint32_t clockHz) = 0;
+    
+    // 主机读取 length 字节；返回实际提供的字节数
+    virtual size_t onRead(uint8_t* out, size_t length, uint32_t clockHz) = 0;
+};
+
+// Arduino Wire 的模拟：按速率忙等传输时间（每字节 9 位，加地址字节与 START/STOP）
+class TwoWire {
+public:
+    TwoWire() {}
+    
+    bool begin(int sdaPin, int sclPin, uint32_t frequency);
+    void end();
+    void setClock(uint32_t frequency) { clockHz = frequency; }
+    uint32_t getClock() const { return clockHz; }
+    
+    void beginTransmission(uint8_t address);
+    size_t write(uint8_t value);
+    size_t write(const uint8_t* data, size_t length);
+    uint8_t endTransmission(bool sendStop = true);
+    
+    uint8_t requestFrom(uint8_t address, uint8_t count);
+    int available() const { return rxLength - rxIndex; }
+    int read() { return rxIndex < rxLength ? rxBuffer[rxIndex++] : -1; }
+    
+    // 模拟器接口：在地址上挂接/移除从机
+    void attachSlave(uint8_t address, I2CSlave* slave);
+    void detachSlave(uint8_t address);
+    
+private:
+    std::mutex slavesMutex;
+    std::map<uint8_t, I2CSlave*> slaves;
+    int sda = -1;
+    int scl = -1;
+    bool started = false;
+    uint32_t clockHz = 100000;
+    uint8_t txAddress = 0;
+    uint8_t txBuffer[I2C_BUFFER_LENGTH];
+    size_t txLength = 0;
+    bool txOverflow = false;
+    uint8_t rxBuffer[I2C_BUFFER_LENGTH];
+    int rxLength = 0;
+    int rxIndex = 0;
+    
+    I2CSlave* find(uint8_t address);
+    bool busHeld() const;
+    void transferTime(size_t bytes) const;
+};
+
+extern TwoWire Wire;
+
+#endif // SIM_WIRE_H
@@ -0,0 +1,149 @@
+#include "Arduino.h"
+#include <stdarg.h>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+HardwareSerial Serial;
+EspClass ESP;
+
+static const std::chrono::steady_clock::time_point bootTime = std::chrono::steady_clock::now();
+
+static uint64_t nanosSinceBoot() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - bootTime).count();
+}
+
+static std::mutex serialMutex;
+
+size_t HardwareSerial::printf(const char* format, ...) {
+    if (!enabled) return 0;
+    std::lock_guard<std::mutex> guard(serialMutex);
+    va_list args;
+    va_start(args, format);
+    int n = vprintf(format, args);
+    va_end(args);
+    return n > 0 ? n : 0;
+}
+
+size_t HardwareSerial::print(const char* text) {
+    if (!enabled || !text) return 0;
+    std::lock_guard<std::mutex> guard(serialMutex);
+    return fputs(text, stdout) >= 0 ? strlen(text) : 0;
+}
+
+unsigned long millis() {
+    return nanosSinceBoot() / 1000000;
+}
+
+unsigned long micros() {
+    return nanosSinceBoot() / 1000;
+}
+
+void delay(unsigned long ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(unsigned int us) {
+    sim::spinMicros(us);
+}
+
+uint32_t EspClass::getCycleCount() {
+    return (uint32_t)(nanosSinceBoot() * getCpuFreqMHz() / 1000);
+}
+
+// ---- 引脚：开漏线模型 ----
+
+struct PinState {
+    uint8_t host = HIGH;         // 主机输出（输入模式时为释放 = 高）
+    uint8_t slave = HIGH;        // 从机驱动
+    void (*handler)(void*) = nullptr;
+    void* arg = nullptr;
+    int mode = 0;
+};
+
+static std::mutex pinMutex;
+static PinState pins[SIM_PIN_COUNT];
+static sim::PinObserver pinObserver = nullptr;
+static void* pinObserverCtx = nullptr;
+
+static uint8_t lineLevel(const PinState& pin) {
+    return pin.host && pin.slave ? HIGH : LOW;
+}
+
+// 在锁外调用中断和观察者，避免与其中的引脚访问互锁
+template <class Change>
+static void updatePin(uint8_t pin, Change change) {
+    if (pin >= SIM_PIN_COUNT) return;
+    void (*handler)(void*) = nullptr;
+    void* arg = nullptr;
+    uint8_t before, after;
+    {
+        std::lock_guard<std::mutex> guard(pinMutex);
+        PinState& state = pins[pin];
+        before = lineLevel(state);
+        change(state);
+        after = lineLevel(state);
+        bool fire = (state.mode == RISING && after > before) ||
+                    (state.mode == FALLING && after < before) ||
+                    (state.mode == CHANGE && after != before);
+        if (fire) {
+            handler = state.handler;
+            arg = state.arg;
+        }
+    }
+    if (after != before && pinObserver) pinObserver(pin, after, pinObserverCtx);
+    if (handler) handler(arg);
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    updatePin(pin, [mode](PinState& state) {
+        if (mode == INPUT || mode == INPUT_PULLUP) state.host = HIGH;
+    });
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    updatePin(pin, [value](PinState& state) { state.host = value ? HIGH : LOW; });
+}
+
+int digitalRead(uint8_t pin) {
+    if (pin >= SIM_PIN_COUNT) return LOW;
+    std::lock_guard<std::mutex> guard(pinMutex);
+    return lineLevel(pins[pin]);
+}
+
+void attachInterruptArg(uint8_t pin, void (*handler)(void*), void* arg, int mode) {
+    if (pin >= SIM_PIN_COUNT) return;
+    std::lock_guard<std::mutex> guard(pinMutex);
+    pins[pin].handler = handler;
+    pins[pin].arg = arg;
+    pins[pin].mode = mode;
+}
+
+void detachInterrupt(uint8_t pin) {
+    if (pin >= SIM_PIN_COUNT) return;
+    std::lock_guard<std::mutex> guard(pinMutex);
+    pins[pin].handler = nullptr;
+    pins[pin].mode = 0;
+}
+
+namespace sim {
+
+void driveLevel(uint8_t pin, uint8_t level) {
+    updatePin(pin, [level](PinState& state) { state.slave = level ? HIGH : LOW; });
+}
+
+void setPinObserver(PinObserver observer, void* ctx) {
+    std::lock_guard<std::mutex> guard(pinMutex);
+    pinObserver = observer;
+    pinObserverCtx = ctx;
+}
+
+void spinMicros(uint32_t us) {
+    uint64_t until = nanosSinceBoot() + (uint64_t)us * 1000;
+    while (nanosSinceBoot() < until) {
+        std::this_thread::yield();
+    }
+}
+
+}  // namespace sim
@@ -0,0 +1,37 @@
+#ifndef SIM_FREERTOS_H
+#define SIM_FREERTOS_H
+
+// FreeRTOS 的主机模拟：任务为 std::thread，1 tick = 1 ms
+// 临界区共用一把递归锁（ESP32-C3 单核上临界区同样互斥所有任务）
+
+#include <stdint.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE  1
+#define pdFALSE 0
+#define pdPASS  1
+#define pdFAIL  0
+
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFF)
+#define portTICK_PERIOD_MS 1
+#define configTICK_RATE_HZ 1000
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+typedef struct {
+    int reserved;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+
+void simEnterCritical();
+void simExitCritical();
+
+#define portENTER_CRITICAL(mux) simEnterCritical()
+#define portEXIT_CRITICAL(mux) simExitCritical()
+#define portENTER_CRITICAL_ISR(mux) simEnterCritical()
+#define portEXIT_CRITICAL_ISR(mux) simExitCritical()
+#define portYIELD_FROM_ISR(woken) ((void)(woken))
+
+#endif // SIM_FREERTOS_H
@@ -0,0 +1,98 @@
+#include "Arduino.h"
+#include "Wire.h"
+#include "EEPROM.h"
+
+TwoWire Wire;
+EEPROMClass EEPROM;
+
+bool TwoWire::begin(int sdaPin, int sclPin, uint32_t frequency) {
+    sda = sdaPin;
+    scl = sclPin;
+    clockHz = frequency;
+    // 控制器接管引脚：主机一侧释放（开漏高电平）
+    pinMode(sda, INPUT_PULLUP);
+    pinMode(scl, INPUT_PULLUP);
+    started = true;
+    return true;
+}
+
+void TwoWire::end() {
+    started = false;
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+    txAddress = address;
+    txLength = 0;
+    txOverflow = false;
+}
+
+size_t TwoWire::write(uint8_t value) {
+    if (txLength >= I2C_BUFFER_LENGTH) {
+        txOverflow = true;
+        return 0;
+    }
+    txBuffer[txLength++] = value;
+    return 1;
+}
+
+size_t TwoWire::write(const uint8_t* data, size_t length) {
+    size_t n = 0;
+    while (n < length && write(data[n])) n++;
+    return n;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop) {
+    (void)sendStop;
+    if (!started) return 4;
+    if (txOverflow) return 1;
+    // SDA/SCL 被拉低时控制器无法产生 START，按超时返回
+    if (busHeld()) return 5;
+    
+    transferTime(txLength);
+    I2CSlave* slave = find(txAddress);
+    if (!slave) return 2;
+    return slave->onWrite(txBuffer, txLength, clockHz);
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t count) {
+    rxLength = 0;
+    rxIndex = 0;
+    if (!started || busHeld()) return 0;
+    if (count > I2C_BUFFER_LENGTH) count = I2C_BUFFER_LENGTH;
+    
+    I2CSlave* slave = find(address);
+    if (!slave) {
+        transferTime(0);
+        return 0;
+    }
+    size_t n = slave->onRead(rxBuffer, count, clockHz);
+    transferTime(n < count ? n : count);
+    rxLength = n < count ? n : count;
+    return rxLength;
+}
+
+void TwoWire::attachSlave(uint8_t address, I2CSlave* slave) {
+    std::lock_guard<std::mutex> guard(slavesMutex);
+    slaves[address] = slave;
+}
+
+void TwoWire::detachSlave(uint8_t address) {
+    std::lock_guard<std::mutex> guard(slavesMutex);
+    slaves.erase(address);
+}
+
+I2CSlave* TwoWire::find(uint8_t address) {
+    std::lock_guard<std::mutex> guard(slavesMutex);
+    auto it = slaves.find(address);
+    return it == slaves.end() ? nullptr : it->second;
+}
+
+bool TwoWire::busHeld() const {
+    return digitalRead(sda) == LOW || digitalRead(scl) == LOW;
+}
+
+void TwoWire::transferTime(size_t bytes) const {
+    // 地址字节 + 数据字节，每字节 8 位数据加 1 位 ACK，另计 START/STOP
+    uint64_t bits = (uint64_t)(bytes + 1) * 9 + 2;
+    sim::spinMicros((uint32_t)(bits * 1000000 / (clockHz ? clockHz : 100000)));
+}
@@ -0,0 +1,658 @@
+// CXN0102 主机模拟器：固件的 I2C 通信、命令、设备信息和更新模块不经修改地
+// 对 Cxn0102Sim 运行脚本化的工作负载，每一步结束后打印分命令的延迟统计
+// 用法见 sim/README.md 或 --help
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "config.h"
+#include "i2c_communicator.h"
+#include "command_handler.h"
+#include "device_info.h"
+#include "module_updater.h"
+#include "cxn0102_sim.h"
+#include "bus_capture.h"
+#include "capture_replay.h"
+
+static const char* DEFAULT_WORKLOAD = "info:10,geometry:16,pq:16,toggle:10,notify:20,stray:20,update:16384,preempt:20,encode:10000";
+
+static I2CCommunicator i2cComm;
+static CommandHandler commandHandler;
+static DeviceInfoManager deviceInfo;
+static ModuleUpdater moduleUpdater;
+static Cxn0102Sim* simulator = nullptr;
+
+static std::atomic<bool> loopRunning(false);
+static std::atomic<uint32_t> notifyCount(0);
+static std::atomic<uint32_t> bootCount(0);
+static std::atomic<uint32_t> replyNotifies(0);   // 被当成 Notify 送出的 0xA0 应答
+
+struct Step {
+    std::string name;
+    long arg;
+    bool hasArg;
+};
+
+struct StepResult {
+    uint32_t ops;
+    uint32_t failures;
+    std::string note;
+};
+
+static void notifyCallback(uint8_t module, uint8_t cmd, uint8_t size, uint8_t result,
+                           const uint8_t* data, uint8_t length) {
+    (void)module;
+    (void)size;
+    (void)result;
+    (void)data;
+    (void)length;
+    notifyCount++;
+    if (cmd == 0x00) bootCount++;
+    if (cmd == 0xA0) replyNotifies++;
+}
+
+// 相当于固件的 loop()：处理 Notify，并把暂存的更新数据切成块下发
+static void loopThread() {
+    while (loopRunning) {
+        i2cComm.processNotify();
+        moduleUpdater.process();
+        delay(1);
+    }
+}
+
+// 按网络分片写入更新数据，暂存环满时等待 loop 消化（相当于客户端收到 503 后重试）
+static bool writeUpdate(const uint8_t* data, size_t length) {
+    while (!moduleUpdater.write(data, length)) {
+        if (!moduleUpdater.isActive()) return false;
+        delay(1);
+    }
+    return true;
+}
+
+// 标记数据已全部到达并等待最后的块完成
+static bool finishUpdate() {
+    if (!moduleUpdater.finish()) return false;
+    while (moduleUpdater.isActive()) delay(1);
+    return moduleUpdater.getStatus().state == UPDATE_DONE;
+}
+
+static bool waitUntil(std::atomic<uint32_t>& counter, uint32_t target, unsigned long timeoutMs) {
+    unsigned long start = millis();
+    while (counter < target) {
+        if (millis() - start >= timeoutMs) return false;
+        delay(1);
+    }
+    return true;
+}
+
+// 本步中 cmd 实际上总线的次数（突发写入超过队列深度时多出的部分被丢弃）
+static uint32_t sentCount(uint8_t cmd) {
+    I2CCommandStats stats[I2C_STATS_SLOTS];
+    uint8_t n = i2cComm.getCommandStats(stats, I2C_STATS_SLOTS);
+    for (uint8_t i = 0; i < n; i++) {
+        if (stats[i].cmd == cmd) return stats[i].count;
+    }
+    return 0;
+}
+
+// 提交预定义命令并等待完成；返回 I2CResult::error，未能入队时为 I2C_ERROR_INVALID
+static uint8_t runCommand(int index) {
+    uint32_t seq = commandHandler.sendCommandByIndex(index);
+    CommandStatus status;
+    while (seq && commandHandler.getStatus(seq, status) && !status.done) {
+        delayMicroseconds(20);
+    }
+    return seq && commandHandler.getStatus(seq, status) ? status.error : (uint8_t)I2C_ERROR_INVALID;
+}
+
+// 改为编译期帧表之前的预定义命令表，每次发送都要 strlen + strtol 解析（encode 步骤对照用）
+static const char* const LEGACY_COMMANDS[] = {
+    "0100", "0200", "0b0101", "0b0100", "3200", "3300", "3400", "350100", "350101", "3600",
+    "3700", "3800", "390100", "390101", "4A", "5001", "5000", "6000", "6001", "7000",
+    "7001", "7002", "7003", "8000", "8001", "4300", "4500", "4700", "4900", "4F00",
+};
+static_assert(sizeof(LEGACY_COMMANDS) / sizeof(LEGACY_COMMANDS[0]) == CMD_COUNT,
+              "LEGACY_COMMANDS must cover every predefined command");
+
+// 原来的编码方式：循环条件中的 strlen 与逐字节 strtol
+static uint8_t encodeLegacy(const char* cmd, uint8_t* frame) {
+    uint8_t length = 0;
+    for (int i = 0; i < (int)strlen(cmd); i += 2) {
+        char byteStr[3] = {cmd[i], cmd[i + 1], '\0'};
+        frame[length++] = (uint8_t)strtol(byteStr, NULL, 16);
+    }
+    return length;
+}
+
+// 每条命令编码耗时（纳秒），两种方式都把帧复制到同一个缓冲，与交给总线队列时一样
+static double encodeNs(bool legacy, long rounds, volatile uint32_t& checksum) {
+    uint8_t frame[I2C_MAX_FRAME];
+    auto start = std::chrono::steady_clock::now();
+    for (long r = 0; r < rounds; r++) {
+        for (int i = 0; i < CMD_COUNT; i++) {
+            uint8_t length;
+            if (legacy) {
+                length = encodeLegacy(LEGACY_COMMANDS[i], frame);
+            } else {
+                const CommandFrame* command = commandHandler.getCommand(i);
+                length = command->length;
+                memcpy(frame, command->bytes, length);
+            }
+            checksum += frame[0] + length;   // 防止编码被优化掉
+        }
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / ((double)rounds * CMD_COUNT);
+}
+
+// 0xA0 在最低的后台通道：它完成时，之前排队的所有异步写入都已执行
+// 屏障本身计入该步的 0xA0 统计
+static bool barrier() {
+    int temperature, muteThreshold, stopThreshold;
+    return i2cComm.requestTemperature(temperature, muteThreshold, stopThreshold);
+}
+
+static StepResult runStep(const Step& step) {
+    StepResult r = {0, 0, ""};
+    long n = step.hasArg ? step.arg : 1;
+    
+    if (step.name == "info") {
+        // 5 个读取类命令为一轮
+        for (long i = 0; i < n; i++) {
+            bool ok[] = {deviceInfo.requestTemperature(), deviceInfo.requestRuntime(),
+                         deviceInfo.requestVersion(), deviceInfo.requestLOTNumber(),
+                         deviceInfo.requestSerialNumber()};
+            for (bool o : ok) {
+                r.ops++;
+                if (!o) r.failures++;
+            }
+        }
+    } else if (step.name == "geometry") {
+        // 队列已满未能入队的写入计为失败
+        uint32_t dropped = 0;
+        for (long i = 0; i < n; i++) {
+            if (!i2cComm.sendKeystoneAndFlip((int)(i % 61) - 30, (int)(i % 41) - 20, (int)(i % 4))) {
+                dropped++;
+            }
+            r.ops++;
+        }
+        r.failures += dropped;
+        if (!barrier()) r.failures++;
+        r.note = std::to_string(sentCount(0x26)) + " sent, " + std::to_string(dropped) + " dropped";
+    } else if (step.name == "pq") {
+        uint32_t dropped = 0;
+        SystemSettings settings = {};
+        for (long i = 0; i < n; i++) {
+            settings.brightness = (uint8_t)(i * 37);
+            settings.contrast = (uint8_t)(i * 53);
+            settings.hueU = settings.hueV = 128;
+            settings.satU = settings.satV = (uint8_t)(i * 11);
+            settings.sharpness = (uint8_t)(i * 29);
+            if (!i2cComm.sendPictureQuality(settings)) dropped++;
+            r.ops++;
+        }
+        r.failures += dropped;
+        if (!barrier()) r.failures++;
+        uint32_t sent = sentCount(0x41);
+        r.note = std::to_string(sent ? sent : sentCount(0x43)) + " sent, " + std::to_string(dropped) + " dropped";
+    } else if (step.name == "toggle") {
+        // Start/Stop 交替，每个命令完成后再发下一个
+        for (long i = 0; i < 2 * n; i++) {
+            int index = i % 2 ? CMD_STOP_INPUT : CMD_START_INPUT;
+            r.ops++;
+            if (runCommand(index)) r.failures++;
+        }
+    } else if (step.name == "cmd") {
+        r.ops++;
+        if (runCommand((int)n)) r.failures++;
+        if (!barrier()) r.failures++;
+    } else if (step.name == "optical") {
+        int sequence[] = {CMD_OPTICAL_ENTER, CMD_OPTICAL_EXIT_SAVE};
+        r.ops++;
+        if (runCommand(sequence[0])) r.failures++;
+        for (long i = 0; i < n; i++) {
+            r.ops++;
+            if (runCommand(i % 2 ? CMD_OPTICAL_MINUS : CMD_OPTICAL_PLUS)) {
+                r.failures++;
+            }
+        }
+        r.ops++;
+        if (runCommand(sequence[1])) r.failures++;
+    } else if (step.name == "notify") {
+        // 模块主动发出温度告警/恢复，间隔 1 ms；由 loop 线程读取
+        uint32_t target = notifyCount + n;
+        for (long i = 0; i < n; i++) {
+            uint8_t frame[] = {0x11, 0x02, (uint8_t)(i % 2 ? 0x00 : 0x80), 0x00};
+            simulator->injectNotify(frame, sizeof(frame), i * 1000);
+        }
+        r.ops = n;
+        if (!waitUntil(notifyCount, target, 2000 + n * 10)) {
+            r.failures = target - notifyCount;
+        }
+    } else if (step.name == "stray") {
+        // 温度告警在 0xA0 写入之后、应答之前到达：读取须成功，Notify 须送达，应答不能被当成 Notify
+        uint32_t target = notifyCount + n;
+        uint32_t misrouted = replyNotifies;
+        for (long i = 0; i < n; i++) {
+            uint8_t frame[] = {0x11, 0x02, 0x80, 0x00};
+            simulator->injectNotify(frame, sizeof(frame), 300);
+            r.ops++;
+            if (!barrier()) r.failures++;
+        }
+        if (!waitUntil(notifyCount, target, 2000)) {
+            r.failures += target - notifyCount;
+        }
+        r.failures += replyNotifies - misrouted;
+        r.note = std::to_string(replyNotifies - misrouted) + " replies misrouted";
+    } else if (step.name == "update") {
+        // n 字节伪随机图片数据，按 512 字节的网络分片写入
+        uint32_t total = step.hasArg ? (uint32_t)n : 16384;
+        if (!moduleUpdater.start(UPDATE_IMAGE, total)) {
+            r.failures++;
+            return r;
+        }
+        uint8_t chunk[512];
+        uint32_t seed = 12345;
+        for (uint32_t sent = 0; sent < total;) {
+            uint32_t len = total - sent < sizeof(chunk) ? total - sent : sizeof(chunk);
+            for (uint32_t i = 0; i < len; i++) {
+                seed = seed * 1103515245 + 12345;
+                chunk[i] = seed >> 16;
+            }
+            if (!writeUpdate(chunk, len)) break;
+            sent += len;
+        }
+        if (!finishUpdate()) r.failures++;
+        UpdateStatus status = moduleUpdater.getStatus();
+        r.ops = status.blocks;
+        r.note = std::to_string(status.sentBytes) + " B, " + std::to_string(status.bytesPerSec) + " B/s";
+    } else if (step.name == "preempt") {
+        // 后台信息读取、交互写入和分块更新同时占用总线时发出 n 次静音切换（安全通道）
+        // 每次从提交到完成超过 I2C_SAFETY_BOUND_MS 计为失败
+        std::atomic<bool> loading(true);
+        std::thread background([&loading]() {
+            while (loading) deviceInfo.requestAllInfo();
+        });
+        std::thread interactive([&loading]() {
+            for (int i = 0; loading; i++) {
+                i2cComm.sendKeystoneAndFlip(i % 61 - 30, i % 41 - 20, i % 4);
+                delay(1);
+            }
+        });
+        std::thread update([&loading]() {
+            uint8_t chunk[512];
+            if (!moduleUpdater.start(UPDATE_IMAGE, 64 * sizeof(chunk))) return;
+            memset(chunk, 0x5A, sizeof(chunk));
+            for (int i = 0; i < 64 && loading; i++) {
+                if (!writeUpdate(chunk, sizeof(chunk))) break;
+            }
+            if (loading) {
+                finishUpdate();
+            } else {
+                moduleUpdater.abort("Load stopped");
+            }
+        });
+        
+        // 与网页 Mute/Unmute 相同的帧（0x60）
+        const CommandFrame* mute = commandHandler.getCommand(CMD_MUTE - 1);
+        const CommandFrame* unmute = commandHandler.getCommand(CMD_UNMUTE - 1);
+        uint32_t worst = 0;
+        for (long i = 0; i < n; i++) {
+            delay(2 + i % 7);
+            const CommandFrame* frame = i % 2 ? unmute : mute;
+            I2CResult result;
+            unsigned long start = micros();
+            i2cComm.transact(frame->bytes, frame->length, result);
+            uint32_t us = micros() - start;
+            if (us > worst) worst = us;
+            r.ops++;
+            if (result.error || us > I2C_SAFETY_BOUND_MS * 1000UL) r.failures++;
+        }
+        loading = false;
+        background.join();
+        interactive.join();
+        update.join();
+        if (!barrier()) r.failures++;
+        r.note = "worst " + std::to_string(worst) + " us, bound " +
+                 std::to_string(I2C_SAFETY_BOUND_MS * 1000) + " us";
+    } else if (step.name == "encode") {
+        // 不经总线：N 轮编码全部预定义命令，对照原来的十六进制解析
+        volatile uint32_t checksum = 0;
+        double legacy = encodeNs(true, n, checksum);
+        double table = encodeNs(false, n, checksum);
+        r.ops = n * CMD_COUNT;
+        char note[96];
+        snprintf(note, sizeof(note), "hex %.1f ns/cmd, table %.1f ns/cmd", legacy, table);
+        r.note = note;
+    } else if (step.name == "reboot") {
+        uint32_t target = bootCount + 1;
+        r.ops++;
+        if (runCommand(CMD_REBOOT) ||
+            !waitUntil(bootCount, target, 3000)) {
+            r.failures++;
+        }
+    } else if (step.name == "clock") {
+        i2cComm.setClock((uint32_t)n);
+        if (!barrier()) r.failures++;
+    } else if (step.name == "probe") {
+        r.note = std::to_string(i2cComm.probeClock()) + " Hz";
+    } else if (step.name == "wait") {
+        delay(n);
+    } else {
+        r.failures++;
+        r.note = "unknown step";
+    }
+    return r;
+}
+
+// 直方图中累计达到 percent 的桶上限；落在最后一桶时用最大值
+static uint32_t percentile(const I2CCommandStats& s, uint32_t percent) {
+    uint64_t need = ((uint64_t)s.count * percent + 99) / 100;
+    uint64_t seen = 0;
+    for (uint8_t i = 0; i < I2C_STATS_BUCKETS - 1; i++) {
+        seen += s.buckets[i];
+        if (seen >= need) return I2C_LATENCY_BOUNDS_US[i] < s.maxUs ? I2C_LATENCY_BOUNDS_US[i] : s.maxUs;
+    }
+    return s.maxUs;
+}
+
+static void printStats() {
+    I2CCommandStats stats[I2C_STATS_SLOTS];
+    uint8_t n = i2cComm.getCommandStats(stats, I2C_STATS_SLOTS);
+    printf("   CMD   count  errors  avg_us  p50<=us  p95<=us  max_us    tx_B    rx_B\n");
+    for (uint8_t i = 0; i < n; i++) {
+        const I2CCommandStats& s = stats[i];
+        if (!s.count) continue;
+        printf("  0x%02X %7u %7u %7lu %8u %8u %7u %7u %7u\n",
+               s.cmd, s.count, s.nacks + s.busErrors + s.timeouts + s.shortReads,
+               (unsigned long)(s.totalUs / s.count), percentile(s, 50), percentile(s, 95),
+               s.maxUs, s.txBytes, s.rxBytes);
+    }
+    printf("  lane          count  dropped  preempt  avg_us  max_us\n");
+    for (uint8_t lane = 0; lane < CXN_LANE_COUNT; lane++) {
+        I2CLaneStats l = i2cComm.getLaneStats(lane);
+        if (!l.count && !l.dropped) continue;
+        printf("  %-11s %7u %8u %8u %7lu %7u\n", I2CCommunicator::laneName(lane), l.count, l.dropped,
+               l.preemptions, (unsigned long)(l.count ? l.totalLatencyUs / l.count : 0), l.maxLatencyUs);
+    }
+}
+
+static void printSummary() {
+    SimCounters c = simulator->getCounters();
+    I2CRecoveryStats recovery = i2cComm.getRecoveryStats();
+    I2CClockStats clock = i2cComm.getClockStats();
+    ModuleStateStats state = i2cComm.getModuleStateStats();
+    
+    printf("\n== simulator\n");
+    printf("  writes %u, reads %u, replies %u, notifies %u, discarded %u\n",
+           c.writes, c.reads, c.replies, c.notifies, c.discarded);
+    printf("  state errors %u, format errors %u, unknown commands %u\n",
+           c.stateErrors, c.formatErrors, c.unknownCommands);
+    printf("  update blocks %u (%u B), bad blocks %u\n", c.blocks, c.updateBytes, c.blockErrors);
+    printf("  injected: nack %u, bus error %u, short read %u, late COM_REQ %u, stuck SDA %u (%u SCL pulses)\n",
+           c.nacks, c.busErrors, c.shortReads, c.lateComReqs, c.stuckSda, c.sclPulses);
+    printf("== firmware\n");
+    printf("  clock %lu Hz (probed %lu Hz, %u fallbacks)\n",
+           (unsigned long)clock.clockHz, (unsigned long)clock.probedHz, clock.fallbacks);
+    printf("  retries %u, recovered %u, surfaced %u, SCL toggles %u, reinits %u\n",
+           recovery.retries, recovery.recovered, recovery.surfaced, recovery.sclToggles, recovery.reinits);
+    printf("  module state %s: deferred %u, rejected %u, flushed %u, transitions %u\n",
+           I2CCommunicator::moduleStateName(i2cComm.getModuleState()),
+           state.deferred, state.rejected, state.flushed, state.transitions);
+    printf("  shadow skips %u, notify overflows %u, notifies handled %u\n",
+           i2cComm.getShadowSkips(), i2cComm.getNotifyOverflows(), (uint32_t)notifyCount);
+}
+
+static bool parseSteps(const std::string& text, std::vector<Step>& steps) {
+    std::string token;
+    std::istringstream in(text);
+    while (std::getline(in, token, ',')) {
+        token.erase(0, token.find_first_not_of(" \t\r\n"));
+        token.erase(token.find_last_not_of(" \t\r\n") + 1);
+        if (token.empty()) continue;
+        Step step = {token, 0, false};
+        size_t colon = token.find(':');
+        if (colon != std::string::npos) {
+            step.name = token.substr(0, colon);
+            char* end = nullptr;
+            step.arg = strtol(token.c_str() + colon + 1, &end, 0);
+            if (!end || *end) {
+                fprintf(stderr, "Bad step argument: %s\n", token.c_str());
+                return false;
+            }
+            step.hasArg = true;
+        }
+        steps.push_back(step);
+    }
+    return true;
+}
+
+// 脚本文件：每行一个或多个以逗号分隔的步骤，# 之后为注释
+static bool loadScript(const char* path, std::vector<Step>& steps) {
+    std::ifstream file(path);
+    if (!file) {
+        fprintf(stderr, "Cannot open script: %s\n", path);
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) line.erase(hash);
+        if (!parseSteps(line, steps)) return false;
+    }
+    return true;
+}
+
+// 回放时固件模块不运行，直接在总线上重放捕获的事务
+static int runReplay(const char* path, const SimConfig& config, const ReplayOptions& options) {
+    CaptureDump dump;
+    if (!loadCapture(path, dump)) return 2;
+    
+    Wire.begin(config.sdaPin, config.sclPin, I2C_CLOCK_FAST_HZ);
+    // 先读走模块上电时的 Boot Completed，捕获通常从运行中途开始
+    delay(config.bootMs + 50);
+    if (digitalRead(config.comReqPin) == HIGH) {
+        Wire.requestFrom(config.address, (uint8_t)4);
+        while (Wire.available()) Wire.read();
+    }
+    
+    uint32_t mismatches = replayCapture(dump, Wire, options);
+    fflush(stdout);
+    _Exit(mismatches ? 1 : 0);
+}
+
+static void usage() {
+    printf("Usage: cxn0102_sim [options] [step,step,...]\n"
+           "Steps (default \"%s\"):\n"
+           "  info:N       N rounds of 0xA0/0xA1/0xA2/0xB2/0xB4 reads\n"
+           "  geometry:N   N keystone/flip writes (0x26, async); writes the queue\n"
+           "               drops count as failures\n"
+           "  pq:N         N picture quality writes (0x41 or per-field, async); same\n"
+           "  toggle:N     N Start/Stop pairs, each command awaited\n"
+           "  optical:N    enter easy optical axis, N +/- steps, exit with save\n"
+           "  cmd:I        predefined command I (same index as /command?cmd=)\n"
+           "  notify:N     N module-initiated notifies, 1 ms apart\n"
+           "  stray:N      N 0xA0 reads, each with a notify arriving before the reply\n"
+           "  update:BYTES chunked image update (0x94 + 0x9F blocks)\n"
+           "  preempt:N    N Mute/Unmute toggles (0x60, safety lane) under background,\n"
+           "               interactive and update load; each within the safety bound\n"
+           "  encode:N     N rounds of encoding every predefined command, hex parser\n"
+           "               vs. compile-time table (no bus traffic)\n"
+           "  reboot       0x0B reboot and wait for Boot Completed\n"
+           "  clock:HZ     set the bus clock; probe: rerun the clock probe\n"
+           "  wait:MS\n"
+           "Options:\n"
+           "  --script FILE        read steps from FILE\n"
+           "  --turnaround-us N    write to COM_REQ for replies (default 800)\n"
+           "  --block-us N         0x9F block processing time (default 3000)\n"
+           "  --boot-ms N          reboot to Boot Completed (default 200)\n"
+           "  --max-clock HZ       half of the writes above HZ fail\n"
+           "  --no-probe           skip the boot clock probe (stay at %d Hz)\n"
+           "  --no-split-reads     module restarts every read at the frame header\n"
+           "  --reject-pq-all      module answers 0x41 with Command Error\n"
+           "  --nack P --bus-error P --short-read P --late-comreq P --stuck-sda P\n"
+           "                       fault probabilities per bus access (0..1)\n"
+           "  --seed N             fault RNG seed\n"
+           "  --verbose            show the firmware serial log\n"
+           "Bus capture (/i2c_capture dumps):\n"
+           "  --capture-out FILE   save the firmware's capture after the workload\n"
+           "  --decode FILE        print the records of a capture\n"
+           "  --curl URL           with --decode: print a curl script that replays\n"
+           "                       the writes on a device at URL\n"
+           "  --replay FILE        replay a capture against the simulated module\n"
+           "  --realtime           keep the captured timing between records\n"
+           "  --strict             reply data must match too, not only CMD/SIZE/RESULT\n",
+           DEFAULT_WORKLOAD, I2C_CLOCK_SLOW_HZ);
+}
+
+int main(int argc, char** argv) {
+    SimConfig config = SimConfig::defaults();
+    std::vector<Step> steps;
+    bool verbose = false;
+    bool probe = true;
+    const char* captureOut = nullptr;
+    const char* decodePath = nullptr;
+    const char* replayPath = nullptr;
+    std::string curlUrl;
+    ReplayOptions replay = { false, false, config.comReqPin };
+    
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        const char* value = hasValue ? argv[i + 1] : "";
+        if (arg == "--help" || arg == "-h") {
+            usage();
+            return 0;
+        } else if (arg == "--verbose") {
+            verbose = true;
+        } else if (arg == "--no-probe") {
+            probe = false;
+        } else if (arg == "--no-split-reads") {
+            config.splitReads = false;
+        } else if (arg == "--reject-pq-all") {
+            config.acceptPQAll = false;
+        } else if (arg == "--realtime") {
+            replay.realtime = true;
+        } else if (arg == "--strict") {
+            replay.strictData = true;
+        } else if (arg.compare(0, 2, "--") == 0 && !hasValue) {
+            fprintf(stderr, "Missing value for %s\n", arg.c_str());
+            return 2;
+        } else if (arg == "--script") {
+            if (!loadScript(value, steps)) return 2;
+            i++;
+        } else if (arg == "--capture-out") {
+            captureOut = value;
+            i++;
+        } else if (arg == "--decode") {
+            decodePath = value;
+            i++;
+        } else if (arg == "--curl") {
+            curlUrl = value;
+            i++;
+        } else if (arg == "--replay") {
+            replayPath = value;
+            i++;
+        } else if (arg == "--turnaround-us") {
+            config.turnaroundUs = strtoul(value, nullptr, 0);
+            i++;
+        } else if (arg == "--block-us") {
+            config.blockTurnaroundUs = strtoul(value, nullptr, 0);
+            i++;
+        } else if (arg == "--boot-ms") {
+            config.bootMs = strtoul(value, nullptr, 0);
+            i++;
+        } else if (arg == "--max-clock") {
+            config.maxClockHz = strtoul(value, nullptr, 0);
+            i++;
+        } else if (arg == "--seed") {
+            config.seed = strtoul(value, nullptr, 0);
+            i++;
+        } else if (arg == "--nack") {
+            config.faults.nack = atof(value);
+            i++;
+        } else if (arg == "--bus-error") {
+            config.faults.busError = atof(value);
+            i++;
+        } else if (arg == "--short-read") {
+            config.faults.shortRead = atof(value);
+            i++;
+        } else if (arg == "--late-comreq") {
+            config.faults.lateComReq = atof(value);
+            i++;
+        } else if (arg == "--stuck-sda") {
+            config.faults.stuckSda = atof(value);
+            i++;
+        } else if (arg.compare(0, 2, "--") == 0) {
+            fprintf(stderr, "Unknown option %s\n", arg.c_str());
+            return 2;
+        } else if (!parseSteps(arg, steps)) {
+            return 2;
+        }
+    }
+    if (decodePath) {
+        CaptureDump dump;
+        if (!loadCapture(decodePath, dump)) return 2;
+        if (curlUrl.empty()) {
+            printCapture(dump);
+        } else {
+            printCurlReplay(dump, curlUrl);
+        }
+        return 0;
+    }
+    if (steps.empty()) parseSteps(DEFAULT_WORKLOAD, steps);
+    
+    Serial.enabled = verbose;
+    simulator = new Cxn0102Sim(config);
+    simulator->begin(Wire);
+    
+    if (replayPath) {
+        return runReplay(replayPath, config, replay);
+    }
+    
+    i2cComm.begin(notifyCallback);
+    commandHandler.setI2CCommunicator(&i2cComm);
+    deviceInfo.setI2CCommunicator(&i2cComm);
+    moduleUpdater.begin(&i2cComm);
+    loopRunning = true;
+    std::thread loop(loopThread);
+    
+    if (!waitUntil(bootCount, 1, config.bootMs + 1000)) {
+        printf("Module did not boot\n");
+    }
+    if (probe) i2cComm.probeClock();
+    printf("CXN0102 simulator: turnaround %u us, block %u us, clock %lu Hz, split reads %s\n",
+           config.turnaroundUs, config.blockTurnaroundUs,
+           (unsigned long)i2cComm.getClockStats().clockHz, config.splitReads ? "on" : "off");
+    
+    uint32_t totalFailures = 0;
+    for (const Step& step : steps) {
+        i2cComm.resetCommandStats();
+        unsigned long start = micros();
+        StepResult r = runStep(step);
+        unsigned long elapsed = micros() - start;
+        totalFailures += r.failures;
+        
+        printf("\n== %s%s%s: %u ops, %u failed, %.1f ms, %.1f ops/s%s%s\n",
+               step.name.c_str(), step.hasArg ? ":" : "",
+               step.hasArg ? std::to_string(step.arg).c_str() : "",
+               r.ops, r.failures, elapsed / 1000.0,
+               elapsed ? r.ops * 1e6 / elapsed : 0.0,
+               r.note.empty() ? "" : ", ", r.note.c_str());
+        printStats();
+    }
+    printSummary();
+    if (captureOut && !saveCapture(captureOut, busCapture)) totalFailures++;
+    
+    loopRunning = false;
+    loop.join();
+    fflush(stdout);
+    // 固件的工作任务是无限循环的分离线程，直接结束进程
+    _Exit(totalFailures ? 1 : 0);
+}
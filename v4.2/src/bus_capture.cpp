@@ -0,0 +1,86 @@
+#include "bus_capture.h"
+
+BusCapture busCapture;
+
+BusCapture::BusCapture()
+    : head(0), tail(0), used(0), records(0), overwritten(0) {
+    lock = portMUX_INITIALIZER_UNLOCKED;
+}
+
+static void putLE32(uint8_t* out, uint32_t value) {
+    out[0] = value;
+    out[1] = value >> 8;
+    out[2] = value >> 16;
+    out[3] = value >> 24;
+}
+
+void BusCapture::record(uint8_t kind, uint8_t module, uint8_t address, uint8_t status,
+                        const uint8_t* data, uint8_t length, uint32_t timeUs) {
+    if (!data) length = 0;
+    size_t total = CAPTURE_RECORD_HEADER + length;
+    if (total > I2C_CAPTURE_BYTES) return;
+    
+    uint8_t header[CAPTURE_RECORD_HEADER];
+    putLE32(header, timeUs);
+    header[4] = (uint8_t)((module << 4) | (kind & 0x0F));
+    header[5] = address;
+    header[6] = status;
+    header[7] = length;
+    
+    portENTER_CRITICAL(&lock);
+    while (I2C_CAPTURE_BYTES - used < total) {
+        dropOldest();
+    }
+    put(header, CAPTURE_RECORD_HEADER);
+    if (length) put(data, length);
+    used += total;
+    records++;
+    portEXIT_CRITICAL(&lock);
+}
+
+void BusCapture::put(const uint8_t* data, size_t length) {
+    // 记录可以跨越缓冲区末尾，最多分两段拷贝
+    size_t first = I2C_CAPTURE_BYTES - head;
+    if (first > length) first = length;
+    memcpy(buffer + head, data, first);
+    memcpy(buffer, data + first, length - first);
+    head = (head + length) % I2C_CAPTURE_BYTES;
+}
+
+void BusCapture::dropOldest() {
+    uint8_t length = buffer[(tail + CAPTURE_RECORD_HEADER - 1) % I2C_CAPTURE_BYTES];
+    size_t total = CAPTURE_RECORD_HEADER + length;
+    tail = (tail + total) % I2C_CAPTURE_BYTES;
+    used -= total;
+    records--;
+    overwritten++;
+}
+
+size_t BusCapture::dump(uint8_t* out) {
+    memcpy(out, CAPTURE_MAGIC, 4);
+    out[4] = CAPTURE_VERSION;
+    out[5] = CAPTURE_HEADER_SIZE;
+    
+    portENTER_CRITICAL(&lock);
+    out[6] = records;
+    out[7] = records >> 8;
+    putLE32(out + 8, overwritten);
+    putLE32(out + 12, (uint32_t)micros());
+    size_t first = I2C_CAPTURE_BYTES - tail;
+    if (first > used) first = used;
+    memcpy(out + CAPTURE_HEADER_SIZE, buffer + tail, first);
+    memcpy(out + CAPTURE_HEADER_SIZE + first, buffer, used - first);
+    size_t length = CAPTURE_HEADER_SIZE + used;
+    portEXIT_CRITICAL(&lock);
+    return length;
+}
+
+void BusCapture::clear() {
+    portENTER_CRITICAL(&lock);
+    head = 0;
+    tail = 0;
+    used = 0;
+    records = 0;
+    overwritten = 0;
+    portEXIT_CRITICAL(&lock);
+}
@@ -0,0 +1,53 @@
+#ifndef BUS_CAPTURE_H
+#define BUS_CAPTURE_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include "config.h"
+
+// 捕获记录类型（记录头 kind 的低 4 位，高 4 位为模块编号）
+enum CaptureKind : uint8_t {
+    CAPTURE_WRITE = 0,       // status = Wire.endTransmission 返回值
+    CAPTURE_READ = 1,        // status = 请求的字节数，数据为实际读到的字节
+    CAPTURE_COM_REQ = 2      // status = ReplySource（应答）或 0（Notify 上升沿），无数据
+};
+
+// 导出格式（小端）：16 字节文件头 + 按时间顺序的记录
+// 文件头：'C' 'X' 'N' 'C'，版本，头长度，记录数(2)，被覆盖的记录数(4)，导出时的 micros()(4)
+// 记录：micros()(4)，kind，地址，status，数据长度，数据
+#define CAPTURE_MAGIC "CXNC"
+#define CAPTURE_VERSION 1
+#define CAPTURE_HEADER_SIZE 16
+#define CAPTURE_RECORD_HEADER 8
+#define CAPTURE_DUMP_MAX (CAPTURE_HEADER_SIZE + I2C_CAPTURE_BYTES)
+
+// 最近的 I2C 事务的二进制环形记录，常开；满时覆盖最旧的记录
+// 各模块工作任务在持有总线时写入，临界区内只做一次拷贝
+class BusCapture {
+public:
+    BusCapture();
+    
+    void record(uint8_t kind, uint8_t module, uint8_t address, uint8_t status,
+                const uint8_t* data, uint8_t length, uint32_t timeUs);
+    
+    // 按导出格式写入 out，返回字节数；out 至少 CAPTURE_DUMP_MAX 字节
+    size_t dump(uint8_t* out);
+    
+    void clear();
+    
+private:
+    uint8_t buffer[I2C_CAPTURE_BYTES];
+    size_t head;                 // 下一条记录的写入位置
+    size_t tail;                 // 最旧记录的位置
+    size_t used;
+    uint16_t records;
+    uint32_t overwritten;
+    portMUX_TYPE lock;
+    
+    void put(const uint8_t* data, size_t length);
+    void dropOldest();
+};
+
+extern BusCapture busCapture;
+
+#endif // BUS_CAPTURE_H
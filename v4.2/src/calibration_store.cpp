@@ -0,0 +1,185 @@
+#include "calibration_store.h"
+#include <SPIFFS.h>
+#include "storage.h"
+
+static const char* const SNAPSHOT_PATH = "/calibration.bin";
+static const uint8_t SNAPSHOT_MAGIC[4] = {'C', 'A', 'L', 1};   // 最后一字节为格式版本
+
+CalibrationStore::CalibrationStore() : i2cComm(nullptr), pending(false), nextSeq(0), request(), result() {
+}
+
+void CalibrationStore::begin(I2CCommunicator* i2c) {
+    i2cComm = i2c;
+}
+
+uint32_t CalibrationStore::schedule(const CalibrationRequest& request) {
+    uint32_t seq = 0;
+    portENTER_CRITICAL(&lock);
+    if (!pending) {
+        this->request = request;
+        result = CalibrationResult();
+        result.seq = seq = ++nextSeq;
+        pending = true;
+    }
+    portEXIT_CRITICAL(&lock);
+    return seq;
+}
+
+CalibrationResult CalibrationStore::getResult() {
+    portENTER_CRITICAL(&lock);
+    CalibrationResult r = result;
+    portEXIT_CRITICAL(&lock);
+    return r;
+}
+
+void CalibrationStore::process() {
+    portENTER_CRITICAL(&lock);
+    bool run = pending;
+    CalibrationRequest req = request;
+    CalibrationResult r = result;
+    portEXIT_CRITICAL(&lock);
+    if (!run) return;
+    
+    r.done = true;
+    r.code = 200;
+    switch (req.action) {
+        case CAL_ACTION_READ:
+            r.hasSnapshot = read(r.snapshot, req.target);
+            if (!r.hasSnapshot) {
+                r.code = 502;
+                r.message = "Failed to read calibration";
+            }
+            break;
+        case CAL_ACTION_WRITE:
+            write(req, r);
+            break;
+        case CAL_ACTION_CAPTURE:
+            r.hasSnapshot = capture(r.snapshot);
+            if (!r.hasSnapshot) {
+                r.code = 502;
+                r.message = "Failed to capture calibration";
+            }
+            break;
+        case CAL_ACTION_RESTORE:
+            r.error = restore(r.snapshot);
+            r.hasSnapshot = !r.error;
+            if (r.error == I2C_ERROR_INVALID) {
+                r.code = 404;
+                r.message = "No saved snapshot";
+            } else if (r.error) {
+                r.code = 502;
+                r.message = "Restore failed";
+            }
+            break;
+        default:
+            r.hasSnapshot = load(r.snapshot);
+            if (!r.hasSnapshot) {
+                r.code = 404;
+                r.message = "No saved snapshot";
+            }
+            break;
+    }
+    
+    portENTER_CRITICAL(&lock);
+    result = r;
+    pending = false;
+    portEXIT_CRITICAL(&lock);
+}
+
+void CalibrationStore::write(const CalibrationRequest& req, CalibrationResult& r) {
+    I2CCommunicator* module = req.target ? req.target : i2cComm;
+    if (!module) {
+        r.code = 502;
+        r.message = "I2C communicator not set";
+        return;
+    }
+    
+    // 只给出 h 或 v 时，另一组沿用模块当前值
+    OpticalAxisOffsets offsets;
+    bool hasOptical = req.hasH || req.hasV;
+    if (hasOptical && !(req.hasH && req.hasV) && !module->requestOpticalAxis(offsets)) {
+        r.code = 502;
+        r.message = "Failed to read optical axis";
+        return;
+    }
+    if (req.hasH) memcpy(offsets.horizontal, req.values.optical.horizontal, sizeof(offsets.horizontal));
+    if (req.hasV) memcpy(offsets.vertical, req.values.optical.vertical, sizeof(offsets.vertical));
+    
+    if (hasOptical) {
+        r.error = module->setOpticalAxis(offsets);
+    }
+    if (!r.error && req.hasBiPhase) {
+        r.error = module->setBiPhase(req.values.biPhase);
+    }
+    if (r.error) {
+        r.code = 502;
+        r.message = "Calibration write failed";
+    }
+}
+
+bool CalibrationStore::read(CalibrationSnapshot& snapshot, I2CCommunicator* module) {
+    if (!module) module = i2cComm;
+    if (!module) return false;
+    return module->requestOpticalAxis(snapshot.optical) &&
+           module->requestBiPhase(snapshot.biPhase);
+}
+
+uint8_t CalibrationStore::apply(const CalibrationSnapshot& snapshot) {
+    if (!i2cComm) return I2C_ERROR_INVALID;
+    uint8_t error = i2cComm->setOpticalAxis(snapshot.optical);
+    if (error) return error;
+    return i2cComm->setBiPhase(snapshot.biPhase);
+}
+
+bool CalibrationStore::capture(CalibrationSnapshot& snapshot) {
+    if (!read(snapshot)) {
+        Serial.println("[CAL] Failed to read calibration from module");
+        return false;
+    }
+    
+    File file;
+    if (mountStorage()) {
+        file = SPIFFS.open(SNAPSHOT_PATH, "w");
+    }
+    if (!file) {
+        Serial.println("[CAL] Failed to open snapshot file");
+        return false;
+    }
+    bool ok = file.write(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) == sizeof(SNAPSHOT_MAGIC) &&
+              file.write((const uint8_t*)&snapshot, sizeof(snapshot)) == sizeof(snapshot);
+    file.close();
+    
+    Serial.printf("[CAL] Snapshot %s\n", ok ? "saved" : "write failed");
+    return ok;
+}
+
+uint8_t CalibrationStore::restore(CalibrationSnapshot& snapshot) {
+    if (!load(snapshot)) return I2C_ERROR_INVALID;
+    
+    unsigned long start = millis();
+    uint8_t error = apply(snapshot);
+    Serial.printf("[CAL] Snapshot restore %s in %lu ms\n",
+                  error ? "failed" : "done", millis() - start);
+    return error;
+}
+
+bool CalibrationStore::load(CalibrationSnapshot& snapshot) {
+    File file;
+    if (mountStorage() && SPIFFS.exists(SNAPSHOT_PATH)) {
+        file = SPIFFS.open(SNAPSHOT_PATH, "r");
+    }
+    if (!file) {
+        Serial.println("[CAL] No saved snapshot");
+        return false;
+    }
+    uint8_t magic[sizeof(SNAPSHOT_MAGIC)];
+    bool ok = file.read(magic, sizeof(magic)) == sizeof(magic) &&
+              memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) == 0 &&
+              file.read((uint8_t*)&snapshot, sizeof(snapshot)) == sizeof(snapshot);
+    file.close();
+    
+    if (!ok) {
+        Serial.println("[CAL] Snapshot file invalid");
+    }
+    return ok;
+}
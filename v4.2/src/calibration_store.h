@@ -0,0 +1,87 @@
+#ifndef CALIBRATION_STORE_H
+#define CALIBRATION_STORE_H
+
+#include <Arduino.h>
+#include "i2c_communicator.h"
+
+// 一台模块的光学校准快照
+struct CalibrationSnapshot {
+    OpticalAxisOffsets optical;
+    uint32_t biPhase;
+};
+
+// 校准请求的类型
+enum CalibrationAction : uint8_t {
+    CAL_ACTION_READ = 0,     // 读取模块当前值
+    CAL_ACTION_WRITE,        // 写入给出的 h/v/biphase，只给出 h 或 v 时另一组沿用模块当前值
+    CAL_ACTION_CAPTURE,      // 读取模块并保存为快照
+    CAL_ACTION_RESTORE,      // 将保存的快照写回模块
+    CAL_ACTION_LOAD          // 读取保存的快照
+};
+
+// 由HTTP处理函数排入、在 loop 中执行的校准请求
+struct CalibrationRequest {
+    uint8_t action;              // 见 CalibrationAction
+    I2CCommunicator* target;     // READ/WRITE 的目标模块，nullptr 为主模块
+    bool hasH;
+    bool hasV;
+    bool hasBiPhase;
+    CalibrationSnapshot values;  // WRITE 时给出的值
+};
+
+// 最近一次校准请求的结果
+struct CalibrationResult {
+    uint32_t seq;                // 请求序号，0 表示还没有请求
+    bool done;
+    uint16_t code;               // HTTP 状态码（200/404/502）
+    uint8_t error;               // 写入失败时的 I2CResult::error
+    const char* message;         // 失败原因，成功时为 nullptr
+    bool hasSnapshot;            // snapshot 是否有效
+    CalibrationSnapshot snapshot;
+};
+
+// 校准快照：从模块读取光轴/双相位并保存到 SPIFFS，需要时一次写回
+class CalibrationStore {
+public:
+    CalibrationStore();
+    
+    // 设置I2C通信器（SPIFFS 在第一次保存或读取快照时挂载）
+    void begin(I2CCommunicator* i2c);
+    
+    // 排入一个请求并立即返回序号；上一个请求尚未执行时返回 0（供HTTP处理函数调用）
+    uint32_t schedule(const CalibrationRequest& request);
+    
+    // 执行待处理的请求（在loop中调用，0x27/0x29 读取和写入都在这里进行）
+    void process();
+    
+    // 最近一次请求的结果
+    CalibrationResult getResult();
+    
+    // 读取模块当前校准值（module 为 nullptr 时读主模块）
+    bool read(CalibrationSnapshot& snapshot, I2CCommunicator* module = nullptr);
+    
+    // 以绝对值写入模块（0x28 + 0x2A 各一帧）；返回 I2CResult::error
+    uint8_t apply(const CalibrationSnapshot& snapshot);
+    
+    // 读取模块并保存为快照
+    bool capture(CalibrationSnapshot& snapshot);
+    
+    // 将保存的快照写回模块
+    uint8_t restore(CalibrationSnapshot& snapshot);
+    
+    // 读取保存的快照
+    bool load(CalibrationSnapshot& snapshot);
+    
+private:
+    I2CCommunicator* i2cComm;
+    
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    bool pending;
+    uint32_t nextSeq;
+    CalibrationRequest request;
+    CalibrationResult result;
+    
+    void write(const CalibrationRequest& request, CalibrationResult& result);
+};
+
+#endif // CALIBRATION_STORE_H
@@ -1,76 +1,202 @@
 #include "command_handler.h"
 #include "config.h"
-#include <Wire.h>
-
-// 预定义命令表
-const char* CommandHandler::commands[] = {
-    "0100", // 1: Start Input
-    "0200", // 2: Stop Input
-    "0b0101", // 3: Reboot
-    "0b0100", // 4: Shutdown
-    "3200", // 5: Enter Optical Axis Adjustment
-    "3300", // 6: Optical Axis +
-    "3400", // 7: Optical Axis -
-    "350100", // 8: Exit Optical Axis (No Save)
-    "350101", // 9: Exit Optical Axis (Save)
-    "3600", // 10: Enter Bi-Phase Adjustment
-    "3700", // 11: Bi-Phase +
-    "3800", // 12: Bi-Phase -
-    "390100", // 13: Exit Bi-Phase (No Save)
-    "390101", // 14: Exit Bi-Phase (Save)
-    "4A", // 15: Flip Mode
-    "5001", // 16: Test Image ON
-    "5000", // 17: Test Image OFF
-    "6000", // 18: Mute
-    "6001", // 19: Unmute
-    "7000", // 20: Keystone Vertical -
-    "7001", // 21: Keystone Vertical +
-    "7002", // 22: Keystone Horizontal -
-    "7003", // 23: Keystone Horizontal +
-    "8000", // 24: Color Temperature -
-    "8001", // 25: Color Temperature +
-    "4300", // 26: Set Brightness (默认值)
-    "4500", // 27: Set Contrast
-    "4700", // 28: Set Hue
-    "4900", // 29: Set Saturation
-    "4F00", // 30: Set Sharpness
+#include "event_hub.h"
+
+// 预定义命令帧（编译期生成，按索引直接交给I2C工作任务）
+#define CMD_FRAME(name, ...) \
+    constexpr uint8_t name[] = {__VA_ARGS__}; \
+    static_assert(cxnFrameMatchesSpec(name), #name " does not match the CXN0102 spec")
+
+namespace {
+CMD_FRAME(kStartInput,        0x01, 0x00);
+CMD_FRAME(kStopInput,         0x02, 0x00);
+CMD_FRAME(kReboot,            0x0B, 0x01, 0x01);
+CMD_FRAME(kShutdown,          0x0B, 0x01, 0x00);
+CMD_FRAME(kOpticalEnter,      0x32, 0x00);
+CMD_FRAME(kOpticalPlus,       0x33, 0x00);
+CMD_FRAME(kOpticalMinus,      0x34, 0x00);
+CMD_FRAME(kOpticalExit,       0x35, 0x01, 0x00);
+CMD_FRAME(kOpticalExitSave,   0x35, 0x01, 0x01);
+CMD_FRAME(kBiPhaseEnter,      0x36, 0x00);
+CMD_FRAME(kBiPhasePlus,       0x37, 0x00);
+CMD_FRAME(kBiPhaseMinus,      0x38, 0x00);
+CMD_FRAME(kBiPhaseExit,       0x39, 0x01, 0x00);
+CMD_FRAME(kBiPhaseExitSave,   0x39, 0x01, 0x01);
+CMD_FRAME(kFlipMode,          0x4A);
+CMD_FRAME(kTestImageOn,       0x50, 0x01);
+CMD_FRAME(kTestImageOff,      0x50, 0x00);
+CMD_FRAME(kMute,              0x60, 0x00);
+CMD_FRAME(kUnmute,            0x60, 0x01);
+CMD_FRAME(kKeystoneVMinus,    0x70, 0x00);
+CMD_FRAME(kKeystoneVPlus,     0x70, 0x01);
+CMD_FRAME(kKeystoneHMinus,    0x70, 0x02);
+CMD_FRAME(kKeystoneHPlus,     0x70, 0x03);
+CMD_FRAME(kColorTempMinus,    0x80, 0x00);
+CMD_FRAME(kColorTempPlus,     0x80, 0x01);
+// 画质默认值：各分量 0 表示不变（色调/饱和度为 U/V 分量，不是 help.txt 单值格式中的 128）
+CMD_FRAME(kBrightnessDefault, 0x43, 0x01, 0x00);
+CMD_FRAME(kContrastDefault,   0x45, 0x01, 0x00);
+CMD_FRAME(kHueDefault,        0x47, 0x02, 0x00, 0x00);
+CMD_FRAME(kSaturationDefault, 0x49, 0x02, 0x00, 0x00);
+CMD_FRAME(kSharpnessDefault,  0x4F, 0x01, 0x00);
+
+#define CMD_ENTRY(frame, label) { frame, sizeof(frame), label }
+
+// 按 CommandIndex 顺序（索引 - 1）
+constexpr CommandFrame kCommands[] = {
+    CMD_ENTRY(kStartInput,        "Start Input"),                 // 1
+    CMD_ENTRY(kStopInput,         "Stop Input"),                  // 2
+    CMD_ENTRY(kReboot,            "Reboot"),                      // 3
+    CMD_ENTRY(kShutdown,          "Shutdown"),                    // 4
+    CMD_ENTRY(kOpticalEnter,      "Enter Optical Axis Adjustment"), // 5
+    CMD_ENTRY(kOpticalPlus,       "Optical Axis +"),              // 6
+    CMD_ENTRY(kOpticalMinus,      "Optical Axis -"),              // 7
+    CMD_ENTRY(kOpticalExit,       "Exit Optical Axis (No Save)"), // 8
+    CMD_ENTRY(kOpticalExitSave,   "Exit Optical Axis (Save)"),    // 9
+    CMD_ENTRY(kBiPhaseEnter,      "Enter Bi-Phase Adjustment"),   // 10
+    CMD_ENTRY(kBiPhasePlus,       "Bi-Phase +"),                  // 11
+    CMD_ENTRY(kBiPhaseMinus,      "Bi-Phase -"),                  // 12
+    CMD_ENTRY(kBiPhaseExit,       "Exit Bi-Phase (No Save)"),     // 13
+    CMD_ENTRY(kBiPhaseExitSave,   "Exit Bi-Phase (Save)"),        // 14
+    CMD_ENTRY(kFlipMode,          "Flip Mode"),                   // 15
+    CMD_ENTRY(kTestImageOn,       "Test Image ON"),               // 16
+    CMD_ENTRY(kTestImageOff,      "Test Image OFF"),              // 17
+    CMD_ENTRY(kMute,              "Mute"),                        // 18
+    CMD_ENTRY(kUnmute,            "Unmute"),                      // 19
+    CMD_ENTRY(kKeystoneVMinus,    "Keystone Vertical -"),         // 20
+    CMD_ENTRY(kKeystoneVPlus,     "Keystone Vertical +"),         // 21
+    CMD_ENTRY(kKeystoneHMinus,    "Keystone Horizontal -"),       // 22
+    CMD_ENTRY(kKeystoneHPlus,     "Keystone Horizontal +"),       // 23
+    CMD_ENTRY(kColorTempMinus,    "Color Temperature -"),         // 24
+    CMD_ENTRY(kColorTempPlus,     "Color Temperature +"),         // 25
+    CMD_ENTRY(kBrightnessDefault, "Set Brightness (默认值)"),     // 26
+    CMD_ENTRY(kContrastDefault,   "Set Contrast"),                // 27
+    CMD_ENTRY(kHueDefault,        "Set Hue"),                     // 28
+    CMD_ENTRY(kSaturationDefault, "Set Saturation"),              // 29
+    CMD_ENTRY(kSharpnessDefault,  "Set Sharpness"),               // 30
 };
+static_assert(sizeof(kCommands) / sizeof(kCommands[0]) == CMD_COUNT,
+              "CommandIndex and the command table are out of sync");
+
+#undef CMD_ENTRY
+} // namespace
 
-const int CommandHandler::commandCount = sizeof(commands) / sizeof(commands[0]);
+#undef CMD_FRAME
 
-CommandHandler::CommandHandler() {
+CommandHandler::CommandHandler() : i2cComm(nullptr), slots(), nextSeq(0), lastCompleted(0) {
+    for (StatusSlot& slot : slots) {
+        slot.owner = this;
+        slot.status.done = true;
+    }
 }
 
-void CommandHandler::sendCommandByIndex(int index) {
-    if (index < 1 || index > commandCount) {
+void CommandHandler::setI2CCommunicator(I2CCommunicator* i2c) {
+    i2cComm = i2c;
+}
+
+uint32_t CommandHandler::sendCommandByIndex(int index, I2CCommunicator* target) {
+    if (index < 1 || index > CMD_COUNT) {
         Serial.printf("[CMD] Invalid command index: %d\n", index);
-        return;
+        return 0;
     }
-    sendCustomCommand(commands[index - 1]);
+    const CommandFrame& frame = kCommands[index - 1];
+    return submit(frame.bytes, frame.length, target);
 }
 
-void CommandHandler::sendCustomCommand(const char* cmd) {
-    Wire.beginTransmission(I2C_ADDRESS);
-    for (int i = 0; i < (int)strlen(cmd); i += 2) {
+uint32_t CommandHandler::sendCustomCommand(const char* cmd, I2CCommunicator* target) {
+    // 仅 /custom_command 走此十六进制解析路径
+    uint8_t frame[I2C_MAX_FRAME];
+    uint8_t length = 0;
+    size_t cmdLength = strlen(cmd);
+    for (size_t i = 0; i + 1 < cmdLength && length < I2C_MAX_FRAME; i += 2) {
         char byteStr[3] = {cmd[i], cmd[i + 1], '\0'};
-        uint8_t byteVal = (uint8_t)strtol(byteStr, NULL, 16);
-        Wire.write(byteVal);
+        frame[length++] = (uint8_t)strtol(byteStr, NULL, 16);
+    }
+    if (length == 0) return 0;
+    return submit(frame, length, target);
+}
+
+uint32_t CommandHandler::submit(const uint8_t* frame, uint8_t length, I2CCommunicator* target) {
+    I2CCommunicator* i2cComm = target ? target : this->i2cComm;
+    if (!i2cComm) {
+        Serial.println("[CMD] I2C communicator not set!");
+        return 0;
     }
-    uint8_t error = Wire.endTransmission();
-    if (error) {
-        Serial.printf("[CMD] I2C error: %d\n", error);
+    
+    // 优先用最旧的已完成槽位，保留较新的结果供查询
+    portENTER_CRITICAL(&lock);
+    StatusSlot* slot = nullptr;
+    for (StatusSlot& s : slots) {
+        if (s.status.done && (!slot || s.status.seq < slot->status.seq)) slot = &s;
+    }
+    uint32_t seq = 0;
+    if (slot) {
+        seq = ++nextSeq;
+        slot->status = {seq, frame[0], i2cComm->getId(), 0, 0, false};
+    }
+    portEXIT_CRITICAL(&lock);
+    if (!slot) {
+        Serial.printf("[CMD] %d commands still pending, rejected 0x%02X\n", CMD_STATUS_SLOTS, frame[0]);
+        return 0;
+    }
+    
+    // 幂等命令由 I2C 层自动重试；其余命令失败时原样记录，由调用者查询结果
+    if (!i2cComm->submit(frame, length, onCommandComplete, slot)) {
+        portENTER_CRITICAL(&lock);
+        slot->status.error = I2C_ERROR_INVALID;
+        slot->status.done = true;
+        portEXIT_CRITICAL(&lock);
+        return 0;
+    }
+    return seq;
+}
+
+bool CommandHandler::getStatus(uint32_t seq, CommandStatus& status) {
+    bool found = false;
+    portENTER_CRITICAL(&lock);
+    for (const StatusSlot& slot : slots) {
+        if (seq && slot.status.seq == seq) {
+            status = slot.status;
+            found = true;
+        }
+    }
+    portEXIT_CRITICAL(&lock);
+    return found;
+}
+
+bool CommandHandler::getLastCompleted(CommandStatus& status) {
+    portENTER_CRITICAL(&lock);
+    uint32_t seq = lastCompleted;
+    portEXIT_CRITICAL(&lock);
+    return getStatus(seq, status);
+}
+
+void CommandHandler::onCommandComplete(const I2CResult& result, void* ctx) {
+    StatusSlot* slot = static_cast<StatusSlot*>(ctx);
+    CommandHandler* self = slot->owner;
+    portENTER_CRITICAL(&self->lock);
+    slot->status.error = result.error;
+    slot->status.attempts = result.attempts;
+    slot->status.done = true;
+    self->lastCompleted = slot->status.seq;
+    portEXIT_CRITICAL(&self->lock);
+    eventHub.changed(STATE_COMMAND);
+    
+    if (result.error) {
+        Serial.printf("[CMD] I2C error on 0x%02X after %d attempt(s): %d\n",
+                      result.cmd, result.attempts, result.error);
     } else {
         Serial.println("[CMD] Command sent successfully.");
     }
 }
 
 int CommandHandler::getCommandCount() const {
-    return commandCount;
+    return CMD_COUNT;
 }
 
-const char* CommandHandler::getCommand(int index) const {
-    if (index < 0 || index >= commandCount) {
+const CommandFrame* CommandHandler::getCommand(int index) const {
+    if (index < 0 || index >= CMD_COUNT) {
         return nullptr;
     }
-    return commands[index];
+    return &kCommands[index];
 }
@@ -2,26 +2,105 @@
 #define COMMAND_HANDLER_H
 
 #include <Arduino.h>
+#include "i2c_communicator.h"
+#include "cxn0102_protocol.h"
+
+// 预定义命令索引（1起始，与网页 /command?cmd= 一致）
+enum CommandIndex {
+    CMD_START_INPUT = 1,
+    CMD_STOP_INPUT,
+    CMD_REBOOT,
+    CMD_SHUTDOWN,
+    CMD_OPTICAL_ENTER,
+    CMD_OPTICAL_PLUS,
+    CMD_OPTICAL_MINUS,
+    CMD_OPTICAL_EXIT,
+    CMD_OPTICAL_EXIT_SAVE,
+    CMD_BIPHASE_ENTER,
+    CMD_BIPHASE_PLUS,
+    CMD_BIPHASE_MINUS,
+    CMD_BIPHASE_EXIT,
+    CMD_BIPHASE_EXIT_SAVE,
+    CMD_FLIP_MODE,
+    CMD_TEST_IMAGE_ON,
+    CMD_TEST_IMAGE_OFF,
+    CMD_MUTE,
+    CMD_UNMUTE,
+    CMD_KEYSTONE_V_MINUS,
+    CMD_KEYSTONE_V_PLUS,
+    CMD_KEYSTONE_H_MINUS,
+    CMD_KEYSTONE_H_PLUS,
+    CMD_COLOR_TEMP_MINUS,
+    CMD_COLOR_TEMP_PLUS,
+    CMD_BRIGHTNESS_DEFAULT,
+    CMD_CONTRAST_DEFAULT,
+    CMD_HUE_DEFAULT,
+    CMD_SATURATION_DEFAULT,
+    CMD_SHARPNESS_DEFAULT,
+    CMD_COUNT = CMD_SHARPNESS_DEFAULT
+};
+
+// 预编译的命令帧
+struct CommandFrame {
+    const uint8_t* bytes;
+    uint8_t length;
+    const char* label;
+};
+
+// 异步命令的执行结果（完成回调在 I2C 工作任务中写入）
+struct CommandStatus {
+    uint32_t seq;                // 提交序号，从 1 开始
+    uint8_t cmd;
+    uint8_t module;
+    uint8_t error;               // I2CResult::error，done 之后有效
+    uint8_t attempts;
+    bool done;
+};
 
 class CommandHandler {
 public:
     CommandHandler();
     
-    // 根据索引发送预定义命令
-    void sendCommandByIndex(int index);
+    // 设置I2C通信器（所有命令经由其工作任务发送）
+    void setI2CCommunicator(I2CCommunicator* i2c);
     
-    // 发送自定义命令
-    void sendCustomCommand(const char* cmd);
+    // 根据索引异步发送预定义命令，立即返回（可在网页任务中调用）
+    // 返回提交序号，结果由 getStatus 查询；0 = 索引无效、队列已满或结果槽位都未完成
+    // target 为空时发往 setI2CCommunicator 设置的主模块
+    uint32_t sendCommandByIndex(int index, I2CCommunicator* target = nullptr);
+    
+    // 异步发送自定义命令（十六进制串），返回值同 sendCommandByIndex
+    uint32_t sendCustomCommand(const char* cmd, I2CCommunicator* target = nullptr);
+    
+    // 查询最近 CMD_STATUS_SLOTS 个命令之一的结果；已被覆盖时返回 false
+    bool getStatus(uint32_t seq, CommandStatus& status);
+    
+    // 最近完成的命令（SSE command 事件）；还没有时返回 false
+    bool getLastCompleted(CommandStatus& status);
     
     // 获取命令总数
     int getCommandCount() const;
     
-    // 获取命令字符串
-    const char* getCommand(int index) const;
+    // 获取命令帧（0起始）
+    const CommandFrame* getCommand(int index) const;
     
 private:
-    static const char* commands[];
-    static const int commandCount;
+    // 结果槽位；未完成的槽位不会被新命令复用，完成回调的 ctx 指向它
+    struct StatusSlot {
+        CommandHandler* owner;
+        CommandStatus status;
+    };
+    
+    I2CCommunicator* i2cComm;
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    StatusSlot slots[CMD_STATUS_SLOTS];
+    uint32_t nextSeq;
+    uint32_t lastCompleted;
+    
+    uint32_t submit(const uint8_t* frame, uint8_t length, I2CCommunicator* target);
+    
+    // 命令完成后记录并打印结果（在I2C工作任务中执行）
+    static void onCommandComplete(const I2CResult& result, void* ctx);
 };
 
 #endif // COMMAND_HANDLER_H
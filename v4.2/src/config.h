@@ -8,6 +8,77 @@
 #define I2C_ADDRESS 0x77
 #define COM_REQ_PIN 10 // GPIO10 用于 COM_REQ
 
+// ---------------------- I2C Worker ------------------------
+#define I2C_QUEUE_LENGTH 16     // 交互/后台通道各自的待执行事务队列深度
+#define I2C_SAFETY_QUEUE_LENGTH 4    // 安全通道（停止/静音/关机与 Notify 读取）的队列深度
+#define I2C_SAFETY_BOUND_MS 20       // 模块正常应答时安全类事务从提交到完成的上限（模拟器 preempt 步骤断言）
+#define I2C_WIRE_BUFFER 128     // Wire 库单次传输上限（ESP32 I2C_BUFFER_LENGTH）
+#define I2C_MAX_FRAME 32        // 单个事务最大写入/读取字节数
+#define I2C_WORKER_STACK 4096
+#define I2C_WORKER_PRIORITY 3   // 高于 loopTask(1)，低于 async_tcp
+#define COM_REQ_REPLY_TIMEOUT_MS 50  // 等待 COM_REQ 应答的上限（原固定延时）
+#define COM_REQ_POLL_MS 2            // 未收到中断时轮询 COM_REQ 电平的间隔
+#define NOTIFY_RING_SIZE 16          // COM_REQ 事件环形缓冲深度（2 的幂）
+#define NOTIFY_STRAY_RING_SIZE 4     // 等待应答时读到的 Notify 帧缓冲深度（2 的幂）
+#define I2C_STATS_SLOTS 24           // 分命令统计的最大命令数，超出部分计入 0xFF 槽
+#define I2C_STATS_BUCKETS 8          // 延迟直方图桶数
+#define I2C_DEFER_SLOTS 8            // 因模块状态不符而推迟的命令上限
+#define I2C_CLOCK_FAST_HZ 400000     // 启动探测的目标速率（Fast mode）
+#define I2C_CLOCK_SLOW_HZ 100000     // 降速下限（Standard mode）
+#define I2C_PROBE_ROUNDS 3           // 每个速率下连续成功的信息读取轮数
+#define I2C_FALLBACK_WINDOW 32       // 运行期按此事务数统计失败率
+#define I2C_FALLBACK_PERCENT 10      // 窗口内 NACK/短读比例达到该值时降一档
+#define I2C_RETRY_GETTER 3           // 读取类命令的重试次数
+#define I2C_RETRY_SETTER 2           // 幂等设置类命令的重试次数
+#define I2C_RETRY_BASE_MS 2          // 指数退避基数：2、4、8 ms
+#define I2C_REINIT_AFTER 4           // 连续失败该次数后恢复总线并重新初始化 Wire
+#define I2C_CAPTURE_BYTES 4096       // 总线捕获环形缓冲大小（记录头 8 字节 + 数据）
+#define CMD_STATUS_SLOTS 8           // 保留结果的最近异步命令数（/command_status），全部未完成时拒绝新命令
+
+// ---------------------- Write Coalescing ------------------
+#define COALESCE_MIN_INTERVAL_MS 50    // 滑块类写入最快 20Hz 下发到模块
+#define EEPROM_COMMIT_DELAY_MS 1000    // 设置停止变化 1 秒后再提交 EEPROM
+
+// ---------------------- Module Update ---------------------
+#define UPDATE_BLOCK_SIZE 96           // 每个 0x9F 块的数据字节数（帧头 10 字节，合计 ≤ I2C_WIRE_BUFFER）
+#define UPDATE_BLOCK_TIMEOUT_MS 200    // 每块写入后等待 COM_REQ 应答的上限
+#define UPDATE_BUFFER_WAIT_MS 2000     // 等待空闲块缓冲的上限，超时视为模块无响应
+#define UPDATE_STAGING_BYTES 8192      // 网络与总线之间的暂存环（2 的幂）
+#define UPDATE_SLICE_BYTES 4096        // 每个上传请求携带的最大字节数（与网页一致）
+#define UPDATE_IDLE_TIMEOUT_MS 10000   // 两片之间超过此时间没有数据视为上传中断
+
+// ---------------------- Multi-Projector -------------------
+// ESP32-C3 只有一个 I2C 控制器，多个模块（地址同为 0x77）经 TCA9548A 分通道挂在同一总线上
+#define I2C_MUX_ADDRESS 0x00           // 多路复用器地址（TCA9548A 通常为 0x70），0 = 不使用
+#define PROJECTOR_COUNT 1
+#define PROJECTOR_ADDRESSES {I2C_ADDRESS}
+#define PROJECTOR_MUX_CHANNELS {-1}    // 各模块所在复用器通道，-1 = 直连（不切换通道）
+#define PROJECTOR_COM_REQ_PINS {COM_REQ_PIN}
+
+// ---------------------- Macros ----------------------------
+#define MACRO_SLOTS 4                  // 可保存的宏数量
+#define MACRO_MAX_BYTES 160            // 单个宏编译后的字节码上限
+#define MACRO_NAME_LEN 16
+#define MACRO_NOTIFY_TIMEOUT_MS 5000   // notify 步骤未指定超时时的默认值
+#define MACRO_BUTTON_SLOT 0            // 按键触发的宏
+#define MACRO_BUTTON_DEFAULT "cmd 2; wait 100; cmd 4"   // 未保存时按键宏为 Stop Input + Shutdown
+#define MACRO_LOAD_DELAY_MS 10000      // 启动后多久由 loop 载入保存的宏（启动路径上不挂载 SPIFFS）
+
+// ---------------------- Web UI ----------------------------
+#define WEB_UI_PATH "/web_interface.html"   // 网页编译进固件（scripts/web_assets.py）；此文件只发给不接受 gzip 的客户端
+#define WEB_UI_MAX_AGE_S 86400         // 浏览器缓存网页的时间，过期后凭 ETag 重新验证（304）
+#define WS_PATH "/ws"                  // WebSocket 控制通道
+#define WS_MAX_CLIENTS 4               // 超出时拒绝新连接（网页退回 HTTP）
+#define WS_MAX_MESSAGE 128             // 单条控制消息的最大长度
+#define WS_HEARTBEAT_MS 1000           // 心跳间隔，网页据此显示连接状态（代替 /ping 轮询）
+#define SSE_PATH "/events"             // 状态推送（Server-Sent Events）
+#define SSE_MAX_CLIENTS 4
+#define SSE_RETRY_MS 3000              // 断开后浏览器重连的间隔
+#define SSE_CLIENT_BACKLOG 4           // 客户端未发出的消息达到此数时暂停发送，状态事件继续合并
+#define EVENT_NOTIFY_QUEUE 8           // 保留的最近 Notify 帧数（每个客户端最多落后这么多）
+#define BATCH_MAX_BYTES 1024           // POST /batch 正文上限
+#define BATCH_MAX_OPS 32               // 单个批量请求的操作数上限
+
 // ---------------------- Fan PWM -----------------------------
 #define FAN_PWM_PIN 12
 #define FAN_PWM_CHANNEL 0
@@ -15,8 +86,8 @@
 #define FAN_PWM_RES 8          // 0~255
 
 // ---------------------- SoftAP ------------------------------
-const char* AP_SSID = "CXN0102_Web_Controller";
-const char* AP_PASSWORD = "12345678"; // 必须 ≥ 8 字符
+const char* const AP_SSID = "CXN0102_Web_Controller";
+const char* const AP_PASSWORD = "12345678"; // 必须 ≥ 8 字符
 
 // ---------------------- EEPROM Layout -----------------------
 #define EEPROM_SIZE 128 // 扩展到128以存储SSID(32)和PWD(64)
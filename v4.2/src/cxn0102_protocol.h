@@ -0,0 +1,148 @@
+#ifndef CXN0102_PROTOCOL_H
+#define CXN0102_PROTOCOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "config.h"
+
+// CXN0102 Host→模块请求帧格式：CMD, OP0(后续字节数), OP1..OPn
+// 各命令的 OP0 取值见 test/help.txt；返回 -1 表示规格表未收录的命令
+// 例外：help.txt 中 0x47/0x49 为 OP0=1 的单值，本固件自 v3.4 起按 OP0=2 的 U/V 有符号分量
+// （-15~+15，0 为不变）发送，这里记录的是固件实际使用的格式，static_assert 也按此检查
+constexpr int cxnOp0Size(uint8_t cmd) {
+    return cmd == 0x01 ? 0x00 :   // Start Input
+           cmd == 0x02 ? 0x00 :   // Stop Input
+           cmd == 0x03 ? 0x01 :   // Mute
+           cmd == 0x07 ? 0x05 :   // Save All
+           cmd == 0x08 ? 0x00 :   // Factory Reset
+           cmd == 0x0B ? 0x01 :   // Shutdown / Reboot
+           cmd == 0x0C ? 0x01 :   // Stop Input With Picture
+           cmd == 0x25 ? 0x00 :   // Get Output Position
+           cmd == 0x26 ? 0x09 :   // Set Output Position
+           cmd == 0x27 ? 0x00 :   // Get Optical Axis
+           cmd == 0x28 ? 0x0D :   // Set Optical Axis
+           cmd == 0x29 ? 0x00 :   // Get Bi-Phase
+           cmd == 0x2A ? 0x04 :   // Set Bi-Phase
+           cmd == 0x32 ? 0x00 :   // Enter Easy Optical Axis
+           cmd == 0x33 ? 0x00 :   // Optical Axis +
+           cmd == 0x34 ? 0x00 :   // Optical Axis -
+           cmd == 0x35 ? 0x01 :   // Exit Optical Axis (OP1: 0=不保存, 1=保存)
+           cmd == 0x36 ? 0x00 :   // Enter Easy Bi-Phase
+           cmd == 0x37 ? 0x00 :   // Bi-Phase +
+           cmd == 0x38 ? 0x00 :   // Bi-Phase -
+           cmd == 0x39 ? 0x01 :   // Exit Bi-Phase (OP1: 0=不保存, 1=保存)
+           cmd == 0x40 ? 0x00 :   // Get All Picture Quality
+           cmd == 0x41 ? 0x0A :   // Set All Picture Quality
+           cmd == 0x43 ? 0x01 :   // Set Brightness
+           cmd == 0x45 ? 0x01 :   // Set Contrast
+           cmd == 0x47 ? 0x02 :   // Set Hue (U/V，help.txt 为 0x01)
+           cmd == 0x49 ? 0x02 :   // Set Saturation (U/V，help.txt 为 0x01)
+           cmd == 0x4F ? 0x01 :   // Set Sharpness
+           cmd == 0xA0 ? 0x00 :   // Get Temperature
+           cmd == 0xA1 ? 0x00 :   // Get Runtime
+           cmd == 0xA2 ? 0x00 :   // Get Version
+           cmd == 0xA3 ? 0x11 :   // Output Test Picture
+           cmd == 0xB2 ? 0x00 :   // Get LOT Number
+           cmd == 0xB4 ? 0x00 :   // Get Serial Number
+           -1;
+}
+
+// 编译期检查帧长度与 OP0 是否符合规格（未收录的命令不检查）
+template <size_t N>
+constexpr bool cxnFrameMatchesSpec(const uint8_t (&frame)[N]) {
+    return cxnOp0Size(frame[0]) < 0 ||
+           (N >= 2 && frame[1] == cxnOp0Size(frame[0]) && N == 2u + frame[1]);
+}
+
+// Notify/应答帧格式：CMD, SIZE(后续字节数), RESULT, DATA...
+// 模块不支持分段读取或 SIZE 不可信时，按命令使用的读取上限
+constexpr uint8_t cxnNotifyMaxLength(uint8_t cmd) {
+    return cmd == 0x00 ? 4 :    // Boot Completed
+           cmd == 0x10 ? 4 :    // Emergency
+           cmd == 0x11 ? 4 :    // Temperature Emergency / Recovery
+           cmd == 0x12 ? 6 :    // Command Error
+           cmd == 0x25 ? 12 :   // Output Position
+           cmd == 0x27 ? 16 :   // Optical Axis
+           cmd == 0x29 ? 7 :    // Bi-Phase
+           cmd == 0x40 ? 13 :   // All Picture Quality
+           cmd == 0xA0 ? 6 :    // Temperature
+           cmd == 0xA1 ? 7 :    // Runtime
+           cmd == 0xA2 ? 15 :   // Version
+           cmd == 0xB2 ? 15 :   // LOT Number
+           cmd == 0xB4 ? 11 :   // Serial Number
+           32;
+}
+
+// 模块运行状态（位掩码，便于表示命令允许的状态集合）
+enum CxnState : uint8_t {
+    CXN_STATE_READY   = 1 << 0,   // 未输出输入信号
+    CXN_STATE_ACTIVE  = 1 << 1,   // 正在输出输入信号
+    CXN_STATE_OPTICAL = 1 << 2,   // 简单光轴调整中
+    CXN_STATE_BIPHASE = 1 << 3,   // 简单双相位调整中
+    CXN_STATE_ANY     = 0x0F
+};
+
+// 各命令允许发出的状态（见 test/help.txt “状态限制”列），未收录的命令不限制
+constexpr uint8_t cxnAllowedStates(uint8_t cmd) {
+    return cmd == 0x01 ? CXN_STATE_READY :                    // Start Input
+           cmd == 0x02 ? CXN_STATE_ACTIVE :                   // Stop Input
+           cmd == 0x0C ? CXN_STATE_ACTIVE :                   // Stop Input With Picture
+           cmd == 0x03 ? CXN_STATE_READY | CXN_STATE_ACTIVE : // Mute
+           cmd == 0x07 ? CXN_STATE_READY | CXN_STATE_ACTIVE : // Save All
+           cmd == 0x08 ? CXN_STATE_READY :                    // Factory Reset
+           cmd == 0x0B ? CXN_STATE_READY | CXN_STATE_ACTIVE : // Shutdown / Reboot
+           (cmd >= 0x25 && cmd <= 0x2A) ? CXN_STATE_READY | CXN_STATE_ACTIVE :
+           cmd == 0x32 ? CXN_STATE_READY :                    // Enter Easy Optical Axis
+           (cmd >= 0x33 && cmd <= 0x35) ? CXN_STATE_OPTICAL :
+           cmd == 0x36 ? CXN_STATE_READY :                    // Enter Easy Bi-Phase
+           (cmd >= 0x37 && cmd <= 0x39) ? CXN_STATE_BIPHASE :
+           (cmd == 0x43 || cmd == 0x45 || cmd == 0x47 ||
+            cmd == 0x49 || cmd == 0x4F) ? CXN_STATE_ACTIVE :  // 单项画质设置
+           (cmd >= 0x40 && cmd <= 0x4E) ? CXN_STATE_READY | CXN_STATE_ACTIVE :
+           cmd == 0xA3 ? CXN_STATE_READY :                    // Output Test Picture
+           (cmd >= 0x82 && cmd <= 0xA2) ? CXN_STATE_READY | CXN_STATE_ACTIVE :
+           CXN_STATE_ANY;
+}
+
+// 状态不符时可以推迟到下一次合适的状态再发送的命令
+// 切换/调整类命令的意图是“立即”，推迟没有意义，直接拒绝
+constexpr bool cxnDeferrable(uint8_t cmd) {
+    return !(cmd == 0x01 || cmd == 0x02 || cmd == 0x0C || (cmd >= 0x32 && cmd <= 0x39));
+}
+
+// 推迟队列中同一命令只保留最新值的设置类命令
+constexpr bool cxnLatestWins(uint8_t cmd) {
+    return cmd == 0x26 || cmd == 0x28 || cmd == 0x2A || cmd == 0x41 || cmd == 0x43 ||
+           cmd == 0x45 || cmd == 0x47 || cmd == 0x49 || cmd == 0x4F || cmd == 0xA3;
+}
+
+// 写入失败（NACK/总线错误）时自动重试的次数
+// 只重试幂等命令；步进、开始/停止、重启、更新块等重复执行会改变结果的命令不重试
+constexpr uint8_t cxnRetryBudget(uint8_t cmd) {
+    return (cmd == 0x25 || cmd == 0x27 || cmd == 0x29 || cmd == 0x40 ||
+            cmd == 0x42 || cmd == 0x44 || cmd == 0x46 || cmd == 0x48 || cmd == 0x4E ||
+            (cmd >= 0xA0 && cmd <= 0xA2) || cmd == 0xB2 || cmd == 0xB4) ? I2C_RETRY_GETTER :
+           (cmd == 0x03 || cmd == 0x07 || cmd == 0x26 || cmd == 0x28 || cmd == 0x2A ||
+            cmd == 0x41 || cmd == 0x43 || cmd == 0x45 || cmd == 0x47 || cmd == 0x49 ||
+            cmd == 0x4F || cmd == 0x60 || cmd == 0xA3) ? I2C_RETRY_SETTER :
+           0;
+}
+
+// 总线优先级通道：工作任务在事务之间总是先执行更高优先级通道中排队的事务
+enum CxnLane : uint8_t {
+    CXN_LANE_SAFETY = 0,          // 停止输入、静音（0x03 与网页使用的 0x60）、关机/重启，以及 Notify 读取
+    CXN_LANE_INTERACTIVE,         // 用户操作：几何、画质、调整、测试图案、保存等
+    CXN_LANE_BACKGROUND,          // 遥测信息读取与模块固件更新
+    CXN_LANE_COUNT
+};
+
+// 命令所属的通道（只读的 Notify 事务固定为安全通道）
+// 0x60 为厂商静音帧（0x60 0x00 静音 / 0x60 0x01 取消静音），即网页 Mute/Unmute 实际发出的命令
+constexpr uint8_t cxnLane(uint8_t cmd) {
+    return (cmd == 0x02 || cmd == 0x03 || cmd == 0x0B || cmd == 0x0C || cmd == 0x60) ? CXN_LANE_SAFETY :
+           ((cmd >= 0xA0 && cmd <= 0xA2) || cmd == 0xB2 || cmd == 0xB4 ||
+            cmd == 0x82 || cmd == 0x84 || cmd == 0x92 || cmd == 0x94 || cmd == 0x9F) ? CXN_LANE_BACKGROUND :
+           CXN_LANE_INTERACTIVE;
+}
+
+#endif // CXN0102_PROTOCOL_H
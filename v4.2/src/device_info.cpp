@@ -1,10 +1,29 @@
 #include "device_info.h"
+#include "event_hub.h"
 
-DeviceInfoManager::DeviceInfoManager() : i2cComm(nullptr) {
+DeviceInfoManager::DeviceInfoManager()
+    : i2cComm(nullptr), reconcile(), refreshAllPending(false), refreshTempPending(false),
+      infoLock(nullptr) {
 }
 
 void DeviceInfoManager::setI2CCommunicator(I2CCommunicator* i2c) {
     i2cComm = i2c;
+    if (!infoLock) infoLock = xSemaphoreCreateMutex();
+}
+
+void DeviceInfoManager::lockInfo() const {
+    if (infoLock) xSemaphoreTake(infoLock, portMAX_DELAY);
+}
+
+void DeviceInfoManager::unlockInfo() const {
+    if (infoLock) xSemaphoreGive(infoLock);
+}
+
+String DeviceInfoManager::copyField(const String& field) const {
+    lockInfo();
+    String copy = field;
+    unlockInfo();
+    return copy;
 }
 
 void DeviceInfoManager::requestAllInfo() {
@@ -15,22 +34,13 @@ void DeviceInfoManager::requestAllInfo() {
     
     Serial.println("[DEVICE] ===== Requesting all device information =====");
     
-    // 依次请求所有信息，增加延迟避免冲突
-    if (requestTemperature()) {
-        delay(400);
-    }
-    if (requestRuntime()) {
-        delay(400);
-    }
-    if (requestVersion()) {
-        delay(400);
-    }
-    if (requestLOTNumber()) {
-        delay(400);
-    }
-    if (requestSerialNumber()) {
-        delay(400);
-    }
+    // 依次请求所有信息：工作任务串行执行并等待 COM_REQ，不需要额外延迟
+    // 这些读取在后台通道，期间提交的停止/静音等命令会在两次读取之间插队
+    requestTemperature();
+    requestRuntime();
+    requestVersion();
+    requestLOTNumber();
+    requestSerialNumber();
     
     info.infoValid = true;
     info.lastUpdate = millis();
@@ -41,10 +51,10 @@ void DeviceInfoManager::requestAllInfo() {
 bool DeviceInfoManager::requestTemperature() {
     if (!i2cComm) return false;
     
-    bool success = i2cComm->requestTemperature(info.temperature, 
-                                                info.muteThreshold, 
-                                                info.stopThreshold);
+    int temp, mute, stop;
+    bool success = i2cComm->requestTemperature(temp, mute, stop);
     if (success) {
+        setTemperature(temp, mute, stop);
         info.lastUpdate = millis();
     }
     return success;
@@ -63,10 +73,15 @@ bool DeviceInfoManager::requestRuntime() {
 bool DeviceInfoManager::requestVersion() {
     if (!i2cComm) return false;
     
-    bool success = i2cComm->requestVersion(info.firmwareVersion,
-                                            info.parameterVersion,
-                                            info.dataVersion);
+    // 先读入局部变量，只在锁内替换字段
+    String firmware, parameter, data;
+    bool success = i2cComm->requestVersion(firmware, parameter, data);
     if (success) {
+        lockInfo();
+        info.firmwareVersion = firmware;
+        info.parameterVersion = parameter;
+        info.dataVersion = data;
+        unlockInfo();
         info.lastUpdate = millis();
     }
     return success;
@@ -75,8 +90,12 @@ bool DeviceInfoManager::requestVersion() {
 bool DeviceInfoManager::requestLOTNumber() {
     if (!i2cComm) return false;
     
-    bool success = i2cComm->requestLOTNumber(info.lotNumber);
+    String lotNumber;
+    bool success = i2cComm->requestLOTNumber(lotNumber);
     if (success) {
+        lockInfo();
+        info.lotNumber = lotNumber;
+        unlockInfo();
         info.lastUpdate = millis();
     }
     return success;
@@ -85,25 +104,131 @@ bool DeviceInfoManager::requestLOTNumber() {
 bool DeviceInfoManager::requestSerialNumber() {
     if (!i2cComm) return false;
     
-    bool success = i2cComm->requestSerialNumber(info.serialNumber);
+    String serialNumber;
+    bool success = i2cComm->requestSerialNumber(serialNumber);
     if (success) {
+        lockInfo();
+        info.serialNumber = serialNumber;
+        unlockInfo();
         info.lastUpdate = millis();
     }
     return success;
 }
 
-const DeviceInfo& DeviceInfoManager::getInfo() const {
-    return info;
+DeviceInfo DeviceInfoManager::getInfo() const {
+    lockInfo();
+    DeviceInfo copy = info;
+    unlockInfo();
+    return copy;
 }
 
 void DeviceInfoManager::updateTemperature(int temp, int mute, int stop) {
+    setTemperature(temp, mute, stop);
+    info.lastUpdate = millis();
+    info.infoValid = true;
+}
+
+void DeviceInfoManager::setTemperature(int temp, int mute, int stop) {
+    bool changed = temp != info.temperature || mute != info.muteThreshold || stop != info.stopThreshold;
     info.temperature = temp;
     info.muteThreshold = mute;
     info.stopThreshold = stop;
-    info.lastUpdate = millis();
-    info.infoValid = true;
+    // 只有数值变化才推送给网页
+    if (changed) {
+        eventHub.changed(STATE_TEMPERATURE);
+    }
+}
+
+void DeviceInfoManager::scheduleRefresh(bool allInfo) {
+    if (allInfo) {
+        refreshAllPending = true;
+    } else {
+        refreshTempPending = true;
+    }
+}
+
+void DeviceInfoManager::process() {
+    if (refreshAllPending) {
+        refreshAllPending = false;
+        refreshTempPending = false;
+        requestAllInfo();
+    } else if (refreshTempPending) {
+        refreshTempPending = false;
+        requestTemperature();
+    }
 }
 
 bool DeviceInfoManager::isInfoExpired(unsigned long timeoutMs) const {
     return !info.infoValid || (millis() - info.lastUpdate > timeoutMs);
 }
+
+static uint8_t diffGeometry(const SystemSettings& s, int pan, int tilt, int flip) {
+    uint8_t diff = 0;
+    if (s.pan != pan) diff |= RECONCILE_PAN;
+    if (s.tilt != tilt) diff |= RECONCILE_TILT;
+    if (s.flip != flip) diff |= RECONCILE_FLIP;
+    return diff;
+}
+
+static uint8_t diffPictureQuality(const PictureQualityValues& a, const PictureQualityValues& b) {
+    uint8_t diff = 0;
+    if (a.brightness != b.brightness) diff |= RECONCILE_BRIGHTNESS;
+    if (a.contrast != b.contrast) diff |= RECONCILE_CONTRAST;
+    if (a.hueU != b.hueU || a.hueV != b.hueV) diff |= RECONCILE_HUE;
+    if (a.satU != b.satU || a.satV != b.satV) diff |= RECONCILE_SATURATION;
+    if (a.sharpness != b.sharpness) diff |= RECONCILE_SHARPNESS;
+    return diff;
+}
+
+void DeviceInfoManager::reconcileSettings(EEPROMManager& eeprom) {
+    if (!i2cComm) {
+        Serial.println("[DEVICE] I2C communicator not set!");
+        return;
+    }
+    
+    reconcile = ReconcileReport();
+    SystemSettings settings = eeprom.getSettings();
+    
+    // 读取成功时 I2CCommunicator 会同步影子寄存器，之后相同的值不会再写入
+    int pan = 0, tilt = 0, flip = 0;
+    PictureQualityValues modulePQ;
+    reconcile.geometryRead = i2cComm->requestOutputPosition(pan, tilt, flip);
+    reconcile.pqRead = i2cComm->requestPictureQuality(modulePQ);
+    
+    uint8_t diff = 0;
+    if (reconcile.geometryRead) diff |= diffGeometry(settings, pan, tilt, flip);
+    if (reconcile.pqRead) {
+        diff |= diffPictureQuality(I2CCommunicator::encodePictureQuality(settings), modulePQ);
+    }
+    
+    if (!eeprom.hasSavedSettings() && (reconcile.geometryRead || reconcile.pqRead)) {
+        // EEPROM 刚写入默认值：模块上的值更新，写回 EEPROM
+        if (reconcile.geometryRead) {
+            settings.pan = pan;
+            settings.tilt = tilt;
+            settings.flip = flip;
+        }
+        if (reconcile.pqRead) {
+            I2CCommunicator::decodePictureQuality(modulePQ, settings);
+        }
+        reconcile.eepromStale = diff;
+        if (diff) eeprom.saveSettings(settings);
+    } else {
+        // 以 EEPROM 为准；未能读取的部分视为不一致，照常写入
+        if (!reconcile.geometryRead) diff |= RECONCILE_GEOMETRY;
+        if (!reconcile.pqRead) diff |= RECONCILE_PQ;
+        reconcile.moduleStale = diff;
+        if (diff & RECONCILE_GEOMETRY) {
+            i2cComm->sendKeystoneAndFlip(settings.pan, settings.tilt, settings.flip);
+        }
+        if (diff & RECONCILE_PQ) {
+            i2cComm->sendPictureQuality(settings);
+        }
+    }
+    reconcile.done = true;
+    
+    Serial.printf("[DEVICE] Reconcile: position %s, PQ %s, module stale 0x%02X, EEPROM stale 0x%02X\n",
+                  reconcile.geometryRead ? "read" : "unavailable",
+                  reconcile.pqRead ? "read" : "unavailable",
+                  reconcile.moduleStale, reconcile.eepromStale);
+}
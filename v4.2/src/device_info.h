@@ -2,6 +2,8 @@
 #define DEVICE_INFO_H
 
 #include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 #include "i2c_communicator.h"
 
 // 设备信息结构体
@@ -25,11 +27,35 @@ struct DeviceInfo {
                    infoValid(false), lastUpdate(0) {}
 };
 
+// 启动对账涉及的字段
+enum ReconcileField : uint8_t {
+    RECONCILE_PAN        = 1 << 0,
+    RECONCILE_TILT       = 1 << 1,
+    RECONCILE_FLIP       = 1 << 2,
+    RECONCILE_BRIGHTNESS = 1 << 3,
+    RECONCILE_CONTRAST   = 1 << 4,
+    RECONCILE_HUE        = 1 << 5,
+    RECONCILE_SATURATION = 1 << 6,
+    RECONCILE_SHARPNESS  = 1 << 7,
+    RECONCILE_GEOMETRY   = RECONCILE_PAN | RECONCILE_TILT | RECONCILE_FLIP,
+    RECONCILE_PQ         = RECONCILE_BRIGHTNESS | RECONCILE_CONTRAST | RECONCILE_HUE |
+                           RECONCILE_SATURATION | RECONCILE_SHARPNESS
+};
+
+// 启动对账结果：各掩码为 ReconcileField 组合
+struct ReconcileReport {
+    bool done;
+    bool geometryRead;       // 0x25 读取成功
+    bool pqRead;             // 0x40 读取成功
+    uint8_t moduleStale;     // 模块一侧过期、已按 EEPROM 重新写入的字段
+    uint8_t eepromStale;     // EEPROM 一侧过期、已采用模块值的字段
+};
+
 class DeviceInfoManager {
 public:
     DeviceInfoManager();
     
-    // 设置I2C通信器
+    // 设置I2C通信器（同时创建字符串字段的锁）
     void setI2CCommunicator(I2CCommunicator* i2c);
     
     // 请求所有设备信息
@@ -50,19 +76,20 @@ public:
     // 请求序列号
     bool requestSerialNumber();
     
-    // 获取设备信息
-    const DeviceInfo& getInfo() const;
+    // 获取设备信息（副本）
+    DeviceInfo getInfo() const;
     
     // 单个信息getter方法
+    // 字符串字段由 loop() 重写，网页任务读取时在锁内复制
     int getTemperature() const { return info.temperature; }
     int getMuteThreshold() const { return info.muteThreshold; }
     int getStopThreshold() const { return info.stopThreshold; }
     unsigned long getRuntime() const { return info.runtime; }
-    String getFirmwareVersion() const { return info.firmwareVersion; }
-    String getParameterVersion() const { return info.parameterVersion; }
-    String getDataVersion() const { return info.dataVersion; }
-    String getLotNumber() const { return info.lotNumber; }
-    String getSerialNumber() const { return info.serialNumber; }
+    String getFirmwareVersion() const { return copyField(info.firmwareVersion); }
+    String getParameterVersion() const { return copyField(info.parameterVersion); }
+    String getDataVersion() const { return copyField(info.dataVersion); }
+    String getLotNumber() const { return copyField(info.lotNumber); }
+    String getSerialNumber() const { return copyField(info.serialNumber); }
     
     // 更新温度信息（从notify回调）
     void updateTemperature(int temp, int mute, int stop);
@@ -70,12 +97,32 @@ public:
     // 请求所有信息（别名）
     void requestAll() { requestAllInfo(); }
     
+    // 安排在loop中刷新（供HTTP处理函数调用，不阻塞async_tcp任务）
+    void scheduleRefresh(bool allInfo);
+    
+    // 执行已安排的刷新（在loop中调用）
+    void process();
+    
+    // 启动对账：读取模块当前几何(0x25)与画质(0x40)，与 EEPROM 比较后只同步不一致的一侧
+    // EEPROM 有保存的设置时以其为准写入模块，否则（首次启动/已清除）采用模块的值
+    void reconcileSettings(EEPROMManager& eeprom);
+    const ReconcileReport& getReconcileReport() const { return reconcile; }
+    
     // 检查信息是否过期
     bool isInfoExpired(unsigned long timeoutMs = 60000) const;
     
 private:
     I2CCommunicator* i2cComm;
     DeviceInfo info;
+    ReconcileReport reconcile;
+    volatile bool refreshAllPending;
+    volatile bool refreshTempPending;
+    SemaphoreHandle_t infoLock;      // 保护 info 中的 String（重新分配期间不能被读取）
+    
+    void setTemperature(int temp, int mute, int stop);
+    void lockInfo() const;
+    void unlockInfo() const;
+    String copyField(const String& field) const;
 };
 
 #endif // DEVICE_INFO_H
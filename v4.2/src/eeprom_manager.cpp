@@ -7,12 +7,17 @@ static inline int clamp(int v, int lo, int hi) {
     return v < lo ? lo : (v > hi ? hi : v); 
 }
 
-EEPROMManager::EEPROMManager() : isValid(false) {
+EEPROMManager::EEPROMManager()
+    : isValid(false), loadedDefaults(false), settingsMutex(nullptr), dirty(false), dirtySince(0) {
 }
 
 void EEPROMManager::begin() {
     EEPROM.begin(EEPROM_SIZE);
+    settingsMutex = xSemaphoreCreateMutex();
     isValid = true;
+    
+    // 填充缓存，getSettings() 之后即可使用
+    loadSettings(currentSettings);
 }
 
 void EEPROMManager::loadSettings(SystemSettings& settings) {
@@ -44,6 +49,7 @@ void EEPROMManager::loadSettings(SystemSettings& settings) {
         settings.fanMode = DEFAULT_FAN_MODE;
         settings.wifiConfigured = false;
         
+        loadedDefaults = true;
         saveSettings(settings);
         Serial.println("[EEPROM] Initialized defaults.");
         return;
@@ -110,6 +116,36 @@ void EEPROMManager::saveSettings(const SystemSettings& settings) {
         return;
     }
     
+    xSemaphoreTake(settingsMutex, portMAX_DELAY);
+    writeSettings(settings);
+    xSemaphoreGive(settingsMutex);
+}
+
+void EEPROMManager::stageSettings(const SystemSettings& settings) {
+    if (!isValid) {
+        Serial.println("[EEPROM] Not initialized!");
+        return;
+    }
+    
+    xSemaphoreTake(settingsMutex, portMAX_DELAY);
+    currentSettings = settings;
+    dirty = true;
+    dirtySince = millis();
+    xSemaphoreGive(settingsMutex);
+}
+
+void EEPROMManager::commitIfIdle(unsigned long idleMs) {
+    if (!isValid || !dirty || millis() - dirtySince < idleMs) return;
+    
+    xSemaphoreTake(settingsMutex, portMAX_DELAY);
+    if (dirty) {
+        SystemSettings settings = currentSettings;
+        writeSettings(settings);
+    }
+    xSemaphoreGive(settingsMutex);
+}
+
+void EEPROMManager::writeSettings(const SystemSettings& settings) {
     // 保存数值设置
     EEPROM.write(ADDR_PAN, (int8_t)settings.pan);
     EEPROM.write(ADDR_TILT, (int8_t)settings.tilt);
@@ -129,12 +165,12 @@ void EEPROMManager::saveSettings(const SystemSettings& settings) {
     EEPROM.write(ADDR_FAN_MODE, settings.fanMode);
     
     // 保存SSID
-    for (int i = 0; i < 32; i++) {
+    for (unsigned int i = 0; i < 32; i++) {
         EEPROM.write(ADDR_SSID + i, i < settings.ssid.length() ? settings.ssid[i] : 0);
     }
     
     // 保存PWD
-    for (int i = 0; i < 64; i++) {
+    for (unsigned int i = 0; i < 64; i++) {
         EEPROM.write(ADDR_PWD + i, i < settings.pwd.length() ? settings.pwd[i] : 0);
     }
     
@@ -143,11 +179,16 @@ void EEPROMManager::saveSettings(const SystemSettings& settings) {
     
     // 更新缓存
     currentSettings = settings;
+    dirty = false;
     Serial.println("[EEPROM] Settings saved.");
 }
 
 SystemSettings EEPROMManager::getSettings() {
-    return currentSettings;
+    if (!settingsMutex) return currentSettings;
+    xSemaphoreTake(settingsMutex, portMAX_DELAY);
+    SystemSettings settings = currentSettings;
+    xSemaphoreGive(settingsMutex);
+    return settings;
 }
 
 void EEPROMManager::clearAll() {
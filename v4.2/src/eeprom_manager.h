@@ -2,6 +2,8 @@
 #define EEPROM_MANAGER_H
 
 #include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 
 // 系统设置结构体
 struct SystemSettings {
@@ -38,15 +40,30 @@ public:
     // 保存设置
     void saveSettings(const SystemSettings& settings);
     
+    // 只更新缓存并标记待提交（高频写入时使用，避免每次都 commit）
+    void stageSettings(const SystemSettings& settings);
+    
+    // 待提交设置在 idleMs 内没有再变化时写入 EEPROM（在loop中调用）
+    void commitIfIdle(unsigned long idleMs);
+    
     // 获取当前设置
     SystemSettings getSettings();
     
     // 清除所有设置
     void clearAll();
     
+    // 启动时 EEPROM 中是否已有保存的设置（否则为刚写入的默认值）
+    bool hasSavedSettings() const { return !loadedDefaults; }
+    
 private:
     bool isValid;
+    bool loadedDefaults;
     SystemSettings currentSettings;
+    SemaphoreHandle_t settingsMutex;   // 缓存同时被 async_tcp 与 loop 访问
+    bool dirty;
+    unsigned long dirtySince;
+    
+    void writeSettings(const SystemSettings& settings);
 };
 
 #endif // EEPROM_MANAGER_H
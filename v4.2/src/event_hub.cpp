@@ -0,0 +1,50 @@
+#include "event_hub.h"
+
+EventHub eventHub;
+
+EventHub::EventHub() : versions(), notifies(), notifySeq(0) {
+    lock = portMUX_INITIALIZER_UNLOCKED;
+}
+
+void EventHub::changed(uint8_t type) {
+    if (type >= STATE_EVENT_COUNT) return;
+    portENTER_CRITICAL(&lock);
+    versions[type]++;
+    portEXIT_CRITICAL(&lock);
+}
+
+void EventHub::notify(uint8_t module, const uint8_t* frame, uint8_t length) {
+    if (length > I2C_MAX_FRAME) length = I2C_MAX_FRAME;
+    portENTER_CRITICAL(&lock);
+    notifySeq++;
+    NotifyRecord& event = notifies[notifySeq % EVENT_NOTIFY_QUEUE];
+    event.seq = notifySeq;
+    event.module = module;
+    event.length = length;
+    memcpy(event.frame, frame, length);
+    portEXIT_CRITICAL(&lock);
+}
+
+uint32_t EventHub::getVersion(uint8_t type) {
+    if (type >= STATE_EVENT_COUNT) return 0;
+    portENTER_CRITICAL(&lock);
+    uint32_t version = versions[type];
+    portEXIT_CRITICAL(&lock);
+    return version;
+}
+
+uint32_t EventHub::getNotifySeq() {
+    portENTER_CRITICAL(&lock);
+    uint32_t seq = notifySeq;
+    portEXIT_CRITICAL(&lock);
+    return seq;
+}
+
+bool EventHub::getNotify(uint32_t seq, NotifyRecord& event) {
+    portENTER_CRITICAL(&lock);
+    const NotifyRecord& slot = notifies[seq % EVENT_NOTIFY_QUEUE];
+    bool found = seq != 0 && slot.seq == seq;
+    if (found) event = slot;
+    portEXIT_CRITICAL(&lock);
+    return found;
+}
@@ -0,0 +1,51 @@
+#ifndef EVENT_HUB_H
+#define EVENT_HUB_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include "config.h"
+
+// 推送给网页的状态类型；发送时读取当前值，同一类型的多次变化合并为一条
+enum StateEvent : uint8_t {
+    STATE_TEMPERATURE = 0,   // DeviceInfoManager 温度/阈值
+    STATE_FAN,               // 风扇模式/PWM
+    STATE_WIFI,              // AP/STA 切换、连接、断开
+    STATE_COMMAND,           // CommandHandler 异步命令完成
+    STATE_EVENT_COUNT
+};
+
+// 一个模块 Notify 帧（CMD/SIZE/RESULT/数据）
+struct NotifyRecord {
+    uint32_t seq;
+    uint8_t module;          // 发出该 Notify 的模块 ID
+    uint8_t length;
+    uint8_t frame[I2C_MAX_FRAME];
+};
+
+// 状态变化与 Notify 的发布点，可在任意任务中调用：生产者只递增版本号或写入环形缓冲，
+// 不格式化也不发送。WebServer 在 loop() 中比较每个客户端已发送的版本和序号再推送
+class EventHub {
+public:
+    EventHub();
+    
+    void changed(uint8_t type);
+    void notify(uint8_t module, const uint8_t* frame, uint8_t length);
+    
+    uint32_t getVersion(uint8_t type);
+    
+    // 最后一个 Notify 的序号（从 1 开始），0 = 还没有
+    uint32_t getNotifySeq();
+    
+    // 取序号为 seq 的 Notify；已被覆盖或还不存在时返回 false
+    bool getNotify(uint32_t seq, NotifyRecord& event);
+    
+private:
+    uint32_t versions[STATE_EVENT_COUNT];
+    NotifyRecord notifies[EVENT_NOTIFY_QUEUE];
+    uint32_t notifySeq;
+    portMUX_TYPE lock;
+};
+
+extern EventHub eventHub;
+
+#endif // EVENT_HUB_H
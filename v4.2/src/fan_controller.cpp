@@ -1,5 +1,6 @@
 #include "fan_controller.h"
 #include "config.h"
+#include "event_hub.h"
 
 FanController::FanController() : fanMode(DEFAULT_FAN_MODE), fanPwmValue(0) {
 }
@@ -15,10 +16,16 @@ void FanController::begin() {
 }
 
 void FanController::setMode(uint8_t mode) {
+    if (mode != fanMode) {
+        eventHub.changed(STATE_FAN);
+    }
     fanMode = mode;
     
     if (fanMode == 4) {
         // Full模式：最大PWM
+        if (fanPwmValue != 255) {
+            eventHub.changed(STATE_FAN);
+        }
         fanPwmValue = 255;
         ledcWrite(FAN_PWM_CHANNEL, fanPwmValue);
         Serial.printf("[Fan] Full mode, PWM=%u\n", fanPwmValue);
@@ -81,12 +88,16 @@ void FanController::adjustSpeed(int temperature) {
     }
     
     // 计算PWM值
+    uint8_t previous = fanPwmValue;
     fanPwmValue = (uint8_t)(curve.pwm_min + curved * (curve.pwm_max - curve.pwm_min));
     
     // 确保PWM在有效范围内
     fanPwmValue = constrain(fanPwmValue, curve.pwm_min, curve.pwm_max);
     
     ledcWrite(FAN_PWM_CHANNEL, fanPwmValue);
+    if (fanPwmValue != previous) {
+        eventHub.changed(STATE_FAN);
+    }
     
     Serial.printf("[Fan] Mode=%d Temp=%d°C PWM=%u (Curve: %d-%d°C -> %d-%d PWM, factor=%.1f)\n",
                   fanMode, temperature, fanPwmValue,
@@ -96,6 +107,9 @@ void FanController::adjustSpeed(int temperature) {
 }
 
 void FanController::setPWM(uint8_t pwm) {
+    if (pwm != fanPwmValue) {
+        eventHub.changed(STATE_FAN);
+    }
     fanPwmValue = pwm;
     ledcWrite(FAN_PWM_CHANNEL, fanPwmValue);
     Serial.printf("[Fan] PWM set to %u\n", fanPwmValue);
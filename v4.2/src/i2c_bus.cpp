@@ -0,0 +1,73 @@
+#include "i2c_bus.h"
+
+I2CBus sharedI2CBus(Wire, SDA_PIN, SCL_PIN, I2C_MUX_ADDRESS);
+
+I2CBus::I2CBus(TwoWire& wire, int8_t sdaPin, int8_t sclPin, uint8_t muxAddress)
+    : bus(wire), sdaPin(sdaPin), sclPin(sclPin), muxAddress(muxAddress),
+      mutex(nullptr), selectedChannel(-1), clockHz(0) {
+}
+
+void I2CBus::begin(uint32_t hz) {
+    if (mutex) return;
+    mutex = xSemaphoreCreateMutex();
+    bus.begin(sdaPin, sclPin, hz);
+    clockHz = hz;
+    if (muxAddress) {
+        Serial.printf("[I2C] Bus uses multiplexer at 0x%02X\n", muxAddress);
+    }
+}
+
+void I2CBus::lock() {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+}
+
+void I2CBus::unlock() {
+    xSemaphoreGive(mutex);
+}
+
+void I2CBus::acquire(int8_t channel, uint32_t hz) {
+    lock();
+    if (hz && hz != clockHz) {
+        bus.setClock(hz);
+        clockHz = hz;
+    }
+    if (muxAddress && channel >= 0 && channel != selectedChannel) {
+        // TCA9548A：写入一个字节，每一位对应一个下游通道
+        bus.beginTransmission(muxAddress);
+        bus.write((uint8_t)(1 << channel));
+        selectedChannel = bus.endTransmission() == 0 ? channel : -1;
+    }
+}
+
+void I2CBus::release() {
+    unlock();
+}
+
+bool I2CBus::recover() {
+    bool toggled = false;
+    bus.end();
+    
+    // 从机卡在读周期时会一直拉低 SDA：最多 9 个 SCL 脉冲让其送完当前字节
+    pinMode(sdaPin, INPUT_PULLUP);
+    pinMode(sclPin, OUTPUT_OPEN_DRAIN);
+    digitalWrite(sclPin, HIGH);
+    if (digitalRead(sdaPin) == LOW) {
+        for (uint8_t i = 0; i < 9 && digitalRead(sdaPin) == LOW; i++) {
+            digitalWrite(sclPin, LOW);
+            delayMicroseconds(5);
+            digitalWrite(sclPin, HIGH);
+            delayMicroseconds(5);
+        }
+        // 产生 STOP：SCL 为高时 SDA 由低变高
+        pinMode(sdaPin, OUTPUT_OPEN_DRAIN);
+        digitalWrite(sdaPin, LOW);
+        delayMicroseconds(5);
+        digitalWrite(sdaPin, HIGH);
+        delayMicroseconds(5);
+        toggled = true;
+    }
+    
+    bus.begin(sdaPin, sclPin, clockHz);
+    selectedChannel = -1;
+    return toggled;
+}
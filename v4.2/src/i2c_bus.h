@@ -0,0 +1,45 @@
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "config.h"
+
+// 一条物理 I2C 总线（可带 TCA9548A 多路复用器），由挂在其上的各模块工作任务共用
+// 每次访问前 acquire() 独占总线并切换到模块所在通道与速率
+class I2CBus {
+public:
+    I2CBus(TwoWire& wire, int8_t sdaPin, int8_t sclPin, uint8_t muxAddress = 0);
+    
+    // 初始化总线；多个模块共用时只有第一次调用生效
+    void begin(uint32_t hz);
+    
+    // 独占总线，切换复用器通道（channel < 0 时不切换）并在需要时调整速率
+    void acquire(int8_t channel, uint32_t hz);
+    void release();
+    
+    // 只独占不切换：广播时先占住总线，让各模块的写入在释放后紧接着执行
+    void lock();
+    void unlock();
+    
+    TwoWire& wire() { return bus; }
+    
+    // 释放被从机拉低的 SDA 并重新初始化 Wire（需先 acquire）；返回是否发送了 SCL 脉冲
+    bool recover();
+    
+private:
+    TwoWire& bus;
+    int8_t sdaPin;
+    int8_t sclPin;
+    uint8_t muxAddress;
+    SemaphoreHandle_t mutex;
+    int8_t selectedChannel;      // -1 = 未知，下次访问时重新选择
+    uint32_t clockHz;
+};
+
+// 默认总线：Wire, SDA_PIN/SCL_PIN, I2C_MUX_ADDRESS
+extern I2CBus sharedI2CBus;
+
+#endif // I2C_BUS_H
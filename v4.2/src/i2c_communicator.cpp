@@ -1,150 +1,967 @@
 #include "i2c_communicator.h"
 #include "config.h"
+#include "bus_capture.h"
 #include <Wire.h>
 
-// 全局中断处理函数（用于attachInterrupt）
-I2CCommunicator* g_i2cCommunicator = nullptr;
-
-void IRAM_ATTR globalCOM_REQ_ISR() {
-    if (g_i2cCommunicator) {
-        g_i2cCommunicator->handleCOM_REQ_ISR();
-    }
+// 每个模块的 COM_REQ 中断以实例指针为参数
+void IRAM_ATTR I2CCommunicator::comReqISR(void* arg) {
+    static_cast<I2CCommunicator*>(arg)->handleCOM_REQ_ISR();
 }
 
 I2CCommunicator::I2CCommunicator() 
-    : notifyCallback(nullptr), notifyPending(false), notifyLength(0), lastNotifyTime(0) {
+    : bus(nullptr), id(0), address(I2C_ADDRESS), muxChannel(-1), comReqPin(COM_REQ_PIN),
+      notifyCallback(nullptr), notifyLength(0), reportedOverflows(0),
+      txQueues(), txPending(nullptr), workerHandle(nullptr), replyArmed(false), splitReads(SPLIT_UNKNOWN),
+      statsUsed(0), laneStats(), pendingClock(0), clockStats(), windowTxns(0), windowFailures(0),
+      recoveryStats(), consecutiveFailures(0), moduleState(0), stateStats(), deferredCount(0),
+      shadowValid(0), shadowGeometry(), shadowPQ(), shadowSkips(0),
+      pqAllState(PQ_ALL_UNKNOWN), lastPQ() {
+}
+
+void I2CCommunicator::attach(I2CBus* bus, uint8_t id, uint8_t address,
+                             int8_t muxChannel, uint8_t comReqPin) {
+    this->bus = bus;
+    this->id = id;
+    this->address = address;
+    this->muxChannel = muxChannel;
+    this->comReqPin = comReqPin;
 }
 
 void I2CCommunicator::begin(NotifyCallback callback) {
     notifyCallback = callback;
-    g_i2cCommunicator = this;
-    
-    pinMode(COM_REQ_PIN, INPUT);
-    attachInterrupt(digitalPinToInterrupt(COM_REQ_PIN), globalCOM_REQ_ISR, RISING);
-    Wire.begin(SDA_PIN, SCL_PIN);
-    
-    Serial.println("[I2C] Initialized");
-}
-
-void I2CCommunicator::sendKeystoneAndFlip(int pan, int tilt, int flip) {
-    Wire.beginTransmission(I2C_ADDRESS);
-    Wire.write(0x26); // Set Video Output Position Information
-    Wire.write(0x09); // Size
-    Wire.write(pan & 0xFF);
-    Wire.write(tilt & 0xFF);
-    Wire.write(flip & 0xFF);
-    for (int i = 0; i < 6; i++) Wire.write((i == 0) ? 0x64 : 0x00); // Fixed values
-    uint8_t error = Wire.endTransmission();
-    if (error) {
-        Serial.printf("[I2C] Error sending keystone command: %d\n", error);
+    if (!bus) bus = &sharedI2CBus;
+    
+    pinMode(comReqPin, INPUT);
+    attachInterruptArg(digitalPinToInterrupt(comReqPin), comReqISR, this, RISING);
+    bus->begin(I2C_CLOCK_SLOW_HZ);
+    clockStats.clockHz = I2C_CLOCK_SLOW_HZ;
+    
+    // 所有总线访问都经由该任务串行执行；每个优先级通道一个队列
+    txQueues[CXN_LANE_SAFETY] = xQueueCreate(I2C_SAFETY_QUEUE_LENGTH, sizeof(I2CTransaction));
+    txQueues[CXN_LANE_INTERACTIVE] = xQueueCreate(I2C_QUEUE_LENGTH, sizeof(I2CTransaction));
+    txQueues[CXN_LANE_BACKGROUND] = xQueueCreate(I2C_QUEUE_LENGTH, sizeof(I2CTransaction));
+    txPending = xSemaphoreCreateCounting(I2C_SAFETY_QUEUE_LENGTH + 2 * I2C_QUEUE_LENGTH, 0);
+    if (!txQueues[CXN_LANE_SAFETY] || !txQueues[CXN_LANE_INTERACTIVE] ||
+        !txQueues[CXN_LANE_BACKGROUND] || !txPending ||
+        xTaskCreate(workerTask, "i2c_worker", I2C_WORKER_STACK, this,
+                    I2C_WORKER_PRIORITY, &workerHandle) != pdPASS) {
+        Serial.println("[I2C] Failed to start worker task");
+        return;
+    }
+    
+    Serial.printf("[I2C] Module %d initialized (addr 0x%02X, mux channel %d, COM_REQ GPIO%d)\n",
+                  id, address, muxChannel, comReqPin);
+}
+
+void I2CCommunicator::workerTask(void* arg) {
+    I2CCommunicator* self = static_cast<I2CCommunicator*>(arg);
+    I2CTransaction txn;
+    for (;;) {
+        if (xSemaphoreTake(self->txPending, portMAX_DELAY) == pdTRUE &&
+            self->receiveNext(txn, CXN_LANE_COUNT)) {
+            self->execute(txn);
+            self->flushDeferred();
+        }
+    }
+}
+
+bool I2CCommunicator::lanePending(uint8_t belowLane) {
+    for (uint8_t lane = 0; lane < belowLane; lane++) {
+        if (uxQueueMessagesWaiting(txQueues[lane])) return true;
+    }
+    return false;
+}
+
+bool I2CCommunicator::receiveNext(I2CTransaction& txn, uint8_t belowLane) {
+    // 按优先级从高到低取出第一个事务（调用者已取得 txPending）
+    for (uint8_t lane = 0; lane < belowLane; lane++) {
+        if (xQueueReceive(txQueues[lane], &txn, 0) != pdTRUE) continue;
+        bool overtook = false;
+        for (uint8_t lower = lane + 1; lower < CXN_LANE_COUNT; lower++) {
+            if (uxQueueMessagesWaiting(txQueues[lower])) overtook = true;
+        }
+        if (overtook) {
+            portENTER_CRITICAL(&statsLock);
+            laneStats[lane].preemptions++;
+            portEXIT_CRITICAL(&statsLock);
+        }
+        return true;
+    }
+    return false;
+}
+
+void I2CCommunicator::backoff(uint8_t lane, TickType_t ticks) {
+    // 重试退避期间总线空闲：先执行更高优先级通道中排队的事务
+    TickType_t start = xTaskGetTickCount();
+    I2CTransaction urgent;
+    while (lanePending(lane)) {
+        xSemaphoreTake(txPending, portMAX_DELAY);
+        if (!receiveNext(urgent, lane)) break;
+        portENTER_CRITICAL(&statsLock);
+        laneStats[urgent.lane].preemptions++;
+        portEXIT_CRITICAL(&statsLock);
+        execute(urgent);
+    }
+    TickType_t elapsed = xTaskGetTickCount() - start;
+    if (elapsed < ticks) vTaskDelay(ticks - elapsed);
+}
+
+void I2CCommunicator::execute(I2CTransaction& txn) {
+    I2CResult local;
+    I2CResult& result = txn.result ? *txn.result : local;
+    const uint8_t* tx = txn.txData ? txn.txData : txn.tx;
+    result.cmd = txn.txLength ? tx[0] : 0x00;
+    result.error = 0;
+    result.rxLength = 0;
+    result.replyUs = 0;
+    result.replySource = REPLY_NONE;
+    result.attempts = 0;
+    if (pendingClock) {
+        applyClock(pendingClock);
+        pendingClock = 0;
+    }
+    if (txn.txLength && !admit(txn, result)) return;
+    uint32_t startCycles = ESP.getCycleCount();
+    
+    // 写入失败时按命令的重试预算指数退避重试；不可重试的失败原样交给调用者
+    uint8_t budget = txn.txLength ? cxnRetryBudget(result.cmd) : 0;
+    for (uint8_t attempt = 0;; attempt++) {
+        result.attempts = attempt + 1;
+        writeWithReply(txn, tx, result);
+        if (result.error == 0) {
+            consecutiveFailures = 0;
+            if (attempt) recoveryStats.recovered++;
+            break;
+        }
+        
+        // 总线错误/超时多半是 SDA 被拉住；连续失败后整体重新初始化
+        if (++consecutiveFailures >= I2C_REINIT_AFTER || result.error >= 4) {
+            recoverBus();
+        }
+        if (attempt >= budget || result.error == 1) {
+            recoveryStats.surfaced++;
+            Serial.printf("[I2C] 0x%02X failed after %d attempt(s): %d\n",
+                          result.cmd, result.attempts, result.error);
+            break;
+        }
+        recoveryStats.retries++;
+        backoff(txn.lane, pdMS_TO_TICKS(I2C_RETRY_BASE_MS << attempt));
+    }
+    
+    if (result.error == 0 && txn.notifyFrame) {
+        readNotifyFrame(result);
+    } else if (result.error == 0 && txn.rxLength && txn.replyTimeoutMs) {
+        readReply(txn, result.cmd, result);
+    } else if (result.error == 0 && txn.rxLength) {
+        readInto(result, txn.rxLength);
+    }
+    
+    trackFailureRate(recordStats(txn, result, ESP.getCycleCount() - startCycles));
+    if (result.error) {
+        // 写入未被确认，模块状态未知
+        invalidateShadowFor(result.cmd);
+    } else if (txn.txLength) {
+        applyCommandState(tx, txn.txLength);
+    } else if (txn.notifyFrame) {
+        applyNotifyState(result);
+    }
+    
+    recordLane(txn);
+    if (txn.onComplete) {
+        txn.onComplete(result, txn.ctx);
+    }
+    if (txn.waiter) {
+        xTaskNotifyGive(txn.waiter);
+    }
+}
+
+bool I2CCommunicator::admit(I2CTransaction& txn, I2CResult& result) {
+    const uint8_t* tx = txn.txData ? txn.txData : txn.tx;
+    uint8_t cmd = tx[0];
+    if (!moduleState || (cxnAllowedStates(cmd) & moduleState)) return true;
+    
+    // 异步写入可推迟；同步调用者和不允许推迟的提交（宏）在等待结果，直接拒绝
+    if (txn.deferrable && !txn.result && cxnDeferrable(cmd)) {
+        uint8_t slot = deferredCount;
+        if (cxnLatestWins(cmd)) {
+            for (uint8_t i = 0; i < deferredCount; i++) {
+                const I2CTransaction& d = deferred[i];
+                if ((d.txData ? d.txData : d.tx)[0] == cmd) {
+                    slot = i;
+                    break;
+                }
+            }
+        }
+        if (slot < I2C_DEFER_SLOTS) {
+            if (slot < deferredCount) {
+                // 被新值取代的旧命令不再发送
+                result.error = I2C_ERROR_STATE;
+                if (deferred[slot].onComplete) deferred[slot].onComplete(result, deferred[slot].ctx);
+            } else {
+                deferredCount++;
+            }
+            deferred[slot] = txn;
+            stateStats.deferred++;
+            Serial.printf("[STATE] Deferred 0x%02X until module leaves %s\n",
+                          cmd, moduleStateName(moduleState));
+            return false;
+        }
+    }
+    
+    stateStats.rejected++;
+    Serial.printf("[STATE] Rejected 0x%02X: not allowed in %s\n", cmd, moduleStateName(moduleState));
+    result.error = I2C_ERROR_STATE;
+    invalidateShadowFor(cmd);
+    if (txn.onComplete) {
+        txn.onComplete(result, txn.ctx);
+    }
+    if (txn.waiter) {
+        xTaskNotifyGive(txn.waiter);
+    }
+    return false;
+}
+
+void I2CCommunicator::flushDeferred() {
+    // 按原顺序补发当前状态允许的命令；补发的命令本身也可能切换状态
+    uint8_t i = 0;
+    while (i < deferredCount) {
+        const I2CTransaction& d = deferred[i];
+        uint8_t cmd = (d.txData ? d.txData : d.tx)[0];
+        if (moduleState && !(cxnAllowedStates(cmd) & moduleState)) {
+            i++;
+            continue;
+        }
+        I2CTransaction txn = d;
+        deferredCount--;
+        memmove(&deferred[i], &deferred[i + 1], (deferredCount - i) * sizeof(I2CTransaction));
+        stateStats.flushed++;
+        execute(txn);
+        i = 0;
+    }
+}
+
+const char* I2CCommunicator::moduleStateName(uint8_t state) {
+    switch (state) {
+        case CXN_STATE_READY: return "Ready";
+        case CXN_STATE_ACTIVE: return "Active";
+        case CXN_STATE_OPTICAL: return "Optical Axis Adjust";
+        case CXN_STATE_BIPHASE: return "Bi-Phase Adjust";
+        default: return "Unknown";
+    }
+}
+
+void I2CCommunicator::setModuleState(uint8_t state, const char* reason) {
+    if (state == moduleState) return;
+    Serial.printf("[STATE] %s -> %s (%s)\n", moduleStateName(moduleState), moduleStateName(state), reason);
+    moduleState = state;
+    stateStats.transitions++;
+}
+
+void I2CCommunicator::applyCommandState(const uint8_t* tx, uint8_t length) {
+    switch (tx[0]) {
+        case 0x01: setModuleState(CXN_STATE_ACTIVE, "Start Input"); break;
+        case 0x02:
+        case 0x0C: setModuleState(CXN_STATE_READY, "Stop Input"); break;
+        case 0x32: setModuleState(CXN_STATE_OPTICAL, "Enter Optical Axis"); break;
+        case 0x35: setModuleState(CXN_STATE_READY, "Exit Optical Axis"); break;
+        case 0x36: setModuleState(CXN_STATE_BIPHASE, "Enter Bi-Phase"); break;
+        case 0x39: setModuleState(CXN_STATE_READY, "Exit Bi-Phase"); break;
+        case 0x0B:
+            // 关机/重启后状态未知，重启完成时由 Boot Completed Notify 置为 Ready
+            setModuleState(0, length >= 3 && tx[2] == 0x01 ? "Reboot" : "Shutdown");
+            break;
+        default: break;
+    }
+}
+
+void I2CCommunicator::applyNotifyState(const I2CResult& notify) {
+    if (notify.rxLength < 3) return;
+    switch (notify.rx[0]) {
+        case 0x00: // Boot Completed
+            setModuleState(notify.rx[2] == 0x00 ? CXN_STATE_READY : 0, "Boot Completed");
+            break;
+        case 0x10: // Emergency
+        case 0x12: // Command Error：本地状态与模块不一致，改为不限制
+            setModuleState(0, notify.rx[0] == 0x10 ? "Emergency" : "Command Error");
+            break;
+        default: break;
+    }
+}
+
+bool I2CCommunicator::recordStats(const I2CTransaction& txn, const I2CResult& result,
+                                  uint32_t cycles) {
+    uint32_t us = cycles / ESP.getCpuFreqMHz();
+    uint8_t bucket = 0;
+    while (bucket < I2C_STATS_BUCKETS - 1 && us > I2C_LATENCY_BOUNDS_US[bucket]) {
+        bucket++;
+    }
+    bool expectRead = result.error == 0 && (txn.notifyFrame || txn.rxLength);
+    bool shortRead = expectRead && (txn.notifyFrame ? result.rxLength < 2
+                                                    : result.rxLength < txn.rxLength);
+    
+    portENTER_CRITICAL(&statsLock);
+    I2CCommandStats* entry = nullptr;
+    for (uint8_t i = 0; i < statsUsed; i++) {
+        if (stats[i].cmd == result.cmd) {
+            entry = &stats[i];
+            break;
+        }
+    }
+    if (!entry) {
+        // 槽位用尽后，未登记的命令合并计入最后一个槽（CMD 记为 0xFF）
+        if (statsUsed < I2C_STATS_SLOTS) {
+            entry = &stats[statsUsed++];
+            memset(entry, 0, sizeof(*entry));
+            entry->cmd = statsUsed == I2C_STATS_SLOTS ? 0xFF : result.cmd;
+        } else {
+            entry = &stats[I2C_STATS_SLOTS - 1];
+        }
+    }
+    entry->count++;
+    if (result.error == 2 || result.error == 3) {
+        entry->nacks++;
+    } else if (result.error) {
+        entry->busErrors++;
+    }
+    if (result.replySource == REPLY_TIMEOUT) entry->timeouts++;
+    if (shortRead) entry->shortReads++;
+    if (result.error == 0) entry->txBytes += txn.txLength;
+    entry->rxBytes += result.rxLength;
+    if (us > entry->maxUs) entry->maxUs = us;
+    entry->totalUs += us;
+    entry->buckets[bucket]++;
+    portEXIT_CRITICAL(&statsLock);
+    
+    return result.error != 0 || shortRead;
+}
+
+void I2CCommunicator::setClock(uint32_t hz) {
+    pendingClock = constrain(hz, (uint32_t)I2C_CLOCK_SLOW_HZ, (uint32_t)I2C_CLOCK_FAST_HZ);
+}
+
+void I2CCommunicator::applyClock(uint32_t hz) {
+    if (hz == clockStats.clockHz) return;
+    // 总线在下一次 acquire 时切换到本模块的速率
+    clockStats.clockHz = hz;
+    windowTxns = 0;
+    windowFailures = 0;
+    Serial.printf("[I2C] Bus clock set to %lu Hz\n", (unsigned long)hz);
+}
+
+void I2CCommunicator::trackFailureRate(bool failed) {
+    windowTxns++;
+    if (failed) windowFailures++;
+    if (windowTxns < I2C_FALLBACK_WINDOW) return;
+    
+    // 失败率超过阈值时降一档（减半，不低于 I2C_CLOCK_SLOW_HZ）
+    if (windowFailures * 100 >= I2C_FALLBACK_PERCENT * windowTxns &&
+        clockStats.clockHz > I2C_CLOCK_SLOW_HZ) {
+        uint32_t from = clockStats.clockHz;
+        uint32_t to = from / 2 < I2C_CLOCK_SLOW_HZ ? I2C_CLOCK_SLOW_HZ : from / 2;
+        Serial.printf("[I2C] %u/%u transactions failed at %lu Hz, stepping down\n",
+                      windowFailures, windowTxns, (unsigned long)from);
+        applyClock(to);
+        clockStats.fallbacks++;
+        clockStats.lastFallbackFromHz = from;
+        clockStats.lastFallbackAt = millis();
+    }
+    windowTxns = 0;
+    windowFailures = 0;
+}
+
+uint32_t I2CCommunicator::probeClock() {
+    uint32_t hz = I2C_CLOCK_FAST_HZ;
+    for (;;) {
+        setClock(hz);
+        
+        bool reliable = true;
+        for (uint8_t round = 0; round < I2C_PROBE_ROUNDS && reliable; round++) {
+            int temperature, muteThreshold, stopThreshold;
+            unsigned long runtime;
+            String firmware, parameter, data;
+            reliable = requestTemperature(temperature, muteThreshold, stopThreshold) &&
+                       requestRuntime(runtime) &&
+                       requestVersion(firmware, parameter, data);
+        }
+        if (reliable || hz <= I2C_CLOCK_SLOW_HZ) {
+            Serial.printf("[I2C] Clock probe: %lu Hz%s\n", (unsigned long)hz,
+                          reliable ? "" : " (module not responding reliably)");
+            break;
+        }
+        hz = hz / 2 < I2C_CLOCK_SLOW_HZ ? I2C_CLOCK_SLOW_HZ : hz / 2;
+    }
+    clockStats.probedHz = hz;
+    return hz;
+}
+
+uint8_t I2CCommunicator::getCommandStats(I2CCommandStats* out, uint8_t maxEntries) {
+    portENTER_CRITICAL(&statsLock);
+    uint8_t n = statsUsed < maxEntries ? statsUsed : maxEntries;
+    memcpy(out, stats, n * sizeof(I2CCommandStats));
+    portEXIT_CRITICAL(&statsLock);
+    return n;
+}
+
+void I2CCommunicator::resetCommandStats() {
+    portENTER_CRITICAL(&statsLock);
+    statsUsed = 0;
+    memset(laneStats, 0, sizeof(laneStats));
+    portEXIT_CRITICAL(&statsLock);
+}
+
+void I2CCommunicator::recordLane(const I2CTransaction& txn) {
+    uint32_t latency = micros() - txn.queuedUs;
+    portENTER_CRITICAL(&statsLock);
+    I2CLaneStats& s = laneStats[txn.lane];
+    s.count++;
+    s.totalLatencyUs += latency;
+    if (latency > s.maxLatencyUs) s.maxLatencyUs = latency;
+    portEXIT_CRITICAL(&statsLock);
+}
+
+I2CLaneStats I2CCommunicator::getLaneStats(uint8_t lane) {
+    I2CLaneStats copy = {};
+    if (lane >= CXN_LANE_COUNT) return copy;
+    portENTER_CRITICAL(&statsLock);
+    copy = laneStats[lane];
+    portEXIT_CRITICAL(&statsLock);
+    return copy;
+}
+
+const char* I2CCommunicator::laneName(uint8_t lane) {
+    switch (lane) {
+        case CXN_LANE_SAFETY: return "safety";
+        case CXN_LANE_INTERACTIVE: return "interactive";
+        case CXN_LANE_BACKGROUND: return "background";
+        default: return "unknown";
+    }
+}
+
+void I2CCommunicator::writeWithReply(I2CTransaction& txn, const uint8_t* tx, I2CResult& result) {
+    result.error = 0;
+    result.replyUs = 0;
+    result.replySource = REPLY_NONE;
+    
+    if (txn.replyTimeoutMs) {
+        // 在写入前挂起等待，避免应答先于 arm 到达而丢失边沿
+        ulTaskNotifyTake(pdTRUE, 0);
+        replyArmed = true;
+    }
+    
+    if (txn.txLength) {
+        // 只在写入期间占用总线，等待应答时其他模块可以使用
+        bus->acquire(muxChannel, clockStats.clockHz);
+        TwoWire& wire = bus->wire();
+        uint32_t writeAt = micros();
+        wire.beginTransmission(address);
+        wire.write(tx, txn.txLength);
+        result.error = wire.endTransmission();
+        busCapture.record(CAPTURE_WRITE, id, address, result.error, tx, txn.txLength, writeAt);
+        bus->release();
+    }
+    
+    if (txn.replyTimeoutMs) {
+        if (result.error == 0) {
+            unsigned long start = micros();
+            result.replySource = waitForReply(txn.replyTimeoutMs);
+            result.replyUs = micros() - start;
+            busCapture.record(CAPTURE_COM_REQ, id, address, result.replySource, nullptr, 0,
+                              start + result.replyUs);
+        }
+        replyArmed = false;
+    }
+}
+
+void I2CCommunicator::recoverBus() {
+    bus->acquire(-1, 0);
+    if (bus->recover()) {
+        recoveryStats.sclToggles++;
+    }
+    bus->release();
+    recoveryStats.reinits++;
+    consecutiveFailures = 0;
+    Serial.printf("[I2C] Bus recovered and Wire re-initialized at %lu Hz\n",
+                  (unsigned long)clockStats.clockHz);
+}
+
+uint8_t I2CCommunicator::readInto(I2CResult& result, uint8_t count) {
+    if (count > I2C_MAX_FRAME - result.rxLength) {
+        count = I2C_MAX_FRAME - result.rxLength;
+    }
+    uint8_t got = 0;
+    bus->acquire(muxChannel, clockStats.clockHz);
+    TwoWire& wire = bus->wire();
+    uint32_t readAt = micros();
+    wire.requestFrom(address, count);
+    while (wire.available() && got < count) {
+        result.rx[result.rxLength + got++] = wire.read();
+    }
+    busCapture.record(CAPTURE_READ, id, address, count, result.rx + result.rxLength, got, readAt);
+    bus->release();
+    result.rxLength += got;
+    return got;
+}
+
+void I2CCommunicator::readNotifyFrame(I2CResult& result) {
+    // 在工作任务中记录，保证与前后事务的顺序一致
+    busCapture.record(CAPTURE_COM_REQ, id, address, REPLY_NONE, nullptr, 0, micros());
+    
+    // 第一段：只读 CMD 和 SIZE
+    if (readInto(result, 2) < 2) return;
+    uint8_t cmd = result.rx[0];
+    uint8_t size = result.rx[1];
+    uint8_t frameLength = 2 + size;
+    if (size > I2C_MAX_FRAME - 2) {
+        // SIZE 不可信，按命令上限读取
+        frameLength = cxnNotifyMaxLength(cmd);
+    }
+    if (frameLength <= 2) return;
+    
+    if (splitReads != SPLIT_UNSUPPORTED) {
+        // 第二段：只读帧头声明的剩余字节
+        readInto(result, frameLength - 2);
+        // 仅在首次判定时检查，避免数据恰好与帧头相同造成误判
+        bool restarted = splitReads == SPLIT_UNKNOWN && result.rxLength >= 4 &&
+                         result.rx[2] == cmd && result.rx[3] == size;
+        if (!restarted) {
+            if (splitReads == SPLIT_UNKNOWN && result.rxLength == frameLength) {
+                splitReads = SPLIT_OK;
+                Serial.println("[NOTIFY] Split reads supported");
+            }
+            return;
+        }
+        // 第二段从帧头重新开始：模块不支持分段读取
+        splitReads = SPLIT_UNSUPPORTED;
+        Serial.println("[NOTIFY] Split reads not supported, using single reads");
+    }
+    
+    // 不支持分段读取：从头读取整帧
+    result.rxLength = 0;
+    readInto(result, frameLength);
+}
+
+void I2CCommunicator::readReply(const I2CTransaction& txn, uint8_t cmd, I2CResult& result) {
+    // 应答之前可能排着未读的主动 Notify（温度告警等），它的 COM_REQ 会被当成应答：
+    // 读到的不是本命令的应答时把这一帧转交 Notify 处理，继续等待真正的应答
+    // 读取期间保持 arm，当前帧读完后下一帧的上升沿直接唤醒工作任务
+    static const uint8_t MAX_STRAYS = 4;
+    for (uint8_t strays = 0;; strays++) {
+        ulTaskNotifyTake(pdTRUE, 0);
+        replyArmed = true;
+        readInto(result, txn.rxLength);
+        
+        // SIZE 为 0 的不是 Notify（超时后读到的空数据）；点名本命令的 Command Error 就是应答
+        bool stray = result.rxLength >= 3 && result.rx[0] != cmd && result.rx[1] != 0 &&
+                     !(result.rx[0] == 0x12 && result.rxLength >= 4 && result.rx[3] == cmd);
+        if (!stray || strays == MAX_STRAYS) break;
+        
+        uint8_t frameLength = result.rx[1] <= I2C_MAX_FRAME - 2 ? 2 + result.rx[1]
+                                                                : cxnNotifyMaxLength(result.rx[0]);
+        if (result.rxLength < frameLength) {
+            // 帧比应答长：支持分段读取时读剩余部分，否则从帧头重新读整帧
+            if (splitReads != SPLIT_OK) result.rxLength = 0;
+            readInto(result, frameLength - result.rxLength);
+        }
+        result.rxLength = frameLength < result.rxLength ? frameLength : result.rxLength;
+        forwardStray(result, cmd);
+        
+        result.rxLength = 0;
+        unsigned long start = micros();
+        result.replySource = waitForReply(txn.replyTimeoutMs);
+        result.replyUs += micros() - start;
+    }
+    replyArmed = false;
+    
+    // 应答读完到撤销 arm 之间到达的 Notify 没有进入事件缓冲：在这里读出转交
+    if (ulTaskNotifyTake(pdTRUE, 0) && digitalRead(comReqPin) == HIGH) {
+        I2CResult notify;
+        notify.rxLength = 0;
+        readNotifyFrame(notify);
+        if (notify.rxLength >= 3) forwardStray(notify, cmd);
+    }
+}
+
+void I2CCommunicator::forwardStray(const I2CResult& frame, uint8_t waitingFor) {
+    applyNotifyState(frame);
+    StrayNotify stray;
+    stray.timestampUs = micros();
+    stray.length = frame.rxLength;
+    memcpy(stray.frame, frame.rx, frame.rxLength);
+    if (strayNotifies.push(stray)) {
+        Serial.printf("[NOTIFY] Module %d 0x%02X arrived while waiting for 0x%02X, forwarded\n",
+                      id, frame.rx[0], waitingFor);
     } else {
-        Serial.println("[I2C] Keystone and Flip command sent successfully.");
+        Serial.printf("[NOTIFY] Module %d 0x%02X arrived while waiting for 0x%02X, stray buffer full\n",
+                      id, frame.rx[0], waitingFor);
+    }
+}
+
+uint8_t I2CCommunicator::waitForReply(uint16_t timeoutMs) {
+    TickType_t start = xTaskGetTickCount();
+    TickType_t limit = pdMS_TO_TICKS(timeoutMs);
+    for (;;) {
+        if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(COM_REQ_POLL_MS))) {
+            return REPLY_IRQ;
+        }
+        // 上一个 Notify 之后 COM_REQ 可能仍为高，此时不会再有上升沿
+        if (digitalRead(comReqPin) == HIGH) {
+            return REPLY_POLL;
+        }
+        if (xTaskGetTickCount() - start >= limit) {
+            return REPLY_TIMEOUT;
+        }
     }
 }
 
+bool I2CCommunicator::submit(const uint8_t* frame, uint8_t length,
+                             I2CCompletion onComplete, void* ctx, bool deferrable) {
+    // 绕过影子寄存器的原始写入（预定义/自定义命令等）
+    if (length) invalidateShadowFor(frame[0]);
+    return enqueue(frame, length, onComplete, ctx, deferrable);
+}
+
+bool I2CCommunicator::enqueue(const uint8_t* frame, uint8_t length,
+                              I2CCompletion onComplete, void* ctx, bool deferrable) {
+    if (!txPending || length == 0 || length > I2C_MAX_FRAME) {
+        Serial.printf("[I2C] Rejected transaction (len=%d)\n", length);
+        return false;
+    }
+    
+    I2CTransaction txn;
+    memcpy(txn.tx, frame, length);
+    txn.txLength = length;
+    txn.rxLength = 0;
+    txn.replyTimeoutMs = 0;
+    txn.notifyFrame = false;
+    txn.txData = nullptr;
+    txn.deferrable = deferrable;
+    txn.onComplete = onComplete;
+    txn.ctx = ctx;
+    txn.result = nullptr;
+    txn.waiter = nullptr;
+    
+    if (!post(txn, 0)) {
+        Serial.printf("[I2C] %s queue full, dropped command 0x%02X\n", laneName(txn.lane), frame[0]);
+        return false;
+    }
+    return true;
+}
+
+bool I2CCommunicator::submitBuffer(const uint8_t* frame, uint8_t length,
+                                   uint8_t responseLength, uint16_t replyTimeoutMs,
+                                   I2CCompletion onComplete, void* ctx) {
+    if (!txPending || length == 0 || length > I2C_WIRE_BUFFER || responseLength > I2C_MAX_FRAME) {
+        Serial.printf("[I2C] Rejected buffer transaction (len=%d)\n", length);
+        return false;
+    }
+    
+    I2CTransaction txn;
+    txn.txData = frame;
+    txn.txLength = length;
+    txn.rxLength = responseLength;
+    txn.replyTimeoutMs = replyTimeoutMs;
+    txn.notifyFrame = false;
+    txn.deferrable = true;
+    txn.onComplete = onComplete;
+    txn.ctx = ctx;
+    txn.result = nullptr;
+    txn.waiter = nullptr;
+    
+    if (!post(txn, 0)) {
+        Serial.printf("[I2C] %s queue full, dropped command 0x%02X\n", laneName(txn.lane), frame[0]);
+        return false;
+    }
+    return true;
+}
+
+bool I2CCommunicator::transact(const uint8_t* frame, uint8_t length, I2CResult& result,
+                               uint8_t responseLength, uint16_t replyTimeoutMs) {
+    result.cmd = length ? frame[0] : 0x00;
+    result.error = 0;
+    result.rxLength = 0;
+    result.attempts = 0;
+    if (!txPending || length > I2C_MAX_FRAME || responseLength > I2C_MAX_FRAME) {
+        result.error = I2C_ERROR_INVALID;
+        return false;
+    }
+    if (length) invalidateShadowFor(frame[0]);
+    
+    I2CTransaction txn;
+    if (length) memcpy(txn.tx, frame, length);
+    txn.txLength = length;
+    txn.rxLength = responseLength;
+    txn.replyTimeoutMs = replyTimeoutMs;
+    txn.notifyFrame = false;
+    txn.txData = nullptr;
+    txn.deferrable = false;
+    txn.onComplete = nullptr;
+    txn.ctx = nullptr;
+    txn.result = &result;
+    runSync(txn);
+    
+    return result.error == 0 && result.rxLength == responseLength;
+}
+
+// 按命令确定通道并记录入队时间
+static void stampLane(I2CTransaction& txn) {
+    const uint8_t* tx = txn.txData ? txn.txData : txn.tx;
+    txn.lane = txn.txLength ? (uint8_t)cxnLane(tx[0]) : (uint8_t)CXN_LANE_SAFETY;
+    txn.queuedUs = micros();
+}
+
+bool I2CCommunicator::post(I2CTransaction& txn, TickType_t wait) {
+    stampLane(txn);
+    if (xQueueSend(txQueues[txn.lane], &txn, wait) != pdTRUE) {
+        portENTER_CRITICAL(&statsLock);
+        laneStats[txn.lane].dropped++;
+        portEXIT_CRITICAL(&statsLock);
+        return false;
+    }
+    xSemaphoreGive(txPending);
+    return true;
+}
+
+void I2CCommunicator::runSync(I2CTransaction& txn) {
+    if (xTaskGetCurrentTaskHandle() == workerHandle) {
+        // 已在工作任务中（例如完成回调内），直接执行避免自锁
+        txn.waiter = nullptr;
+        stampLane(txn);
+        execute(txn);
+    } else {
+        txn.waiter = xTaskGetCurrentTaskHandle();
+        post(txn, portMAX_DELAY);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+
+void I2CCommunicator::logCompletion(const I2CResult& result, void* ctx) {
+    const char* what = static_cast<const char*>(ctx);
+    if (result.error) {
+        Serial.printf("[I2C] Error sending %s (0x%02X): %d\n", what, result.cmd, result.error);
+    } else {
+        Serial.printf("[I2C] %s sent successfully.\n", what);
+    }
+}
+
+void I2CCommunicator::invalidateShadow() {
+    portENTER_CRITICAL(&shadowLock);
+    shadowValid = 0;
+    portEXIT_CRITICAL(&shadowLock);
+}
+
+void I2CCommunicator::invalidateShadowFor(uint8_t cmd) {
+    uint8_t bits = 0;
+    switch (cmd) {
+        case 0x26:                      // Set Output Position
+            bits = SHADOW_GEOMETRY;
+            break;
+        case 0x41: case 0x43: case 0x45:
+        case 0x47: case 0x49: case 0x4F: // Picture Quality
+            bits = SHADOW_PQ;
+            break;
+        case 0x08:                      // Factory Reset
+        case 0x0B:                      // Shutdown / Reboot
+            bits = SHADOW_ALL;
+            break;
+        default:
+            return;
+    }
+    portENTER_CRITICAL(&shadowLock);
+    shadowValid &= ~bits;
+    portEXIT_CRITICAL(&shadowLock);
+}
+
+bool I2CCommunicator::sendKeystoneAndFlip(int pan, int tilt, int flip) {
+    uint8_t geometry[3] = {(uint8_t)(pan & 0xFF), (uint8_t)(tilt & 0xFF), (uint8_t)(flip & 0xFF)};
+    
+    // 与影子相同则跳过；否则先更新影子再入队，写入失败时由工作任务使其失效
+    portENTER_CRITICAL(&shadowLock);
+    bool same = (shadowValid & SHADOW_GEOMETRY) && memcmp(shadowGeometry, geometry, 3) == 0;
+    if (!same) {
+        memcpy(shadowGeometry, geometry, 3);
+        shadowValid |= SHADOW_GEOMETRY;
+    }
+    portEXIT_CRITICAL(&shadowLock);
+    if (same) {
+        shadowSkips++;
+        return true;
+    }
+    
+    uint8_t frame[11] = {
+        0x26,        // Set Video Output Position Information
+        0x09,        // Size
+        (uint8_t)(pan & 0xFF),
+        (uint8_t)(tilt & 0xFF),
+        (uint8_t)(flip & 0xFF),
+        0x64, 0x00, 0x00, 0x00, 0x00, 0x00 // Fixed values
+    };
+    if (!enqueue(frame, sizeof(frame), logCompletion, (void*)"Keystone and Flip command")) {
+        invalidateShadowFor(0x26);
+        return false;
+    }
+    return true;
+}
+
 void I2CCommunicator::sendTestPattern(uint8_t pattern, uint8_t generalSetting,
                                         uint8_t bgR, uint8_t bgG, uint8_t bgB,
                                         uint8_t fgR, uint8_t fgG, uint8_t fgB) {
-    Wire.beginTransmission(I2C_ADDRESS);
-    Wire.write(0xA3); // Output Test Picture
-    Wire.write(0x11); // OP0: Size = 17 bytes
-    Wire.write(pattern); // OP1: Test pattern
-    Wire.write(generalSetting); // OP2: General purpose setting
-    Wire.write(bgR); // OP3: Background color R
-    Wire.write(bgG); // OP4: Background color G
-    Wire.write(bgB); // OP5: Background color B
-    Wire.write(fgR); // OP6: Foreground color R
-    Wire.write(fgG); // OP7: Foreground color G
-    Wire.write(fgB); // OP8: Foreground color B
-    for (int i = 0; i < 9; i++) {
-        Wire.write(0x00); // OP9-OP17: Reserved
-    }
-    uint8_t error = Wire.endTransmission();
-    if (error) {
-        Serial.printf("[I2C] Error sending test pattern: %d\n", error);
-    } else {
-        Serial.printf("[I2C] Test pattern sent: 0x%02X\n", pattern);
-    }
-}
-
-void I2CCommunicator::sendPictureQuality(const SystemSettings& settings) {
-    // Brightness
-    int val = map(settings.brightness, 0, 255, -31, 31);
-    Wire.beginTransmission(I2C_ADDRESS);
-    Wire.write(0x43); // Set Brightness
-    Wire.write(0x01);
-    Wire.write((int8_t)val);
-    Wire.endTransmission();
-    
-    // Contrast
-    val = map(settings.contrast, 0, 255, -15, 15);
-    Wire.beginTransmission(I2C_ADDRESS);
-    Wire.write(0x45); // Set Contrast
-    Wire.write(0x01);
-    Wire.write((int8_t)val);
-    Wire.endTransmission();
-    
-    // Hue (U/V)
-    int u = map(settings.hueU, 0, 255, -15, 15);
-    int v = map(settings.hueV, 0, 255, -15, 15);
-    Wire.beginTransmission(I2C_ADDRESS);
-    Wire.write(0x47); // Set Hue
-    Wire.write(0x02); // OP0=2
-    Wire.write((int8_t)u); // OP1: U
-    Wire.write((int8_t)v); // OP2: V
-    Wire.endTransmission();
-    
-    // Saturation (U/V)
-    u = map(settings.satU, 0, 255, -15, 15);
-    v = map(settings.satV, 0, 255, -15, 15);
-    Wire.beginTransmission(I2C_ADDRESS);
-    Wire.write(0x49); // Set Saturation
-    Wire.write(0x02); // OP0=2
-    Wire.write((int8_t)u); // OP1: U
-    Wire.write((int8_t)v); // OP2: V
-    Wire.endTransmission();
-    
-    // Sharpness
-    val = map(settings.sharpness, 0, 255, 0, 8);
-    Wire.beginTransmission(I2C_ADDRESS);
-    Wire.write(0x4F); // Set Sharpness
-    Wire.write(0x01);
-    Wire.write((uint8_t)val);
-    Wire.endTransmission();
-    
-    Serial.println("[I2C] Picture quality settings sent");
+    uint8_t frame[19] = {
+        0xA3,           // Output Test Picture
+        0x11,           // OP0: Size = 17 bytes
+        pattern,        // OP1: Test pattern
+        generalSetting, // OP2: General purpose setting
+        bgR, bgG, bgB,  // OP3-OP5: Background color RGB
+        fgR, fgG, fgB   // OP6-OP8: Foreground color RGB
+                        // OP9-OP17: Reserved (0x00)
+    };
+    if (submit(frame, sizeof(frame), logCompletion, (void*)"test pattern")) {
+        Serial.printf("[I2C] Test pattern queued: 0x%02X\n", pattern);
+    }
+}
+
+PictureQualityValues I2CCommunicator::encodePictureQuality(const SystemSettings& settings) {
+    PictureQualityValues pq;
+    pq.brightness = (int8_t)map(settings.brightness, 0, 255, -31, 31);
+    pq.contrast = (int8_t)map(settings.contrast, 0, 255, -15, 15);
+    pq.hueU = (int8_t)map(settings.hueU, 0, 255, -15, 15);
+    pq.hueV = (int8_t)map(settings.hueV, 0, 255, -15, 15);
+    pq.satU = (int8_t)map(settings.satU, 0, 255, -15, 15);
+    pq.satV = (int8_t)map(settings.satV, 0, 255, -15, 15);
+    pq.sharpness = (uint8_t)map(settings.sharpness, 0, 255, 0, 8);
+    return pq;
+}
+
+// map() 向下取整，取满足 encode(v) == value 的最小 v
+static inline uint8_t decodeComponent(int value, int lo, int hi) {
+    return (uint8_t)(((value - lo) * 255 + (hi - lo) - 1) / (hi - lo));
+}
+
+void I2CCommunicator::decodePictureQuality(const PictureQualityValues& pq, SystemSettings& settings) {
+    settings.brightness = decodeComponent(constrain(pq.brightness, -31, 31), -31, 31);
+    settings.contrast = decodeComponent(constrain(pq.contrast, -15, 15), -15, 15);
+    settings.hueU = decodeComponent(constrain(pq.hueU, -15, 15), -15, 15);
+    settings.hueV = decodeComponent(constrain(pq.hueV, -15, 15), -15, 15);
+    settings.satU = decodeComponent(constrain(pq.satU, -15, 15), -15, 15);
+    settings.satV = decodeComponent(constrain(pq.satV, -15, 15), -15, 15);
+    settings.sharpness = decodeComponent(constrain((int)pq.sharpness, 0, 8), 0, 8);
+}
+
+bool I2CCommunicator::sendPictureQuality(const SystemSettings& settings) {
+    PictureQualityValues pq = encodePictureQuality(settings);
+    
+    portENTER_CRITICAL(&shadowLock);
+    bool same = (shadowValid & SHADOW_PQ) && memcmp(&shadowPQ, &pq, sizeof(pq)) == 0;
+    if (!same) {
+        shadowPQ = pq;
+        shadowValid |= SHADOW_PQ;
+    }
+    portEXIT_CRITICAL(&shadowLock);
+    if (same) {
+        shadowSkips++;
+        return true;
+    }
+    
+    lastPQ = pq;
+    if (pqAllState == PQ_ALL_REJECTED) {
+        return sendPictureQualityFields(lastPQ);
+    }
+    
+    // Set All Picture Quality。test/help.txt 把 OP3/OP4 写作单值色调/饱和度、OP5 为锐度，
+    // 但本固件自 v3.4 起 0x47/0x49 一直以 OP0=2 的 U/V 有符号分量（-15~+15，0 为不变）驱动模块，
+    // 设置与网页也按 U/V 保存；这里沿用同一组分量并按 0x47、0x49、0x4F 的顺序排列，
+    // 使 0x41 与逐项写入的值完全一致，0x40 的回读也能按同一布局解码
+    uint8_t frame[12] = {
+        0x41,                        // Set All Picture Quality
+        0x0A,                        // OP0
+        (uint8_t)lastPQ.brightness,  // OP1
+        (uint8_t)lastPQ.contrast,    // OP2
+        (uint8_t)lastPQ.hueU,        // OP3
+        (uint8_t)lastPQ.hueV,        // OP4
+        (uint8_t)lastPQ.satU,        // OP5
+        (uint8_t)lastPQ.satV,        // OP6
+        lastPQ.sharpness             // OP7
+                                     // OP8-OP10: Reserved (0x00)
+    };
+    if (!enqueue(frame, sizeof(frame), onPictureQualityAllComplete, this)) {
+        invalidateShadowFor(0x41);
+        return false;
+    }
+    Serial.println("[I2C] Picture quality settings queued (0x41)");
+    return true;
+}
+
+void I2CCommunicator::onPictureQualityAllComplete(const I2CResult& result, void* ctx) {
+    // 0x41 只写不读：模块拒绝只能由随后的 Command Error Notify 得知（见 handleNotify），这里不判断
+    I2CCommunicator* self = static_cast<I2CCommunicator*>(ctx);
+    if (result.error) {
+        // NACK、状态不允许或被更新的 0x41 取代都不代表固件不支持 0x41，保持原状态
+        Serial.printf("[I2C] 0x41 not completed (%d)\n", result.error);
+    } else if (self->pqAllState == PQ_ALL_UNKNOWN) {
+        self->pqAllState = PQ_ALL_OK;
+    }
+}
+
+void I2CCommunicator::rejectPictureQualityAll() {
+    pqAllState = PQ_ALL_REJECTED;
+    sendPictureQualityFields(lastPQ);
+}
+
+// 0x43~0x4F 仅在 Active 状态可用：Ready 下这里的“回退”只是进入延迟队列，启动后才写入
+bool I2CCommunicator::sendPictureQualityFields(const PictureQualityValues& pq) {
+    bool queued = enqueuePictureQualityCommand(0x43, 0x01, pq.brightness);   // Brightness
+    queued &= enqueuePictureQualityCommand(0x45, 0x01, pq.contrast);         // Contrast
+    queued &= enqueuePictureQualityPair(0x47, pq.hueU, pq.hueV);             // Hue (U/V)
+    queued &= enqueuePictureQualityPair(0x49, pq.satU, pq.satV);             // Saturation (U/V)
+    queued &= enqueuePictureQualityCommand(0x4F, 0x01, (int8_t)pq.sharpness); // Sharpness
+    Serial.println("[I2C] Picture quality settings queued (per-field)");
+    return queued;
 }
 
 void I2CCommunicator::sendPictureQualityCommand(uint8_t cmd, uint8_t size, int8_t value) {
-    Wire.beginTransmission(I2C_ADDRESS);
-    Wire.write(cmd);
-    Wire.write(size);
-    Wire.write(value);
-    uint8_t error = Wire.endTransmission();
-    if (error) {
-        Serial.printf("[I2C] Error sending picture quality command 0x%02X: %d\n", cmd, error);
+    // 单项写入使画质影子失效
+    invalidateShadowFor(cmd);
+    enqueuePictureQualityCommand(cmd, size, value);
+}
+
+void I2CCommunicator::sendPictureQualityPair(uint8_t cmd, int8_t u, int8_t v) {
+    invalidateShadowFor(cmd);
+    enqueuePictureQualityPair(cmd, u, v);
+}
+
+bool I2CCommunicator::enqueuePictureQualityCommand(uint8_t cmd, uint8_t size, int8_t value) {
+    uint8_t frame[3] = {cmd, size, (uint8_t)value};
+    if (!enqueue(frame, sizeof(frame), logCompletion, (void*)"picture quality command")) {
+        invalidateShadowFor(cmd);
+        return false;
     }
+    return true;
+}
+
+bool I2CCommunicator::enqueuePictureQualityPair(uint8_t cmd, int8_t u, int8_t v) {
+    uint8_t frame[4] = {cmd, 0x02, (uint8_t)u, (uint8_t)v}; // OP0=2, OP1: U, OP2: V
+    if (!enqueue(frame, sizeof(frame), logCompletion, (void*)"picture quality command")) {
+        invalidateShadowFor(cmd);
+        return false;
+    }
+    return true;
 }
 
 void I2CCommunicator::sendSaveAll() {
-    Wire.beginTransmission(I2C_ADDRESS);
-    Wire.write(0x07); // 保存所有参数
-    Wire.write(0x05); // OP0
-    Wire.write(0x00); // OP1
-    Wire.write(0x00); // OP2
-    Wire.write(0x01); // OP3:保存输出位置
-    Wire.write(0x01); // OP4:保存光轴/双相位
-    Wire.write(0x01); // OP5:保存画质信息
-    Wire.endTransmission();
-    Serial.println("[I2C] Save all command sent");
+    uint8_t frame[7] = {
+        0x07, // 保存所有参数
+        0x05, // OP0
+        0x00, // OP1
+        0x00, // OP2
+        0x01, // OP3:保存输出位置
+        0x01, // OP4:保存光轴/双相位
+        0x01  // OP5:保存画质信息
+    };
+    submit(frame, sizeof(frame), logCompletion, (void*)"Save all command");
 }
 
 void I2CCommunicator::sendFactoryReset() {
-    Wire.beginTransmission(I2C_ADDRESS);
-    Wire.write(0x08); // 恢复出厂设置
-    Wire.write(0x00);
-    Wire.endTransmission();
-    Serial.println("[I2C] Factory reset command sent");
+    uint8_t frame[2] = {0x08, 0x00}; // 恢复出厂设置
+    submit(frame, sizeof(frame), logCompletion, (void*)"Factory reset command");
 }
 
 void I2CCommunicator::sendSaveAllCommand() {
@@ -156,40 +973,88 @@ void I2CCommunicator::sendFactoryResetCommand() {
 }
 
 void I2CCommunicator::handleCOM_REQ_ISR() {
-    notifyPending = true;
-    lastNotifyTime = millis();
+    if (replyArmed) {
+        // 信息请求的应答已就绪，直接唤醒工作任务读取
+        replyArmed = false;
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(workerHandle, &woken);
+        portYIELD_FROM_ISR(woken);
+        return;
+    }
+    NotifyEvent event = { (uint32_t)micros() };
+    notifyEvents.push(event);
 }
 
 void I2CCommunicator::processNotify() {
-    if (!notifyPending) return;
+    // 等待应答时已由工作任务读出的 Notify 先到达，先处理
+    StrayNotify stray;
+    while (strayNotifies.pop(stray)) {
+        notifyLength = stray.length;
+        memcpy(notifyBuffer, stray.frame, notifyLength);
+        handleNotify(stray.timestampUs);
+    }
     
-    // 读取 Notify 数据
-    Wire.requestFrom((uint8_t)I2C_ADDRESS, (uint8_t)32);
-    notifyLength = 0;
-    while (Wire.available() && notifyLength < 32) {
-        notifyBuffer[notifyLength++] = Wire.read();
+    // 按到达顺序处理所有待读的 Notify，每个事件对应一帧
+    NotifyEvent event;
+    while (notifyEvents.pop(event)) {
+        dispatchNotify(event);
     }
     
+    uint32_t overflows = notifyEvents.overflowCount();
+    if (overflows != reportedOverflows) {
+        Serial.printf("[NOTIFY] Module %d ring overflow: %lu notify events lost in total\n",
+                      id, (unsigned long)overflows);
+        reportedOverflows = overflows;
+    }
+}
+
+void I2CCommunicator::dispatchNotify(const NotifyEvent& event) {
+    // 读取 Notify 数据（经由工作任务，先读帧头再按 SIZE 读取剩余部分）
+    I2CResult frame;
+    frame.rxLength = 0;
+    if (txPending) {
+        I2CTransaction txn;
+        txn.txLength = 0;
+        txn.rxLength = 0;
+        txn.replyTimeoutMs = 0;
+        txn.notifyFrame = true;
+        txn.txData = nullptr;
+        txn.deferrable = false;
+        txn.onComplete = nullptr;
+        txn.ctx = nullptr;
+        txn.result = &frame;
+        runSync(txn);
+    }
+    notifyLength = frame.rxLength;
+    memcpy(notifyBuffer, frame.rx, notifyLength);
+    handleNotify(event.timestampUs);
+}
+
+void I2CCommunicator::handleNotify(uint32_t timestampUs) {
     // 处理 Notify 数据
     if (notifyLength >= 3) {
         uint8_t cmd = notifyBuffer[0];
         uint8_t size = notifyBuffer[1];
         uint8_t result = notifyBuffer[2];
         
-        Serial.printf("[NOTIFY] CMD: 0x%02X, Size: %d, Result: 0x%02X, Data: ", cmd, size, result);
+        // 先格式化整帧再一次输出，避免逐字节调用 Serial
+        char hex[I2C_MAX_FRAME * 3 + 1];
         for (int i = 0; i < notifyLength; i++) {
-            Serial.printf("%02X ", notifyBuffer[i]);
+            snprintf(hex + i * 3, 4, "%02X ", notifyBuffer[i]);
         }
-        Serial.println();
+        hex[notifyLength * 3] = '\0';
+        Serial.printf("[NOTIFY] Module %d CMD: 0x%02X (read %lu us after COM_REQ), Size: %d, Result: 0x%02X, Data: %s\n",
+                      id, cmd, (unsigned long)(micros() - timestampUs), size, result, hex);
         
         // 调用回调函数
         if (notifyCallback) {
-            notifyCallback(cmd, size, result, notifyBuffer, notifyLength);
+            notifyCallback(id, cmd, size, result, notifyBuffer, notifyLength);
         }
         
         switch (cmd) {
             case 0x00: // Boot Completed Notify
                 Serial.println("[NOTIFY] Boot Completed");
+                invalidateShadow();
                 if (result != 0x00) {
                     Serial.printf("[NOTIFY] Boot error: 0x%02X\n", result);
                 }
@@ -209,6 +1074,12 @@ void I2CCommunicator::processNotify() {
             
             case 0x12: // Command Emergency Notify
                 Serial.printf("[NOTIFY] Command Error: 0x%02X\n", result);
+                invalidateShadow();
+                // DATA[0] 为出错的命令：只有固件明确拒绝 0x41 时才改为逐项重发同一组画质值
+                if (notifyLength >= 4 && notifyBuffer[3] == 0x41 && pqAllState != PQ_ALL_REJECTED) {
+                    Serial.println("[I2C] 0x41 rejected by module, falling back to per-field PQ");
+                    rejectPictureQualityAll();
+                }
                 break;
             
             default:
@@ -218,30 +1089,23 @@ void I2CCommunicator::processNotify() {
     } else {
         Serial.println("[NOTIFY] Invalid notify data length");
     }
-    
-    notifyPending = false;
 }
 
 bool I2CCommunicator::sendInfoRequestAndRead(uint8_t cmd, uint8_t* response, uint8_t expectedLength) {
-    // Send request
-    Wire.beginTransmission(I2C_ADDRESS);
-    Wire.write(cmd);
-    Wire.write(0x00); // OP0=0
-    uint8_t error = Wire.endTransmission();
-    if (error) {
-        Serial.printf("[I2C] Error sending request 0x%02X: %d\n", cmd, error);
+    // Send request, wait for COM_REQ (or timeout), then read it back in one worker transaction
+    static const char* const sources[] = {"none", "irq", "poll", "timeout"};
+    uint8_t request[2] = {cmd, 0x00}; // OP0=0
+    I2CResult result;
+    transact(request, sizeof(request), result, expectedLength, COM_REQ_REPLY_TIMEOUT_MS);
+    if (result.error) {
+        Serial.printf("[I2C] Error sending request 0x%02X: %d\n", cmd, result.error);
         return false;
     }
+    Serial.printf("[I2C] Reply 0x%02X ready after %lu us (%s)\n",
+                  cmd, (unsigned long)result.replyUs, sources[result.replySource]);
     
-    // Wait for response
-    delay(50);
-    
-    // Read response
-    Wire.requestFrom((uint8_t)I2C_ADDRESS, expectedLength);
-    uint8_t readLength = 0;
-    while (Wire.available() && readLength < expectedLength) {
-        response[readLength++] = Wire.read();
-    }
+    uint8_t readLength = result.rxLength;
+    memcpy(response, result.rx, readLength);
     
     if (readLength != expectedLength) {
         Serial.printf("[I2C] Incomplete response for 0x%02X: expected %d, got %d\n", cmd, expectedLength, readLength);
@@ -257,6 +1121,116 @@ bool I2CCommunicator::sendInfoRequestAndRead(uint8_t cmd, uint8_t* response, uin
     return true;
 }
 
+bool I2CCommunicator::requestOutputPosition(int& pan, int& tilt, int& flip) {
+    // Notify: 0x25, SIZE, RESULT, OP1~OP9 同 0x26
+    uint8_t response[12];
+    if (!sendInfoRequestAndRead(0x25, response, 12)) {
+        return false;
+    }
+    
+    pan = (int8_t)response[3];
+    tilt = (int8_t)response[4];
+    flip = response[5];
+    
+    portENTER_CRITICAL(&shadowLock);
+    shadowGeometry[0] = response[3];
+    shadowGeometry[1] = response[4];
+    shadowGeometry[2] = response[5];
+    shadowValid |= SHADOW_GEOMETRY;
+    portEXIT_CRITICAL(&shadowLock);
+    
+    Serial.printf("[I2C] Output position: pan=%d tilt=%d flip=%d\n", pan, tilt, flip);
+    return true;
+}
+
+bool I2CCommunicator::requestPictureQuality(PictureQualityValues& pq) {
+    // Notify: 0x40, SIZE, RESULT, OP1~OP10 同 0x41（色调/饱和度为 U/V 分量，见 sendPictureQuality）
+    uint8_t response[13];
+    if (!sendInfoRequestAndRead(0x40, response, 13)) {
+        return false;
+    }
+    
+    pq.brightness = (int8_t)response[3];
+    pq.contrast = (int8_t)response[4];
+    pq.hueU = (int8_t)response[5];
+    pq.hueV = (int8_t)response[6];
+    pq.satU = (int8_t)response[7];
+    pq.satV = (int8_t)response[8];
+    pq.sharpness = response[9];
+    
+    portENTER_CRITICAL(&shadowLock);
+    shadowPQ = pq;
+    shadowValid |= SHADOW_PQ;
+    portEXIT_CRITICAL(&shadowLock);
+    
+    Serial.printf("[I2C] Picture quality: bright=%d contrast=%d hue=%d/%d sat=%d/%d sharp=%d\n",
+                  pq.brightness, pq.contrast, pq.hueU, pq.hueV, pq.satU, pq.satV, pq.sharpness);
+    return true;
+}
+
+bool I2CCommunicator::requestOpticalAxis(OpticalAxisOffsets& offsets) {
+    // Notify: 0x27, SIZE, RESULT, OP1~OP13 同 0x28
+    uint8_t response[16];
+    if (!sendInfoRequestAndRead(0x27, response, 16)) {
+        return false;
+    }
+    
+    for (uint8_t i = 0; i < 5; i++) {
+        offsets.horizontal[i] = (int8_t)response[3 + i];
+        offsets.vertical[i] = (int8_t)response[8 + i];
+    }
+    Serial.printf("[I2C] Optical axis H: %d %d %d %d %d, V: %d %d %d %d %d\n",
+                  offsets.horizontal[0], offsets.horizontal[1], offsets.horizontal[2],
+                  offsets.horizontal[3], offsets.horizontal[4],
+                  offsets.vertical[0], offsets.vertical[1], offsets.vertical[2],
+                  offsets.vertical[3], offsets.vertical[4]);
+    return true;
+}
+
+uint8_t I2CCommunicator::setOpticalAxis(const OpticalAxisOffsets& offsets) {
+    uint8_t frame[15] = {
+        0x28,       // Set Optical Axis
+        0x0D        // OP0
+                    // OP1-OP5: 水平偏移, OP6-OP10: 垂直偏移, OP11-OP13: Reserved (0x00)
+    };
+    for (uint8_t i = 0; i < 5; i++) {
+        frame[2 + i] = (uint8_t)offsets.horizontal[i];
+        frame[7 + i] = (uint8_t)offsets.vertical[i];
+    }
+    I2CResult result;
+    transact(frame, sizeof(frame), result);
+    logCompletion(result, (void*)"optical axis");
+    return result.error;
+}
+
+bool I2CCommunicator::requestBiPhase(uint32_t& value) {
+    // Notify: 0x29, SIZE, RESULT, DD CC BB AA
+    uint8_t response[7];
+    if (!sendInfoRequestAndRead(0x29, response, 7)) {
+        return false;
+    }
+    
+    value = ((uint32_t)response[3] << 24) | ((uint32_t)response[4] << 16) |
+            ((uint32_t)response[5] << 8) | response[6];
+    Serial.printf("[I2C] Bi-Phase: 0x%08lX\n", (unsigned long)value);
+    return true;
+}
+
+uint8_t I2CCommunicator::setBiPhase(uint32_t value) {
+    uint8_t frame[6] = {
+        0x2A,                           // Set Bi-Phase
+        0x04,                           // OP0
+        (uint8_t)(value >> 24),         // OP1: DD
+        (uint8_t)(value >> 16),         // OP2: CC
+        (uint8_t)(value >> 8),          // OP3: BB
+        (uint8_t)value                  // OP4: AA
+    };
+    I2CResult result;
+    transact(frame, sizeof(frame), result);
+    logCompletion(result, (void*)"bi-phase");
+    return result.error;
+}
+
 bool I2CCommunicator::requestTemperature(int& temperature, int& muteThreshold, int& stopThreshold) {
     uint8_t response[6];
     if (!sendInfoRequestAndRead(0xA0, response, 6)) {
@@ -329,8 +1303,9 @@ String I2CCommunicator::parseSerialNumber(const uint8_t* data, uint8_t startInde
 }
 
 bool I2CCommunicator::requestVersion(String& firmware, String& parameter, String& data) {
-    uint8_t response[14];
-    if (!sendInfoRequestAndRead(0xA2, response, 14)) {
+    // Notify: 0xA2, SIZE, RESULT, 固件版(4) 参数版(4) 数据版(4)
+    uint8_t response[15];
+    if (!sendInfoRequestAndRead(0xA2, response, 15)) {
         return false;
     }
     
@@ -2,32 +2,212 @@
 #define I2C_COMMUNICATOR_H
 
 #include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include "config.h"
 #include "eeprom_manager.h"
+#include "spsc_ring.h"
+#include "cxn0102_protocol.h"
+#include "i2c_bus.h"
 
-// 通知回调函数类型
-typedef void (*NotifyCallback)(uint8_t cmd, uint8_t size, uint8_t result, const uint8_t* data, uint8_t length);
+// 通知回调函数类型；module 为发出 Notify 的模块 ID（0 为主模块）
+typedef void (*NotifyCallback)(uint8_t module, uint8_t cmd, uint8_t size, uint8_t result,
+                               const uint8_t* data, uint8_t length);
+
+// 总线事务结果
+struct I2CResult {
+    uint8_t cmd;                 // 事务命令字节（tx[0]）
+    uint8_t error;               // Wire.endTransmission 返回值，0=成功
+    uint8_t rxLength;            // 实际读取的字节数
+    uint32_t replyUs;            // 写入结束到应答就绪的耗时（微秒）
+    uint8_t replySource;         // 应答就绪的判定方式，见 ReplySource
+    uint8_t attempts;            // 写入尝试次数（含自动重试）
+    uint8_t rx[I2C_MAX_FRAME];
+};
+
+// I2CResult::error 中的本地错误码（Wire 返回值为 0~5）
+enum I2CLocalError : uint8_t {
+    I2C_ERROR_STATE = 0xFE,      // 模块当前状态不允许该命令，未发送
+    I2C_ERROR_INVALID = 0xFF     // 参数无效或未初始化
+};
+
+// 模块状态统计
+struct ModuleStateStats {
+    uint32_t deferred;           // 因状态不符推迟的命令
+    uint32_t rejected;           // 因状态不符直接拒绝的命令
+    uint32_t flushed;            // 状态切换后补发的推迟命令
+    uint32_t transitions;
+};
+
+// 总线速率状态
+struct I2CClockStats {
+    uint32_t clockHz;            // 当前速率
+    uint32_t probedHz;           // 启动探测得到的速率（0 = 未探测）
+    uint32_t fallbacks;          // 运行期自动降速次数
+    uint32_t lastFallbackFromHz;
+    unsigned long lastFallbackAt;  // millis()
+};
+
+// 重试与总线恢复统计
+struct I2CRecoveryStats {
+    uint32_t retries;            // 自动重试次数
+    uint32_t recovered;          // 重试后成功的事务
+    uint32_t surfaced;           // 不可重试或重试用尽、返回给调用者的失败
+    uint32_t sclToggles;         // SDA 被拉低时通过 SCL 脉冲释放总线的次数
+    uint32_t reinits;            // Wire 重新初始化次数
+};
+
+// 优先级通道统计（延迟为提交到完成，含排队时间）
+struct I2CLaneStats {
+    uint32_t count;              // 完成的事务数
+    uint32_t dropped;            // 通道队列满被丢弃的异步事务
+    uint32_t preemptions;        // 越过已排队的低优先级事务先执行的次数
+    uint32_t maxLatencyUs;
+    uint64_t totalLatencyUs;
+};
+
+// 应答就绪的判定方式
+enum ReplySource : uint8_t {
+    REPLY_NONE = 0,      // 无需等待应答
+    REPLY_IRQ,           // COM_REQ 上升沿中断
+    REPLY_POLL,          // 轮询到 COM_REQ 高电平（错过边沿）
+    REPLY_TIMEOUT        // 超时，按原方式直接读取
+};
+
+// 编码后的画质分量（即 0x43~0x4F 各命令的 OP 值）
+struct PictureQualityValues {
+    int8_t brightness;   // -31~+31
+    int8_t contrast;     // -15~+15
+    int8_t hueU;         // -15~+15
+    int8_t hueV;
+    int8_t satU;         // -15~+15
+    int8_t satV;
+    uint8_t sharpness;   // 0~8
+};
+
+// 光轴偏移（0x27/0x28 的 OP1~OP10），顺序为 R0/R1/G0/G1/B
+struct OpticalAxisOffsets {
+    int8_t horizontal[5];    // 水平偏移，1/8 像素步进
+    int8_t vertical[5];      // 垂直偏移，1/2 像素步进
+};
+
+// COM_REQ 事件（由中断写入环形缓冲）
+struct NotifyEvent {
+    uint32_t timestampUs;        // 上升沿时刻 micros()
+};
+
+// 等待应答时先读到的主动 Notify（工作任务已读出整帧，交给 loop 处理）
+struct StrayNotify {
+    uint32_t timestampUs;
+    uint8_t length;
+    uint8_t frame[I2C_MAX_FRAME];
+};
+
+// 延迟直方图各桶上限（微秒），最后一桶为其余所有
+static constexpr uint32_t I2C_LATENCY_BOUNDS_US[I2C_STATS_BUCKETS - 1] = {
+    250, 500, 1000, 2000, 5000, 10000, 50000
+};
+
+// 单个命令的总线统计（CMD 0x00 的只读事务即 Notify 读取）
+struct I2CCommandStats {
+    uint8_t cmd;
+    uint32_t count;              // 事务数
+    uint32_t nacks;              // 地址/数据 NACK（endTransmission 返回 2/3）
+    uint32_t busErrors;          // 其他 Wire 错误
+    uint32_t timeouts;           // 等待 COM_REQ 超时
+    uint32_t shortReads;         // 读取字节数少于请求
+    uint32_t txBytes;
+    uint32_t rxBytes;
+    uint32_t maxUs;
+    uint64_t totalUs;
+    uint32_t buckets[I2C_STATS_BUCKETS];
+};
+
+// 事务完成回调（在 I2C 工作任务中执行，不要在其中长时间阻塞）
+typedef void (*I2CCompletion)(const I2CResult& result, void* ctx);
+
+// 队列中的一个总线事务：写入 tx，可选等待后读取 rxLength 字节
+struct I2CTransaction {
+    uint8_t tx[I2C_MAX_FRAME];
+    const uint8_t* txData;       // 非空时写入调用者的缓冲而不是 tx（大块数据）
+    uint8_t txLength;            // 0 = 只读（Notify）
+    uint8_t rxLength;            // 0 = 只写
+    uint16_t replyTimeoutMs;     // 非0时写入后等待 COM_REQ 再读取，超时仍读取
+    bool notifyFrame;            // 按帧头 SIZE 分两段读取 Notify（忽略 rxLength）
+    bool deferrable;             // 状态不符时可推迟；否则以 I2C_ERROR_STATE 拒绝
+    I2CCompletion onComplete;
+    void* ctx;
+    I2CResult* result;           // 同步调用时的结果存放位置
+    TaskHandle_t waiter;         // 同步调用者，完成后通知
+    uint8_t lane;                // CxnLane，入队时按命令确定
+    uint32_t queuedUs;           // 入队时的 micros()
+};
 
 class I2CCommunicator {
 public:
     I2CCommunicator();
     
-    // 初始化 I2C
+    // 绑定总线、地址、复用器通道和 COM_REQ 引脚（在 begin 之前调用，默认为单模块配置）
+    void attach(I2CBus* bus, uint8_t id, uint8_t address, int8_t muxChannel, uint8_t comReqPin);
+    
+    // 初始化 I2C 并启动总线工作任务
     void begin(NotifyCallback callback = nullptr);
     
-    // 发送梯形校正和翻转
-    void sendKeystoneAndFlip(int pan, int tilt, int flip);
+    uint8_t getId() const { return id; }
+    uint8_t getAddress() const { return address; }
+    int8_t getMuxChannel() const { return muxChannel; }
+    uint8_t getComReqPin() const { return comReqPin; }
+    I2CBus* getBus() const { return bus; }
+    
+    // 设置总线速率（由工作任务在下一个事务前生效）
+    void setClock(uint32_t hz);
+    
+    // 启动探测：从 I2C_CLOCK_FAST_HZ 开始用信息读取检验可靠性，失败则逐档降速
+    uint32_t probeClock();
+    
+    I2CClockStats getClockStats() const { return clockStats; }
+    I2CRecoveryStats getRecoveryStats() const { return recoveryStats; }
+    
+    // 异步提交事务，立即返回；队列满时返回 false
+    // deferrable 为 false 时模块状态不允许的命令不推迟，直接以 I2C_ERROR_STATE 完成
+    bool submit(const uint8_t* frame, uint8_t length,
+                I2CCompletion onComplete = nullptr, void* ctx = nullptr, bool deferrable = true);
+    
+    // 异步提交调用者持有的大缓冲（最多 I2C_WIRE_BUFFER 字节，不复制）
+    // 缓冲须保持有效直到 onComplete 被调用；可选等待 COM_REQ 后读取应答
+    bool submitBuffer(const uint8_t* frame, uint8_t length, uint8_t responseLength,
+                      uint16_t replyTimeoutMs, I2CCompletion onComplete, void* ctx);
+    
+    // 同步事务：写入 frame，等待 COM_REQ（最多 replyTimeoutMs）后读取 responseLength 字节
+    // 由工作任务执行，调用者阻塞直到完成；length=0 时只读（Notify）
+    bool transact(const uint8_t* frame, uint8_t length, I2CResult& result,
+                  uint8_t responseLength = 0, uint16_t replyTimeoutMs = 0);
+    
+    // 发送梯形校正和翻转；与影子相同（无需写入）或已入队返回 true，队列已满返回 false
+    bool sendKeystoneAndFlip(int pan, int tilt, int flip);
     
     // 发送测试图案
     void sendTestPattern(uint8_t pattern, uint8_t generalSetting = 0x00,
                         uint8_t bgR = 0x00, uint8_t bgG = 0x00, uint8_t bgB = 0x00,
                         uint8_t fgR = 0xFF, uint8_t fgG = 0xFF, uint8_t fgB = 0xFF);
     
-    // 发送图片质量设置
-    void sendPictureQuality(const SystemSettings& settings);
+    // 发送图片质量设置（优先使用 0x41 一次写入，模块不支持时逐项发送）；返回值同上
+    bool sendPictureQuality(const SystemSettings& settings);
+    
+    // 将 EEPROM 中 0~255 的画质设置换算为模块分量值
+    static PictureQualityValues encodePictureQuality(const SystemSettings& settings);
+    
+    // encodePictureQuality 的逆运算，结果再编码时得到相同的分量值
+    static void decodePictureQuality(const PictureQualityValues& pq, SystemSettings& settings);
     
     // 发送单个图片质量命令（用于亮度、对比度、锐度）
     void sendPictureQualityCommand(uint8_t cmd, uint8_t size, int8_t value);
     
+    // 发送U/V双分量图片质量命令（用于色调、饱和度）
+    void sendPictureQualityPair(uint8_t cmd, int8_t u, int8_t v);
+    
     // 发送保存所有参数命令
     void sendSaveAll();
     
@@ -43,9 +223,50 @@ public:
     // 中断服务例程
     void handleCOM_REQ_ISR();
     
-    // 处理通知（在loop中调用）
+    // 处理通知：依次读取并分发所有已到达的 Notify（在loop中调用）
     void processNotify();
     
+    // 因环形缓冲满而丢失的 Notify 事件数
+    uint32_t getNotifyOverflows() const { return notifyEvents.overflowCount(); }
+    
+    // 复制分命令统计到 out（最多 maxEntries 条），返回条数
+    uint8_t getCommandStats(I2CCommandStats* out, uint8_t maxEntries);
+    
+    // 清空全部统计
+    void resetCommandStats();
+    
+    // 优先级通道统计（lane 为 CxnLane）
+    I2CLaneStats getLaneStats(uint8_t lane);
+    static const char* laneName(uint8_t lane);
+    
+    // 模块状态（CxnState 之一，0 = 未知，此时不限制命令）
+    // 由 Start/Stop/调整类命令的成功写入以及 Boot/Command Error 等 Notify 驱动
+    uint8_t getModuleState() const { return moduleState; }
+    static const char* moduleStateName(uint8_t state);
+    ModuleStateStats getModuleStateStats() const { return stateStats; }
+    
+    // 影子寄存器：与模块最后确认的几何/画质相同的写入会被跳过
+    // 模块重启、恢复出厂、Command Error 或写入失败时失效
+    void invalidateShadow();
+    uint32_t getShadowSkips() const { return shadowSkips; }
+    
+    // 模块是否支持分段读取 Notify（帧头后接着读取剩余字节）
+    bool supportsSplitNotifyReads() const { return splitReads != SPLIT_UNSUPPORTED; }
+    
+    // 读取模块当前的平移/倾斜/翻转（0x25），成功时同步几何影子
+    bool requestOutputPosition(int& pan, int& tilt, int& flip);
+    
+    // 读取模块当前的全部画质分量（0x40），成功时同步画质影子
+    bool requestPictureQuality(PictureQualityValues& pq);
+    
+    // 读取/设置光轴偏移（0x27/0x28，绝对值一次写入）
+    bool requestOpticalAxis(OpticalAxisOffsets& offsets);
+    uint8_t setOpticalAxis(const OpticalAxisOffsets& offsets);
+    
+    // 读取/设置双相位校正值（0x29/0x2A，DDCCBBAA：OP1=DD ... OP4=AA）
+    bool requestBiPhase(uint32_t& value);
+    uint8_t setBiPhase(uint32_t value);
+    
     // 请求温度信息
     bool requestTemperature(int& temperature, int& muteThreshold, int& stopThreshold);
     
@@ -62,11 +283,104 @@ public:
     bool requestSerialNumber(String& serialNumber);
     
 private:
+    I2CBus* bus;
+    uint8_t id;
+    uint8_t address;
+    int8_t muxChannel;
+    uint8_t comReqPin;
+    
     NotifyCallback notifyCallback;
-    volatile bool notifyPending;
+    SpscRing<NotifyEvent, NOTIFY_RING_SIZE> notifyEvents;  // ISR 生产，loop 消费
+    SpscRing<StrayNotify, NOTIFY_STRAY_RING_SIZE> strayNotifies;  // 工作任务生产，loop 消费
     uint8_t notifyBuffer[32];
     uint8_t notifyLength;
-    unsigned long lastNotifyTime;
+    uint32_t reportedOverflows;   // 已输出过日志的环形缓冲溢出计数
+    
+    // 每个优先级通道一个队列；txPending 计数所有通道中的事务，工作任务等待它
+    QueueHandle_t txQueues[CXN_LANE_COUNT];
+    SemaphoreHandle_t txPending;
+    TaskHandle_t workerHandle;
+    volatile bool replyArmed;    // 工作任务正在等待 COM_REQ 应答
+    
+    // 分段读取支持情况：第二段若从帧头重新开始，则判定为不支持
+    enum SplitReadState : uint8_t { SPLIT_UNKNOWN, SPLIT_OK, SPLIT_UNSUPPORTED };
+    uint8_t splitReads;
+    
+    // 分命令统计（工作任务写入，其他任务读取时加锁复制）
+    portMUX_TYPE statsLock = portMUX_INITIALIZER_UNLOCKED;
+    I2CCommandStats stats[I2C_STATS_SLOTS];
+    uint8_t statsUsed;
+    I2CLaneStats laneStats[CXN_LANE_COUNT];
+    
+    // 总线速率（pendingClock 非0时由工作任务应用）
+    volatile uint32_t pendingClock;
+    I2CClockStats clockStats;
+    uint16_t windowTxns;
+    uint16_t windowFailures;
+    
+    // 重试与总线恢复
+    I2CRecoveryStats recoveryStats;
+    uint8_t consecutiveFailures;
+    
+    // 模块状态机与推迟队列（仅由工作任务访问）
+    volatile uint8_t moduleState;
+    ModuleStateStats stateStats;
+    I2CTransaction deferred[I2C_DEFER_SLOTS];
+    uint8_t deferredCount;
+    
+    // 影子寄存器（几何即 0x26 的 pan/tilt/flip，画质为编码后的分量值）
+    enum ShadowBits : uint8_t { SHADOW_GEOMETRY = 1 << 0, SHADOW_PQ = 1 << 1, SHADOW_ALL = 0x03 };
+    portMUX_TYPE shadowLock = portMUX_INITIALIZER_UNLOCKED;
+    uint8_t shadowValid;
+    uint8_t shadowGeometry[3];
+    PictureQualityValues shadowPQ;
+    volatile uint32_t shadowSkips;
+    
+    // 0x41 支持情况：未知/支持/被拒绝（拒绝后本次上电内改为逐项发送）
+    enum PQAllState : uint8_t { PQ_ALL_UNKNOWN, PQ_ALL_OK, PQ_ALL_REJECTED };
+    volatile uint8_t pqAllState;
+    PictureQualityValues lastPQ;
+    
+    static void comReqISR(void* arg);
+    
+    // 工作任务：本模块唯一访问总线的上下文（与同一总线上的其他模块经 I2CBus 互斥）
+    static void workerTask(void* arg);
+    void execute(I2CTransaction& txn);
+    bool enqueue(const uint8_t* frame, uint8_t length, I2CCompletion onComplete, void* ctx,
+                 bool deferrable = true);
+    void invalidateShadowFor(uint8_t cmd);
+    void runSync(I2CTransaction& txn);
+    bool post(I2CTransaction& txn, TickType_t wait);
+    bool lanePending(uint8_t belowLane);
+    bool receiveNext(I2CTransaction& txn, uint8_t belowLane);
+    void backoff(uint8_t lane, TickType_t ticks);
+    void recordLane(const I2CTransaction& txn);
+    bool admit(I2CTransaction& txn, I2CResult& result);
+    void setModuleState(uint8_t state, const char* reason);
+    void applyCommandState(const uint8_t* tx, uint8_t length);
+    void applyNotifyState(const I2CResult& notify);
+    void flushDeferred();
+    uint8_t waitForReply(uint16_t timeoutMs);
+    uint8_t readInto(I2CResult& result, uint8_t count);
+    void readNotifyFrame(I2CResult& result);
+    void readReply(const I2CTransaction& txn, uint8_t cmd, I2CResult& result);
+    void forwardStray(const I2CResult& frame, uint8_t waitingFor);
+    bool recordStats(const I2CTransaction& txn, const I2CResult& result, uint32_t cycles);
+    void applyClock(uint32_t hz);
+    void writeWithReply(I2CTransaction& txn, const uint8_t* tx, I2CResult& result);
+    void recoverBus();
+    void trackFailureRate(bool failed);
+    
+    // 异步写入完成后打印结果
+    static void logCompletion(const I2CResult& result, void* ctx);
+    static void onPictureQualityAllComplete(const I2CResult& result, void* ctx);
+    
+    bool sendPictureQualityFields(const PictureQualityValues& pq);
+    bool enqueuePictureQualityCommand(uint8_t cmd, uint8_t size, int8_t value);
+    bool enqueuePictureQualityPair(uint8_t cmd, int8_t u, int8_t v);
+    void dispatchNotify(const NotifyEvent& event);
+    void handleNotify(uint32_t timestampUs);
+    void rejectPictureQualityAll();
     
     // 内部辅助函数
     bool sendInfoRequestAndRead(uint8_t cmd, uint8_t* response, uint8_t expectedLength);
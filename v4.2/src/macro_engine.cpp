@@ -0,0 +1,490 @@
+#include "macro_engine.h"
+#include <SPIFFS.h>
+#include "storage.h"
+
+static const uint8_t MACRO_MAGIC[4] = {'M', 'A', 'C', 1};   // 最后一字节为格式版本
+
+static String macroPath(uint8_t slot) {
+    return "/macro" + String(slot) + ".bin";
+}
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// 解析连续的十六进制串到 out（长度须为偶数）
+static bool parseHex(const String& text, uint8_t* out) {
+    for (unsigned int i = 0; i + 1 < text.length(); i += 2) {
+        int hi = hexValue(text[i]);
+        int lo = hexValue(text[i + 1]);
+        if (hi < 0 || lo < 0) return false;
+        out[i / 2] = (uint8_t)((hi << 4) | lo);
+    }
+    return text.length() % 2 == 0;
+}
+
+// 解析 0~maxValue 的十进制数
+static bool parseNumber(const String& text, long maxValue, long& value) {
+    if (text.length() == 0 || text.length() > 5) return false;
+    for (unsigned int i = 0; i < text.length(); i++) {
+        if (!isDigit(text[i])) return false;
+    }
+    value = text.toInt();
+    return value <= maxValue;
+}
+
+static bool compileError(String& error, uint8_t step, const char* reason) {
+    error = "Step " + String(step) + ": " + reason;
+    return false;
+}
+
+// 返回 pc 处指令的字节数，越界或未知操作码时返回 0
+static uint16_t instructionSize(const uint8_t* code, uint16_t pc, uint16_t length) {
+    uint16_t size;
+    switch (code[pc]) {
+        case MACRO_OP_CMD: size = 2; break;
+        case MACRO_OP_SEND: size = pc + 1 < length ? 2 + code[pc + 1] : 0; break;
+        case MACRO_OP_WAIT: size = 3; break;
+        case MACRO_OP_NOTIFY: size = 4; break;
+        default: size = 0; break;
+    }
+    return pc + size <= length ? size : 0;
+}
+
+MacroEngine::MacroEngine()
+    : cmdHandler(nullptr), projectors(nullptr), macros(), program(), programLength(0), pc(0),
+      state(MACRO_IDLE), abortRequested(false), pendingWrites(0), stepError(0), waitNotifyCmd(0),
+      timer(nullptr), status(), startedAt(0), savedLoaded(false), loadLock(nullptr) {
+    status.slot = -1;
+}
+
+void MacroEngine::begin(CommandHandler* cmdHandler, ProjectorRegistry* projectors) {
+    this->cmdHandler = cmdHandler;
+    this->projectors = projectors;
+    timer = xTimerCreate("macro", 1, pdFALSE, this, onTimer);
+    loadLock = xSemaphoreCreateMutex();
+    
+    // 先用默认宏；保存的宏在第一次使用时载入，启动时不挂载 SPIFFS
+    for (uint8_t slot = 0; slot < MACRO_SLOTS; slot++) {
+        loadDefault(slot, macros[slot]);
+    }
+}
+
+void MacroEngine::ensureLoaded() {
+    if (savedLoaded || !loadLock) return;
+    
+    xSemaphoreTake(loadLock, portMAX_DELAY);
+    if (!savedLoaded) {
+        uint8_t loaded = 0;
+        for (uint8_t slot = 0; slot < MACRO_SLOTS && mountStorage(); slot++) {
+            Macro macro;
+            if (!load(slot, macro)) continue;
+            portENTER_CRITICAL(&lock);
+            macros[slot] = macro;
+            portEXIT_CRITICAL(&lock);
+            loaded++;
+        }
+        savedLoaded = true;
+        Serial.printf("[MACRO] %d saved macro(s) loaded\n", loaded);
+    }
+    xSemaphoreGive(loadLock);
+}
+
+void MacroEngine::loadDefault(uint8_t slot, Macro& macro) {
+    memset(&macro, 0, sizeof(macro));
+    if (slot != MACRO_BUTTON_SLOT) return;
+    
+    String error;
+    strncpy(macro.name, "Button", MACRO_NAME_LEN - 1);
+    compile(MACRO_BUTTON_DEFAULT, macro.code, macro.length, error);
+}
+
+bool MacroEngine::load(uint8_t slot, Macro& macro) {
+    String path = macroPath(slot);
+    if (!SPIFFS.exists(path)) return false;
+    File file = SPIFFS.open(path, "r");
+    if (!file) return false;
+    
+    memset(&macro, 0, sizeof(macro));
+    uint8_t magic[sizeof(MACRO_MAGIC)];
+    bool ok = file.read(magic, sizeof(magic)) == sizeof(magic) &&
+              memcmp(magic, MACRO_MAGIC, sizeof(magic)) == 0 &&
+              file.read((uint8_t*)macro.name, sizeof(macro.name)) == sizeof(macro.name) &&
+              file.read((uint8_t*)&macro.length, sizeof(macro.length)) == sizeof(macro.length) &&
+              macro.length <= MACRO_MAX_BYTES &&
+              file.read(macro.code, macro.length) == macro.length;
+    file.close();
+    macro.name[MACRO_NAME_LEN - 1] = '\0';
+    
+    if (!ok) {
+        Serial.printf("[MACRO] %s invalid, ignored\n", path.c_str());
+    }
+    return ok;
+}
+
+bool MacroEngine::compile(const String& script, uint8_t* code, uint16_t& length, String& error) {
+    length = 0;
+    uint8_t stepNo = 0;
+    int start = 0;
+    while (start <= (int)script.length()) {
+        int end = start;
+        while (end < (int)script.length() && script[end] != ';' && script[end] != '\n') end++;
+        String text = script.substring(start, end);
+        start = end + 1;
+        text.trim();
+        if (text.length() == 0) continue;
+        stepNo++;
+        
+        int space = text.indexOf(' ');
+        String op = space < 0 ? text : text.substring(0, space);
+        String arg = space < 0 ? String() : text.substring(space + 1);
+        arg.trim();
+        
+        uint8_t insn[2 + I2C_MAX_FRAME];
+        uint8_t n = 0;
+        long value;
+        if (op == "cmd") {
+            if (!parseNumber(arg, CMD_COUNT, value) || value < 1) {
+                return compileError(error, stepNo, "invalid command index");
+            }
+            insn[n++] = MACRO_OP_CMD;
+            insn[n++] = (uint8_t)value;
+        } else if (op == "send") {
+            uint8_t frameLength = arg.length() / 2;
+            if (arg.length() % 2 || frameLength < 2 || frameLength > I2C_MAX_FRAME ||
+                !parseHex(arg, insn + 2)) {
+                return compileError(error, stepNo, "invalid frame");
+            }
+            // 规格表收录的命令检查 OP0 与帧长
+            int op0 = cxnOp0Size(insn[2]);
+            if (op0 >= 0 && (insn[3] != op0 || frameLength != 2 + op0)) {
+                return compileError(error, stepNo, "frame length does not match spec");
+            }
+            insn[n++] = MACRO_OP_SEND;
+            insn[n++] = frameLength;
+            n += frameLength;
+        } else if (op == "wait") {
+            if (!parseNumber(arg, 65535, value)) {
+                return compileError(error, stepNo, "invalid wait (0-65535 ms)");
+            }
+            insn[n++] = MACRO_OP_WAIT;
+            insn[n++] = (value >> 8) & 0xFF;
+            insn[n++] = value & 0xFF;
+        } else if (op == "notify") {
+            int split = arg.indexOf(' ');
+            String cmdText = split < 0 ? arg : arg.substring(0, split);
+            String msText = split < 0 ? String(MACRO_NOTIFY_TIMEOUT_MS) : arg.substring(split + 1);
+            msText.trim();
+            uint8_t cmd;
+            if (cmdText.length() != 2 || !parseHex(cmdText, &cmd) ||
+                !parseNumber(msText, 65535, value) || value == 0) {
+                return compileError(error, stepNo, "invalid notify (hex command, 1-65535 ms)");
+            }
+            insn[n++] = MACRO_OP_NOTIFY;
+            insn[n++] = cmd;
+            insn[n++] = (value >> 8) & 0xFF;
+            insn[n++] = value & 0xFF;
+        } else {
+            return compileError(error, stepNo, "unknown step (cmd/send/wait/notify)");
+        }
+        
+        if (length + n > MACRO_MAX_BYTES) {
+            return compileError(error, stepNo, "macro too long");
+        }
+        memcpy(code + length, insn, n);
+        length += n;
+    }
+    
+    if (length == 0) {
+        error = "Empty macro";
+        return false;
+    }
+    return true;
+}
+
+String MacroEngine::decompile(const uint8_t* code, uint16_t length) {
+    String script;
+    char hex[3];
+    uint16_t pc = 0;
+    while (pc < length) {
+        uint16_t size = instructionSize(code, pc, length);
+        if (!size) break;
+        
+        const uint8_t* op = code + pc;
+        if (script.length()) script += "; ";
+        switch (op[0]) {
+            case MACRO_OP_CMD:
+                script += "cmd " + String(op[1]);
+                break;
+            case MACRO_OP_SEND:
+                script += "send ";
+                for (uint8_t i = 0; i < op[1]; i++) {
+                    snprintf(hex, sizeof(hex), "%02X", op[2 + i]);
+                    script += hex;
+                }
+                break;
+            case MACRO_OP_WAIT:
+                script += "wait " + String((op[1] << 8) | op[2]);
+                break;
+            case MACRO_OP_NOTIFY:
+                snprintf(hex, sizeof(hex), "%02X", op[1]);
+                script += "notify " + String(hex) + " " + String((op[2] << 8) | op[3]);
+                break;
+        }
+        pc += size;
+    }
+    return script;
+}
+
+bool MacroEngine::save(uint8_t slot, const String& name, const String& script, String& error) {
+    if (slot >= MACRO_SLOTS) {
+        error = "Invalid slot";
+        return false;
+    }
+    
+    Macro macro;
+    memset(&macro, 0, sizeof(macro));
+    if (!compile(script, macro.code, macro.length, error)) return false;
+    strncpy(macro.name, name.c_str(), MACRO_NAME_LEN - 1);
+    
+    // 先载入其它已保存的宏，之后的延迟载入不会覆盖本次保存
+    ensureLoaded();
+    File file;
+    if (mountStorage()) {
+        file = SPIFFS.open(macroPath(slot), "w");
+    }
+    if (!file) {
+        error = "Failed to open macro file";
+        return false;
+    }
+    bool ok = file.write(MACRO_MAGIC, sizeof(MACRO_MAGIC)) == sizeof(MACRO_MAGIC) &&
+              file.write((const uint8_t*)macro.name, sizeof(macro.name)) == sizeof(macro.name) &&
+              file.write((const uint8_t*)&macro.length, sizeof(macro.length)) == sizeof(macro.length) &&
+              file.write(macro.code, macro.length) == macro.length;
+    file.close();
+    if (!ok) {
+        error = "Macro file write failed";
+        return false;
+    }
+    
+    portENTER_CRITICAL(&lock);
+    macros[slot] = macro;
+    portEXIT_CRITICAL(&lock);
+    Serial.printf("[MACRO] Slot %d saved: \"%s\", %d bytes\n", slot, macro.name, macro.length);
+    return true;
+}
+
+bool MacroEngine::remove(uint8_t slot) {
+    if (slot >= MACRO_SLOTS) return false;
+    ensureLoaded();
+    String path = macroPath(slot);
+    if (mountStorage() && SPIFFS.exists(path)) {
+        SPIFFS.remove(path.c_str());
+    }
+    
+    Macro macro;
+    loadDefault(slot, macro);
+    portENTER_CRITICAL(&lock);
+    macros[slot] = macro;
+    portEXIT_CRITICAL(&lock);
+    Serial.printf("[MACRO] Slot %d cleared\n", slot);
+    return true;
+}
+
+const char* MacroEngine::getName(uint8_t slot) const {
+    return slot < MACRO_SLOTS ? macros[slot].name : "";
+}
+
+uint16_t MacroEngine::getLength(uint8_t slot) const {
+    return slot < MACRO_SLOTS ? macros[slot].length : 0;
+}
+
+String MacroEngine::getScript(uint8_t slot) const {
+    return slot < MACRO_SLOTS ? decompile(macros[slot].code, macros[slot].length) : String();
+}
+
+bool MacroEngine::run(uint8_t slot) {
+    if (!cmdHandler || !projectors || slot >= MACRO_SLOTS) return false;
+    
+    portENTER_CRITICAL(&lock);
+    bool startable = state == MACRO_IDLE && macros[slot].length > 0;
+    if (startable) {
+        state = MACRO_RUNNING;
+        memcpy(program, macros[slot].code, macros[slot].length);
+        programLength = macros[slot].length;
+        pc = 0;
+        abortRequested = false;
+        status.slot = slot;
+        status.steps = 0;
+        status.error = nullptr;
+        startedAt = millis();
+    }
+    portEXIT_CRITICAL(&lock);
+    if (!startable) return false;
+    
+    Serial.printf("[MACRO] Running slot %d \"%s\"\n", slot, macros[slot].name);
+    step();
+    return true;
+}
+
+void MacroEngine::stop() {
+    abortRequested = true;
+    // 等待中的宏立即结束；写入中的宏在本步完成后由 step() 结束
+    if (claim(MACRO_WAIT_TIMER) || claim(MACRO_WAIT_NOTIFY)) {
+        xTimerStop(timer, 0);
+        finish("Stopped");
+    }
+}
+
+MacroStatus MacroEngine::getStatus() {
+    portENTER_CRITICAL(&lock);
+    MacroStatus s = status;
+    s.state = state;
+    portEXIT_CRITICAL(&lock);
+    
+    if (s.state != MACRO_IDLE) {
+        s.elapsedMs = millis() - startedAt;
+    }
+    return s;
+}
+
+const char* MacroEngine::stateName(uint8_t state) {
+    switch (state) {
+        case MACRO_IDLE: return "Idle";
+        case MACRO_RUNNING: return "Running";
+        case MACRO_WAIT_BUS: return "Writing";
+        case MACRO_WAIT_TIMER: return "Waiting";
+        case MACRO_WAIT_NOTIFY: return "Waiting for notify";
+        default: return "Unknown";
+    }
+}
+
+void MacroEngine::onNotify(uint8_t cmd) {
+    if (state != MACRO_WAIT_NOTIFY || cmd != waitNotifyCmd) return;
+    if (!claim(MACRO_WAIT_NOTIFY)) return;
+    xTimerStop(timer, 0);
+    step();
+}
+
+bool MacroEngine::claim(uint8_t expected) {
+    portENTER_CRITICAL(&lock);
+    bool owned = state == expected;
+    if (owned) state = MACRO_RUNNING;
+    portEXIT_CRITICAL(&lock);
+    return owned;
+}
+
+void MacroEngine::step() {
+    if (abortRequested) {
+        finish("Stopped");
+        return;
+    }
+    if (pc >= programLength) {
+        finish(nullptr);
+        return;
+    }
+    uint16_t size = instructionSize(program, pc, programLength);
+    if (!size) {
+        finish("Invalid bytecode");
+        return;
+    }
+    
+    const uint8_t* op = program + pc;
+    pc += size;
+    status.steps++;
+    switch (op[0]) {
+        case MACRO_OP_CMD: {
+            const CommandFrame* frame = cmdHandler->getCommand(op[1] - 1);
+            if (!frame) {
+                finish("Invalid command index");
+                return;
+            }
+            sendFrame(frame->bytes, frame->length);
+            break;
+        }
+        case MACRO_OP_SEND:
+            sendFrame(op + 2, op[1]);
+            break;
+        case MACRO_OP_WAIT:
+            startTimer((op[1] << 8) | op[2], MACRO_WAIT_TIMER);
+            break;
+        case MACRO_OP_NOTIFY:
+            waitNotifyCmd = op[1];
+            startTimer((op[2] << 8) | op[3], MACRO_WAIT_NOTIFY);
+            break;
+    }
+}
+
+void MacroEngine::sendFrame(const uint8_t* frame, uint8_t length) {
+    uint8_t count = projectors->count();
+    portENTER_CRITICAL(&lock);
+    pendingWrites = count;
+    stepError = 0;
+    state = MACRO_WAIT_BUS;
+    portEXIT_CRITICAL(&lock);
+    
+    // 完成回调可能在 broadcast 返回前就已执行；未能入队的模块按失败计
+    // 不允许推迟：状态不符的命令立即以 I2C_ERROR_STATE 完成（跳过），否则本步要等到模块切换状态
+    uint8_t queued = projectors->broadcast(frame, length, onFrameComplete, this, false);
+    if (queued < count) {
+        writeDone(count - queued, I2C_ERROR_INVALID);
+    }
+}
+
+void MacroEngine::writeDone(uint8_t count, uint8_t error) {
+    portENTER_CRITICAL(&lock);
+    if (error && !stepError) stepError = error;
+    pendingWrites -= count;
+    bool last = pendingWrites == 0;
+    portEXIT_CRITICAL(&lock);
+    
+    if (!last || !claim(MACRO_WAIT_BUS)) return;
+    if (stepError == I2C_ERROR_STATE) {
+        // 当前模块状态不允许该命令（如 Ready 下的 Stop Input），跳过继续后面的步骤
+        Serial.printf("[MACRO] Step %d skipped (not allowed in current module state)\n", status.steps);
+    } else if (stepError) {
+        Serial.printf("[MACRO] Step %d failed (I2C error %d)\n", status.steps, stepError);
+        finish("I2C write failed");
+        return;
+    }
+    step();
+}
+
+void MacroEngine::startTimer(uint16_t ms, uint8_t waitState) {
+    TickType_t ticks = pdMS_TO_TICKS(ms);
+    portENTER_CRITICAL(&lock);
+    state = waitState;
+    portEXIT_CRITICAL(&lock);
+    
+    if (xTimerChangePeriod(timer, ticks ? ticks : 1, 0) != pdPASS && claim(waitState)) {
+        finish("Timer unavailable");
+    }
+}
+
+void MacroEngine::finish(const char* error) {
+    status.error = error;
+    status.elapsedMs = millis() - startedAt;
+    Serial.printf("[MACRO] Slot %d %s after %d step(s), %lu ms\n", status.slot,
+                  error ? error : "completed", status.steps, (unsigned long)status.elapsedMs);
+    
+    portENTER_CRITICAL(&lock);
+    state = MACRO_IDLE;
+    portEXIT_CRITICAL(&lock);
+}
+
+void MacroEngine::onFrameComplete(const I2CResult& result, void* ctx) {
+    static_cast<MacroEngine*>(ctx)->writeDone(1, result.error);
+}
+
+void MacroEngine::onTimer(TimerHandle_t timer) {
+    MacroEngine* self = static_cast<MacroEngine*>(pvTimerGetTimerID(timer));
+    if (self->claim(MACRO_WAIT_TIMER)) {
+        self->step();
+    } else if (self->claim(MACRO_WAIT_NOTIFY)) {
+        Serial.printf("[MACRO] Timed out waiting for notify 0x%02X\n", self->waitNotifyCmd);
+        self->finish("Notify timeout");
+    }
+}
@@ -0,0 +1,132 @@
+#ifndef MACRO_ENGINE_H
+#define MACRO_ENGINE_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/timers.h>
+#include <freertos/semphr.h>
+#include "config.h"
+#include "command_handler.h"
+#include "projector_registry.h"
+
+// 宏字节码操作码（多字节参数均为高字节在前）
+enum MacroOp : uint8_t {
+    MACRO_OP_CMD    = 0x01,   // 预定义命令：索引(1)
+    MACRO_OP_SEND   = 0x02,   // 原始帧：长度(1)，帧
+    MACRO_OP_WAIT   = 0x03,   // 延时：毫秒(2)
+    MACRO_OP_NOTIFY = 0x04    // 等待 Notify：命令(1)，超时毫秒(2)
+};
+
+// 解释器状态
+enum MacroState : uint8_t {
+    MACRO_IDLE = 0,
+    MACRO_RUNNING,            // 正在执行 step()
+    MACRO_WAIT_BUS,           // 等待本步写入在所有模块完成
+    MACRO_WAIT_TIMER,
+    MACRO_WAIT_NOTIFY
+};
+
+// 运行状态快照
+struct MacroStatus {
+    uint8_t state;            // 见 MacroState
+    int8_t slot;              // 正在/最后运行的宏，-1 = 未运行过
+    uint8_t steps;            // 已开始的步骤数
+    uint32_t elapsedMs;
+    const char* error;        // 最后一次运行的失败原因，成功时为 nullptr
+};
+
+// 宏：把预定义命令、原始帧（绝对值设置）、延时和等待 Notify 串成序列
+// 脚本编译为字节码保存在 SPIFFS；解释器由 I2C 完成回调、定时器和 Notify 推进，
+// 不阻塞 loop() 或网页服务器。每个命令步骤广播到所有模块，全部完成后进入下一步；
+// 模块状态不允许的命令不推迟，以 I2C_ERROR_STATE 立即完成并跳过，其他写入失败结束本次运行
+//
+// 脚本语法（步骤以 ';' 或换行分隔）：
+//   cmd <n>             预定义命令（与 /command?cmd= 相同的索引）
+//   send <hex>          原始帧（连续十六进制，不含空格），用于绝对值设置
+//   wait <ms>           延时
+//   notify <hex> [ms]   等待主模块的指定 Notify（默认超时 MACRO_NOTIFY_TIMEOUT_MS）
+class MacroEngine {
+public:
+    MacroEngine();
+    
+    // 设置依赖模块；槽位先为默认宏，不访问 SPIFFS
+    void begin(CommandHandler* cmdHandler, ProjectorRegistry* projectors);
+    
+    // 从 SPIFFS 载入已保存的宏（第一次调用时挂载文件系统，之后为空操作）
+    // 启动后由 loop 延迟调用一次，/macros 和 save/remove 也会调用；run 不访问 SPIFFS，
+    // 载入之前按键运行编译进固件的默认宏
+    void ensureLoaded();
+    
+    // 编译脚本；失败时 error 为带步骤号的原因
+    static bool compile(const String& script, uint8_t* code, uint16_t& length, String& error);
+    
+    // 字节码还原为脚本（用于显示）
+    static String decompile(const uint8_t* code, uint16_t length);
+    
+    // 编译并保存到槽位；失败时 error 为原因
+    bool save(uint8_t slot, const String& name, const String& script, String& error);
+    
+    // 删除槽位（按键槽位恢复默认宏）
+    bool remove(uint8_t slot);
+    
+    const char* getName(uint8_t slot) const;
+    uint16_t getLength(uint8_t slot) const;
+    String getScript(uint8_t slot) const;
+    
+    // 开始运行；已有宏在运行或槽位为空时返回 false
+    bool run(uint8_t slot);
+    
+    // 停止运行：等待中的宏立即结束，正在总线上的步骤完成后生效（写入不会被推迟，总会完成）
+    void stop();
+    
+    MacroStatus getStatus();
+    static const char* stateName(uint8_t state);
+    
+    // 主模块 Notify 到达时调用（在loop中）
+    void onNotify(uint8_t cmd);
+    
+private:
+    struct Macro {
+        char name[MACRO_NAME_LEN];
+        uint16_t length;
+        uint8_t code[MACRO_MAX_BYTES];
+    };
+    
+    CommandHandler* cmdHandler;
+    ProjectorRegistry* projectors;
+    Macro macros[MACRO_SLOTS];
+    
+    // 运行中的字节码副本（运行期间修改槽位不影响本次运行）
+    uint8_t program[MACRO_MAX_BYTES];
+    uint16_t programLength;
+    uint16_t pc;
+    
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    volatile uint8_t state;
+    volatile bool abortRequested;
+    uint8_t pendingWrites;       // 本步尚未完成的模块数
+    uint8_t stepError;           // 本步第一个失败的 I2C 错误
+    uint8_t waitNotifyCmd;
+    TimerHandle_t timer;
+    MacroStatus status;
+    unsigned long startedAt;
+    
+    volatile bool savedLoaded;
+    SemaphoreHandle_t loadLock;  // 串行化首次载入（网页任务和 loop 的按键可能同时触发）
+    
+    void loadDefault(uint8_t slot, Macro& macro);
+    bool load(uint8_t slot, Macro& macro);
+    
+    // 只有把状态从 expected 切换为 MACRO_RUNNING 的上下文才能推进解释器
+    bool claim(uint8_t expected);
+    void step();
+    void sendFrame(const uint8_t* frame, uint8_t length);
+    void startTimer(uint16_t ms, uint8_t waitState);
+    void writeDone(uint8_t count, uint8_t error);
+    void finish(const char* error);
+    
+    static void onFrameComplete(const I2CResult& result, void* ctx);
+    static void onTimer(TimerHandle_t timer);
+};
+
+#endif // MACRO_ENGINE_H
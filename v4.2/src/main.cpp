@@ -16,19 +16,32 @@
 #include "fan_controller.h"
 #include "device_info.h"
 #include "web_server.h"
+#include "write_coalescer.h"
+#include "module_updater.h"
+#include "calibration_store.h"
+#include "projector_registry.h"
+#include "macro_engine.h"
+#include "event_hub.h"
 
 // Global module instances
 AsyncWebServer server(80);
 EEPROMManager eepromManager;
 WiFiManager wifiManager(server);
 I2CCommunicator i2cComm;
+ProjectorRegistry projectorRegistry;
+MacroEngine macroEngine;
 CommandHandler commandHandler;
 FanController fanController;
 DeviceInfoManager deviceInfoManager;
-WebServer webServer;
+WriteCoalescer writeCoalescer;
+ModuleUpdater moduleUpdater;
+CalibrationStore calibrationStore;
+WebServer webServer(server, eepromManager, commandHandler, i2cComm,
+                    deviceInfoManager, fanController, wifiManager, writeCoalescer,
+                    moduleUpdater, calibrationStore, projectorRegistry, macroEngine);
 
 // Notify callback for I2C
-void notifyCallback(uint8_t cmd, uint8_t size, uint8_t result, const uint8_t* data, uint8_t length);
+void notifyCallback(uint8_t module, uint8_t cmd, uint8_t size, uint8_t result, const uint8_t* data, uint8_t length);
 
 // Button interrupt
 void IRAM_ATTR buttonISR() {
@@ -51,10 +64,27 @@ void setup() {
     fanController.setMode(settings.fanMode);
     Serial.println("[Main] Fan controller initialized");
     
-    // Initialize I2C with notify callback
-    i2cComm.begin(notifyCallback);
+    // Initialize I2C for every configured module; i2cComm is module 0 and gets the notify callback
+    projectorRegistry.begin(i2cComm, notifyCallback);
     Serial.println("[Main] I2C communicator initialized");
     
+    // Pick the fastest bus clock each module handles reliably
+    for (uint8_t id = 0; id < projectorRegistry.count(); id++) {
+        projectorRegistry.get(id)->probeClock();
+    }
+    
+    // Route predefined/custom commands through the I2C worker
+    commandHandler.setI2CCommunicator(&i2cComm);
+    
+    // Slider writes are coalesced in front of the bus and EEPROM
+    writeCoalescer.begin(&i2cComm, &eepromManager, &projectorRegistry);
+    
+    // Module firmware/image updates stream through the I2C worker
+    moduleUpdater.begin(&i2cComm);
+    
+    // Optical axis / bi-phase snapshots
+    calibrationStore.begin(&i2cComm);
+    
     // Initialize Device Info Manager
     deviceInfoManager.setI2CCommunicator(&i2cComm);
     Serial.println("[Main] Device info manager initialized");
@@ -72,16 +102,16 @@ void setup() {
     // Set Tx power
     wifiManager.setTxPower(settings.txPower);
     
-    // Apply geometry settings via I2C
-    i2cComm.sendKeystoneAndFlip(settings.pan, settings.tilt, settings.flip);
-    
-    // Apply picture quality settings
-    i2cComm.sendPictureQuality(settings);
+    // Reconcile geometry/PQ with the module; only out-of-date fields are written
+    deviceInfoManager.reconcileSettings(eepromManager);
     
     // Initialize Web Server
     webServer.begin();
     Serial.println("[Main] Web server initialized");
     
+    // Initialize macros with the compiled defaults; saved ones are loaded later from loop()
+    macroEngine.begin(&commandHandler, &projectorRegistry);
+    
     // Start HTTP server
     server.begin();
     Serial.println("[Main] HTTP server started");
@@ -96,8 +126,9 @@ void setup() {
     deviceInfoManager.requestAll();
     Serial.println("[Main] Device info requested");
     
-    // Auto send Start Input command
-    commandHandler.sendCommandByIndex(0);
+    // Auto send Start Input command to every module
+    const CommandFrame* startInput = commandHandler.getCommand(CMD_START_INPUT - 1);
+    projectorRegistry.broadcast(startInput->bytes, startInput->length);
     Serial.println("[Main] Start Input command sent");
     
     Serial.println("[Main] ===== System initialized successfully =====");
@@ -108,8 +139,23 @@ void loop() {
     static unsigned long lastFanCheck = 0;
     static unsigned long lastWiFiCheck = 0;
     
-    // Process I2C notifications
-    i2cComm.processNotify();
+    // Process I2C notifications from every module
+    projectorRegistry.processNotify();
+    
+    // Flush coalesced geometry/PQ writes and idle EEPROM commits
+    writeCoalescer.process();
+    
+    // Run device info refreshes requested by HTTP handlers
+    deviceInfoManager.process();
+    
+    // Cut staged module update data into 0x9F blocks
+    moduleUpdater.process();
+    
+    // Run calibration reads/writes requested by HTTP handlers
+    calibrationStore.process();
+    
+    // WebSocket heartbeats and client cleanup
+    webServer.loop();
     
     // Process WiFi scan
     wifiManager.processScan();
@@ -117,6 +163,11 @@ void loop() {
     // Check WiFi reconnection and fallback
     wifiManager.checkReconnectFallback();
     
+    // Load saved macros once after boot (no-op afterwards), keeping SPIFFS off the boot path
+    if (millis() > MACRO_LOAD_DELAY_MS) {
+        macroEngine.ensureLoaded();
+    }
+    
     // Update device info every 60 seconds
     if (millis() - lastInfoUpdate > 60000) {
         deviceInfoManager.requestTemperature();
@@ -144,14 +195,24 @@ void loop() {
         lastFanCheck = millis();
     }
     
-    // Handle button press (Stop + Shutdown)
+    // Handle button press (button macro, Stop + Shutdown unless replaced)
     if (digitalRead(BUTTON_PIN) == LOW) {
         delay(50);
         if (digitalRead(BUTTON_PIN) == LOW) {
-            commandHandler.sendCommandByIndex(1); // Stop Input
-            delay(100);
-            commandHandler.sendCommandByIndex(3); // Shutdown
-            Serial.println("[Main] Shutdown command sent via button");
+            // The button always wins: abort any running macro first
+            macroEngine.stop();
+            if (macroEngine.run(MACRO_BUTTON_SLOT)) {
+                Serial.println("[Main] Button macro started");
+            } else {
+                // Previous macro still finishing a bus write: Stop Input + Shutdown directly,
+                // same sequence as the default button macro
+                const CommandFrame* stopInput = commandHandler.getCommand(CMD_STOP_INPUT - 1);
+                const CommandFrame* shutdown = commandHandler.getCommand(CMD_SHUTDOWN - 1);
+                projectorRegistry.broadcast(stopInput->bytes, stopInput->length);
+                delay(100);
+                projectorRegistry.broadcast(shutdown->bytes, shutdown->length);
+                Serial.println("[Main] Button macro busy, Stop Input + Shutdown sent directly");
+            }
             while (digitalRead(BUTTON_PIN) == LOW) { 
                 delay(10); 
             }
@@ -162,7 +223,19 @@ void loop() {
 }
 
 // Notify callback implementation
-void notifyCallback(uint8_t cmd, uint8_t size, uint8_t result, const uint8_t* data, uint8_t length) {
+void notifyCallback(uint8_t module, uint8_t cmd, uint8_t size, uint8_t result, const uint8_t* data, uint8_t length) {
+    // Push to browsers subscribed to /events (every module, tagged with its id)
+    eventHub.notify(module, data, length);
+    
+    // Macros and device info follow the primary module only
+    if (module != 0) {
+        Serial.printf("[Notify] Module %d: CMD 0x%02X, result 0x%02X\n", module, cmd, result);
+        return;
+    }
+    
+    // Resume a macro waiting for this notify
+    macroEngine.onNotify(cmd);
+    
     switch (cmd) {
         case 0x00: // Boot Completed
             Serial.println("[Notify] Boot Completed");
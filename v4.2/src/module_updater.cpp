@@ -0,0 +1,228 @@
+#include "module_updater.h"
+
+static inline void putBigEndian32(uint8_t* out, uint32_t value) {
+    out[0] = (value >> 24) & 0xFF;
+    out[1] = (value >> 16) & 0xFF;
+    out[2] = (value >> 8) & 0xFF;
+    out[3] = value & 0xFF;
+}
+
+ModuleUpdater::ModuleUpdater()
+    : i2cComm(nullptr), current(0), startFrame(), state(UPDATE_IDLE), accepted(false), inputDone(false),
+      status(), startedAt(0), lastReceived(0), flushedAt(0) {
+}
+
+void ModuleUpdater::begin(I2CCommunicator* i2c) {
+    i2cComm = i2c;
+    for (uint8_t i = 0; i < 2; i++) {
+        blocks[i].fill = 0;
+        blocks[i].busy = false;
+        blocks[i].owner = this;
+    }
+}
+
+bool ModuleUpdater::start(UpdateTarget target, uint32_t totalBytes) {
+    // 上一次更新的在途块或暂存数据由 process() 清理完之前不能开始
+    if (!i2cComm || state == UPDATE_RUNNING || !staging.empty() ||
+        blocks[0].busy || blocks[1].busy) {
+        return false;
+    }
+    
+    portENTER_CRITICAL(&lock);
+    memset(&status, 0, sizeof(status));
+    status.target = target;
+    status.totalBytes = totalBytes;
+    status.state = UPDATE_RUNNING;
+    portEXIT_CRITICAL(&lock);
+    current = 0;
+    blocks[0].fill = 0;
+    blocks[1].fill = 0;
+    accepted = false;
+    inputDone = false;
+    startedAt = lastReceived = flushedAt = millis();
+    state = UPDATE_RUNNING;
+    
+    // 0x92/0x94 无 OP；数据可以先进入暂存环，模块应答后 process() 才开始发送数据块
+    startFrame[0] = (uint8_t)target;
+    startFrame[1] = 0x00;
+    if (!i2cComm->submitBuffer(startFrame, sizeof(startFrame), 3, COM_REQ_REPLY_TIMEOUT_MS,
+                               onStartComplete, this)) {
+        fail("I2C queue full");
+        return false;
+    }
+    
+    Serial.printf("[UPDATE] Started %s update, %lu bytes\n",
+                  target == UPDATE_FIRMWARE ? "firmware" : "image", (unsigned long)totalBytes);
+    return true;
+}
+
+bool ModuleUpdater::write(const uint8_t* data, size_t length) {
+    if (state != UPDATE_RUNNING || inputDone || length > space()) return false;
+    
+    uint32_t sum = 0;
+    for (size_t i = 0; i < length; i++) {
+        staging.push(data[i]);
+        sum += data[i];
+    }
+    
+    portENTER_CRITICAL(&lock);
+    status.receivedBytes += length;
+    status.checksum += sum;
+    portEXIT_CRITICAL(&lock);
+    lastReceived = millis();
+    return true;
+}
+
+bool ModuleUpdater::finish() {
+    if (state != UPDATE_RUNNING) return false;
+    if (status.receivedBytes != status.totalBytes) {
+        fail("Incomplete body");
+        return false;
+    }
+    inputDone = true;
+    return true;
+}
+
+void ModuleUpdater::abort(const char* reason) {
+    fail(reason);
+}
+
+void ModuleUpdater::process() {
+    if (state != UPDATE_RUNNING) {
+        // 失败或中止后丢弃尚未下发的数据
+        uint8_t byte;
+        while (staging.pop(byte)) {}
+        return;
+    }
+    if (!accepted) return;   // 等待 0x92/0x94 的应答
+    
+    if (!inputDone && millis() - lastReceived > UPDATE_IDLE_TIMEOUT_MS) {
+        fail("Upload stalled");
+        return;
+    }
+    
+    while (state == UPDATE_RUNNING) {
+        Block& block = blocks[current];
+        if (block.busy) {
+            // 两块都在总线上，下次 loop 再填充
+            if (millis() - flushedAt > UPDATE_BUFFER_WAIT_MS) fail("Module not responding");
+            return;
+        }
+        
+        uint8_t byte;
+        while (block.fill < UPDATE_BLOCK_SIZE && staging.pop(byte)) {
+            block.frame[10 + block.fill++] = byte;
+        }
+        
+        // 先读 inputDone：为 true 时所有数据都已在暂存环中
+        bool last = inputDone && staging.empty();
+        if (block.fill == UPDATE_BLOCK_SIZE || (last && block.fill)) {
+            if (!flushBlock()) return;
+            continue;
+        }
+        if (last && !blocks[current ^ 1].busy) complete();
+        return;
+    }
+}
+
+UpdateStatus ModuleUpdater::getStatus() {
+    portENTER_CRITICAL(&lock);
+    UpdateStatus s = status;
+    portEXIT_CRITICAL(&lock);
+    
+    if (s.state == UPDATE_RUNNING) {
+        s.elapsedMs = millis() - startedAt;
+    }
+    s.bytesPerSec = s.elapsedMs ? (uint32_t)((uint64_t)s.sentBytes * 1000 / s.elapsedMs) : 0;
+    return s;
+}
+
+bool ModuleUpdater::flushBlock() {
+    Block& block = blocks[current];
+    uint32_t sum = 0;
+    for (uint16_t i = 0; i < block.fill; i++) sum += block.frame[10 + i];
+    
+    // 0x9F: OP0=0x04, OP1~OP4 块长度, OP5~OP8 块校验和, 之后为数据（均为高字节在前）
+    block.frame[0] = 0x9F;
+    block.frame[1] = 0x04;
+    putBigEndian32(block.frame + 2, block.fill);
+    putBigEndian32(block.frame + 6, sum);
+    
+    // 交给工作任务后由完成回调清除 busy
+    block.busy = true;
+    if (!i2cComm->submitBuffer(block.frame, 10 + block.fill, 3, UPDATE_BLOCK_TIMEOUT_MS,
+                               onBlockComplete, &block)) {
+        block.busy = false;
+        fail("I2C queue full");
+        return false;
+    }
+    
+    // 切换到另一块缓冲，若其仍在总线上由 process() 稍后再填
+    current ^= 1;
+    flushedAt = millis();
+    return true;
+}
+
+void ModuleUpdater::complete() {
+    portENTER_CRITICAL(&lock);
+    if (state == UPDATE_RUNNING) {
+        state = UPDATE_DONE;
+        status.state = UPDATE_DONE;
+    }
+    status.elapsedMs = millis() - startedAt;
+    portEXIT_CRITICAL(&lock);
+    
+    UpdateStatus s = getStatus();
+    Serial.printf("[UPDATE] %s: %lu/%lu bytes in %lu blocks, checksum 0x%08lX, %lu B/s\n",
+                  s.state == UPDATE_DONE ? "Completed" : "Failed",
+                  (unsigned long)s.sentBytes, (unsigned long)s.totalBytes,
+                  (unsigned long)s.blocks, (unsigned long)s.checksum,
+                  (unsigned long)s.bytesPerSec);
+}
+
+void ModuleUpdater::fail(const char* reason) {
+    bool changed = false;
+    portENTER_CRITICAL(&lock);
+    if (state == UPDATE_RUNNING) {
+        state = UPDATE_FAILED;
+        status.state = UPDATE_FAILED;
+        status.error = reason;
+        status.elapsedMs = millis() - startedAt;
+        changed = true;
+    }
+    portEXIT_CRITICAL(&lock);
+    
+    if (changed) {
+        Serial.printf("[UPDATE] Aborted: %s\n", reason);
+    }
+}
+
+void ModuleUpdater::onStartComplete(const I2CResult& result, void* ctx) {
+    ModuleUpdater* self = static_cast<ModuleUpdater*>(ctx);
+    if (result.error != 0 || (result.rxLength >= 1 && result.rx[0] == 0x12)) {
+        Serial.printf("[UPDATE] Module rejected 0x%02X (error=%d)\n", self->startFrame[0], result.error);
+        self->fail("Module rejected update");
+    } else {
+        self->accepted = true;
+    }
+}
+
+void ModuleUpdater::onBlockComplete(const I2CResult& result, void* ctx) {
+    Block* block = static_cast<Block*>(ctx);
+    ModuleUpdater* self = block->owner;
+    
+    if (result.error != 0) {
+        self->fail("I2C write failed");
+    } else if (result.rxLength >= 3 && (result.rx[0] == 0x12 ||
+               (result.rx[0] == 0x9F && result.rx[2] != 0x00))) {
+        // Command Error 或块应答结果非 0（校验和错误等）
+        self->fail("Module rejected block");
+    } else {
+        portENTER_CRITICAL(&self->lock);
+        self->status.sentBytes += block->fill;
+        self->status.blocks++;
+        portEXIT_CRITICAL(&self->lock);
+    }
+    block->fill = 0;
+    block->busy = false;
+}
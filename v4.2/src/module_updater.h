@@ -0,0 +1,104 @@
+#ifndef MODULE_UPDATER_H
+#define MODULE_UPDATER_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include "config.h"
+#include "i2c_communicator.h"
+#include "spsc_ring.h"
+
+static_assert(10 + UPDATE_BLOCK_SIZE <= I2C_WIRE_BUFFER, "0x9F block exceeds Wire buffer");
+static_assert(UPDATE_SLICE_BYTES <= UPDATE_STAGING_BYTES, "Upload slice must fit the staging ring");
+
+// 更新目标（即开始分块更新序列的命令字节）
+enum UpdateTarget : uint8_t {
+    UPDATE_FIRMWARE = 0x92,   // 分块固件更新
+    UPDATE_IMAGE    = 0x94    // 分块图片更新（只替换图像资源）
+};
+
+// 更新状态
+enum UpdateState : uint8_t {
+    UPDATE_IDLE = 0,
+    UPDATE_RUNNING,
+    UPDATE_DONE,
+    UPDATE_FAILED
+};
+
+// 更新进度
+struct UpdateStatus {
+    uint8_t state;           // 见 UpdateState
+    uint8_t target;          // 见 UpdateTarget
+    uint32_t totalBytes;     // 镜像总字节数（HTTP Content-Length）
+    uint32_t receivedBytes;  // 已从网络收到的字节数
+    uint32_t sentBytes;      // 已被模块接受的字节数
+    uint32_t blocks;         // 已发送的 0x9F 块数
+    uint32_t checksum;       // 已接收数据的累计校验和（逐字节求和）
+    uint32_t elapsedMs;
+    uint32_t bytesPerSec;
+    const char* error;       // 失败原因，未失败时为 nullptr
+};
+
+// 流式模块更新：0x92/0x94 开始序列，HTTP 数据先进入暂存环，由 loop() 切成 0x9F 块发送
+// 两个块缓冲交替使用，总线写入当前块时填充下一块；网络任务和 loop 都不等待总线，整个镜像不驻留 RAM
+class ModuleUpdater {
+public:
+    ModuleUpdater();
+    
+    // 设置依赖模块
+    void begin(I2CCommunicator* i2c);
+    
+    // 异步发送 0x92/0x94 开始更新；已有更新进行中或上次的数据尚未清理完时返回 false
+    // 模块拒绝时由完成回调标记失败
+    bool start(UpdateTarget target, uint32_t totalBytes);
+    
+    // 暂存环的剩余空间（字节），网络侧据此决定接收本片还是让客户端稍后重试
+    uint16_t space() const { return UPDATE_STAGING_BYTES - staging.size(); }
+    
+    // 追加镜像数据到暂存环，不阻塞；空间不足时不写入并返回 false（仅网络任务调用）
+    bool write(const uint8_t* data, size_t length);
+    
+    // 数据已全部收到；剩余数据和最后一块由 process() 下发，全部块完成后状态变为 UPDATE_DONE
+    bool finish();
+    
+    // 中止更新（例如客户端断开）；在途块由完成回调归还
+    void abort(const char* reason);
+    
+    // 把暂存数据切成块下发，检查超时，全部完成后结束更新（在loop中调用，不阻塞）
+    void process();
+    
+    bool isActive() const { return state == UPDATE_RUNNING; }
+    
+    // 获取进度快照
+    UpdateStatus getStatus();
+    
+private:
+    struct Block {
+        uint8_t frame[10 + UPDATE_BLOCK_SIZE];   // 0x9F, OP0, 长度(4), 校验和(4), 数据
+        uint16_t fill;                           // 已填充的数据字节数
+        volatile bool busy;                      // 已交给工作任务，完成回调清除
+        ModuleUpdater* owner;
+    };
+    
+    I2CCommunicator* i2cComm;
+    Block blocks[2];
+    uint8_t current;             // 正在填充的块（仅 loop 访问）
+    uint8_t startFrame[2];       // 0x92/0x94，在途期间必须保持有效
+    SpscRing<uint8_t, UPDATE_STAGING_BYTES> staging;   // 网络任务写入，loop 读出
+    
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    volatile uint8_t state;
+    volatile bool accepted;      // 模块已应答开始命令
+    volatile bool inputDone;     // 镜像数据已全部进入暂存环
+    UpdateStatus status;
+    unsigned long startedAt;
+    volatile unsigned long lastReceived;   // 最近一次收到数据的时间
+    unsigned long flushedAt;               // 最近一次交出块的时间
+    
+    bool flushBlock();
+    void complete();
+    void fail(const char* reason);
+    static void onStartComplete(const I2CResult& result, void* ctx);
+    static void onBlockComplete(const I2CResult& result, void* ctx);
+};
+
+#endif // MODULE_UPDATER_H
@@ -0,0 +1,103 @@
+#include "projector_registry.h"
+
+static const uint8_t PROJECTOR_ADDRESS_TABLE[] = PROJECTOR_ADDRESSES;
+static const int8_t PROJECTOR_CHANNEL_TABLE[] = PROJECTOR_MUX_CHANNELS;
+static const uint8_t PROJECTOR_COM_REQ_TABLE[] = PROJECTOR_COM_REQ_PINS;
+
+static_assert(sizeof(PROJECTOR_ADDRESS_TABLE) == PROJECTOR_COUNT &&
+              sizeof(PROJECTOR_CHANNEL_TABLE) == PROJECTOR_COUNT &&
+              sizeof(PROJECTOR_COM_REQ_TABLE) == PROJECTOR_COUNT,
+              "PROJECTOR_* tables must have PROJECTOR_COUNT entries");
+
+ProjectorRegistry::ProjectorRegistry() : projectors(), projectorCount(0), batchOwner(nullptr) {
+}
+
+void ProjectorRegistry::begin(I2CCommunicator& primary, NotifyCallback callback) {
+    for (uint8_t id = 0; id < PROJECTOR_COUNT; id++) {
+        I2CCommunicator* projector = id == 0 ? &primary : new I2CCommunicator();
+        projector->attach(&sharedI2CBus, id, PROJECTOR_ADDRESS_TABLE[id],
+                          PROJECTOR_CHANNEL_TABLE[id], PROJECTOR_COM_REQ_TABLE[id]);
+        projector->begin(callback);
+        projectors[id] = projector;
+    }
+    projectorCount = PROJECTOR_COUNT;
+    Serial.printf("[PROJ] %d projector module(s) registered\n", projectorCount);
+}
+
+I2CCommunicator* ProjectorRegistry::get(uint8_t id) const {
+    return id < projectorCount ? projectors[id] : nullptr;
+}
+
+void ProjectorRegistry::holdBuses() {
+    // 批量提交中已由本任务占住
+    if (batchOwner == xTaskGetCurrentTaskHandle()) return;
+    for (uint8_t i = 0; i < projectorCount; i++) {
+        I2CBus* bus = projectors[i]->getBus();
+        bool seen = false;
+        for (uint8_t j = 0; j < i && !seen; j++) {
+            seen = projectors[j]->getBus() == bus;
+        }
+        if (!seen) bus->lock();
+    }
+}
+
+void ProjectorRegistry::releaseBuses() {
+    if (batchOwner == xTaskGetCurrentTaskHandle()) return;
+    for (uint8_t i = 0; i < projectorCount; i++) {
+        I2CBus* bus = projectors[i]->getBus();
+        bool seen = false;
+        for (uint8_t j = 0; j < i && !seen; j++) {
+            seen = projectors[j]->getBus() == bus;
+        }
+        if (!seen) bus->unlock();
+    }
+}
+
+void ProjectorRegistry::beginBatch() {
+    holdBuses();
+    batchOwner = xTaskGetCurrentTaskHandle();
+}
+
+void ProjectorRegistry::endBatch() {
+    batchOwner = nullptr;
+    releaseBuses();
+}
+
+uint8_t ProjectorRegistry::broadcast(const uint8_t* frame, uint8_t length,
+                                     I2CCompletion onComplete, void* ctx, bool deferrable) {
+    // 只能异步提交：持有总线期间等待同步结果会与工作任务互相等待
+    uint8_t queued = 0;
+    holdBuses();
+    for (uint8_t i = 0; i < projectorCount; i++) {
+        if (projectors[i]->submit(frame, length, onComplete, ctx, deferrable)) queued++;
+    }
+    releaseBuses();
+    
+    Serial.printf("[PROJ] Broadcast 0x%02X queued on %d/%d module(s)\n",
+                  length ? frame[0] : 0, queued, projectorCount);
+    return queued;
+}
+
+uint8_t ProjectorRegistry::sendPictureQuality(const SystemSettings& settings) {
+    uint8_t queued = 0;
+    holdBuses();
+    for (uint8_t i = 0; i < projectorCount; i++) {
+        if (projectors[i]->sendPictureQuality(settings)) queued++;
+    }
+    releaseBuses();
+    return queued;
+}
+
+void ProjectorRegistry::sendTestPattern(uint8_t pattern) {
+    holdBuses();
+    for (uint8_t i = 0; i < projectorCount; i++) {
+        projectors[i]->sendTestPattern(pattern);
+    }
+    releaseBuses();
+}
+
+void ProjectorRegistry::processNotify() {
+    for (uint8_t i = 0; i < projectorCount; i++) {
+        projectors[i]->processNotify();
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef PROJECTOR_REGISTRY_H
+#define PROJECTOR_REGISTRY_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "i2c_bus.h"
+#include "i2c_communicator.h"
+#include "eeprom_manager.h"
+
+// 模块注册表：按 config.h 中的 PROJECTOR_* 配置为每个模块建立独立的 I2CCommunicator
+// ID 即配置表下标，ID 0 为主模块（设备信息、更新、校准快照等仍只针对主模块）
+class ProjectorRegistry {
+public:
+    ProjectorRegistry();
+    
+    // 绑定并启动所有模块；primary 作为 ID 0，所有模块的 Notify 都带模块 ID 交给 callback
+    void begin(I2CCommunicator& primary, NotifyCallback callback);
+    
+    uint8_t count() const { return projectorCount; }
+    
+    // 按 ID 获取模块，超出范围返回 nullptr
+    I2CCommunicator* get(uint8_t id) const;
+    
+    // 向所有模块异步提交同一帧；返回成功入队的模块数
+    // 入队期间占住总线，释放后各模块的写入依次紧接执行，减少模块之间的时间差
+    // onComplete 对每个入队的模块各调用一次（在该模块的工作任务中）；deferrable 见 I2CCommunicator::submit
+    uint8_t broadcast(const uint8_t* frame, uint8_t length,
+                      I2CCompletion onComplete = nullptr, void* ctx = nullptr, bool deferrable = true);
+    
+    // 向所有模块发送画质设置（各模块独立做影子比较）；返回成功入队（或无需写入）的模块数
+    uint8_t sendPictureQuality(const SystemSettings& settings);
+    
+    // 向所有模块发送测试图案
+    void sendTestPattern(uint8_t pattern);
+    
+    // 处理所有模块的 Notify（在loop中调用）
+    void processNotify();
+    
+    // 批量提交：beginBatch 占住所有模块的总线直到 endBatch，期间各模块排队的写入都不会开始，
+    // 释放后依次紧接执行。期间本任务调用上面的方法不再重复占用总线
+    // 只能异步入队：持有总线时等待同步结果（transact 等）会与工作任务互相等待
+    void beginBatch();
+    void endBatch();
+    
+private:
+    I2CCommunicator* projectors[PROJECTOR_COUNT];
+    uint8_t projectorCount;
+    TaskHandle_t batchOwner;      // 正在批量提交的任务，没有时为 nullptr
+    
+    // 占住/释放所有模块用到的总线
+    void holdBuses();
+    void releaseBuses();
+};
+
+#endif // PROJECTOR_REGISTRY_H
@@ -0,0 +1,59 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdint.h>
+#include <atomic>
+
+// 单生产者/单消费者无锁环形缓冲区
+// 生产者可以是中断（ISR），消费者为普通任务；N 必须为 2 的幂
+template <typename T, uint16_t N>
+class SpscRing {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing size must be a power of two");
+    
+public:
+    SpscRing() : head(0), tail(0), overflows(0) {}
+    
+    // 生产者调用；满时丢弃并计数
+    bool push(const T& item) {
+        uint16_t h = head.load(std::memory_order_relaxed);
+        if ((uint16_t)(h - tail.load(std::memory_order_acquire)) >= N) {
+            // 只有生产者写该计数，无需原子读改写（C3 无 A 扩展）
+            overflows.store(overflows.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+        slots[h & (N - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+    
+    // 消费者调用；为空时返回 false
+    bool pop(T& item) {
+        uint16_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = slots[t & (N - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+    
+    bool empty() const {
+        return tail.load(std::memory_order_acquire) == head.load(std::memory_order_acquire);
+    }
+    
+    uint16_t size() const {
+        return (uint16_t)(head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire));
+    }
+    
+    uint32_t overflowCount() const {
+        return overflows.load(std::memory_order_relaxed);
+    }
+    
+private:
+    T slots[N];
+    std::atomic<uint16_t> head;     // 仅生产者写
+    std::atomic<uint16_t> tail;     // 仅消费者写
+    std::atomic<uint32_t> overflows;
+};
+
+#endif // SPSC_RING_H
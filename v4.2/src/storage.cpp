@@ -0,0 +1,27 @@
+#include "storage.h"
+#include <SPIFFS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+// 网页服务器任务和 loop 可能同时首次访问，挂载过程由互斥量串行化
+static SemaphoreHandle_t mountLock = xSemaphoreCreateMutex();
+static volatile bool mounted = false;
+static bool failed = false;
+
+bool mountStorage() {
+    if (mounted) return true;
+    
+    xSemaphoreTake(mountLock, portMAX_DELAY);
+    if (!mounted && !failed) {
+        unsigned long start = millis();
+        if (SPIFFS.begin(true)) {
+            mounted = true;
+            Serial.printf("[Storage] SPIFFS mounted in %lu ms\n", millis() - start);
+        } else {
+            failed = true;
+            Serial.println("[Storage] SPIFFS Mount Failed");
+        }
+    }
+    xSemaphoreGive(mountLock);
+    return mounted;
+}
@@ -0,0 +1,10 @@
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include <Arduino.h>
+
+// SPIFFS 按需挂载：启动时不挂载，第一个需要文件系统的功能（校准快照、宏、未压缩网页）调用时挂载
+// 可在任意任务中调用；挂载失败（格式化也失败）后不再重试，返回 false
+bool mountStorage();
+
+#endif // STORAGE_H
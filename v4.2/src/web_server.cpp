@@ -1,6 +1,8 @@
 #include "web_server.h"
 #include <SPIFFS.h>
 #include <string.h>
+#include "storage.h"
+#include "web_ui_gz.h"
 
 WebServer::WebServer(AsyncWebServer& server,
                      EEPROMManager& eepromMgr,
@@ -8,7 +10,12 @@ WebServer::WebServer(AsyncWebServer& server,
                      I2CCommunicator& i2cComm,
                      DeviceInfoManager& devInfoMgr,
                      FanController& fanCtrl,
-                     WiFiManager& wifiMgr)
+                     WiFiManager& wifiMgr,
+                     WriteCoalescer& coalescer,
+                     ModuleUpdater& updater,
+                     CalibrationStore& calibration,
+                     ProjectorRegistry& projectors,
+                     MacroEngine& macros)
     : server(server)
     , eepromMgr(eepromMgr)
     , cmdHandler(cmdHandler)
@@ -16,96 +23,290 @@ WebServer::WebServer(AsyncWebServer& server,
     , devInfoMgr(devInfoMgr)
     , fanCtrl(fanCtrl)
     , wifiMgr(wifiMgr)
+    , coalescer(coalescer)
+    , updater(updater)
+    , calibration(calibration)
+    , projectors(projectors)
+    , macros(macros)
+    , updateRequest(nullptr)
+    , ws(WS_PATH)
+    , lastHeartbeat(0)
+    , events(SSE_PATH)
+    , eventClients()
+    , eventLock(nullptr)
 {
 }
 
-void WebServer::begin() {
-    // Initialize SPIFFS
-    if(!SPIFFS.begin(true)) {
-        Serial.println("[WebServer] SPIFFS Mount Failed");
-        return;
+const WebServer::ControlRoute WebServer::CONTROL_ROUTES[] = {
+    {"command", &WebServer::handleCommand},
+    {"keystone", &WebServer::handleKeystone},
+    {"custom_command", &WebServer::handleCustomCommand},
+    {"command_status", &WebServer::handleCommandStatus},
+    {"test_pattern", &WebServer::handleTestPattern},
+    {"set_tx_power", &WebServer::handleSetTxPower},
+    {"ping", &WebServer::handlePing},
+    {"get_settings", &WebServer::handleGetSettings},
+    {"set_settings", &WebServer::handleSetSettings},
+    {"set_lang", &WebServer::handleSetLang},
+    {"set_pq", &WebServer::handleSetPQ},
+    {"factory_reset", &WebServer::handleFactoryReset},
+    {"save_all", &WebServer::handleSaveAll},
+    {"get_device_info", &WebServer::handleGetDeviceInfo},
+    {"get_temperature", &WebServer::handleGetTemperature},
+    {"wifi_status", &WebServer::handleWiFiStatus},
+    {"set_fan", &WebServer::handleSetFan},
+    {nullptr, nullptr}
+};
+
+ControlParams::ControlParams(AsyncWebServerRequest* request) : request(request), count(0) {
+}
+
+ControlParams::ControlParams(const char* query) : request(nullptr), count(0) {
+    while (*query && count < MAX_PARAMS) {
+        const char* end = strchr(query, '&');
+        if (!end) end = query + strlen(query);
+        const char* eq = (const char*)memchr(query, '=', end - query);
+        const char* nameEnd = eq ? eq : end;
+        for (const char* c = query; c < nameEnd; c++) names[count] += *c;
+        if (eq) {
+            for (const char* c = eq + 1; c < end; c++) values[count] += *c;
+        }
+        count++;
+        query = *end ? end + 1 : end;
     }
-    
+}
+
+bool ControlParams::has(const char* name) const {
+    if (request) return request->hasParam(name);
+    for (uint8_t i = 0; i < count; i++) {
+        if (names[i] == name) return true;
+    }
+    return false;
+}
+
+String ControlParams::get(const char* name) const {
+    if (request) return request->hasParam(name) ? request->getParam(name)->value() : String();
+    for (uint8_t i = 0; i < count; i++) {
+        if (names[i] == name) return values[i];
+    }
+    return String();
+}
+
+void WebServer::begin() {
+    // 网页在固件中（web_ui_gz.h），SPIFFS 由需要它的功能按需挂载
+    eventLock = xSemaphoreCreateMutex();
     setupRoutes();
     server.begin();
     Serial.println("[WebServer] HTTP Server started");
 }
 
-void WebServer::setupRoutes() {
-    // Serve web interface
-    server.on("/", HTTP_GET, [this](AsyncWebServerRequest* request) {
-        this->handleRoot(request);
-    });
+void WebServer::loop() {
+    pushEvents();
     
-    // Commands by index
-    server.on("/command", HTTP_GET, [this](AsyncWebServerRequest* request) {
-        this->handleCommand(request);
-    });
-    
-    // Keystone
-    server.on("/keystone", HTTP_GET, [this](AsyncWebServerRequest* request) {
-        this->handleKeystone(request);
-    });
+    if (millis() - lastHeartbeat < WS_HEARTBEAT_MS) return;
+    lastHeartbeat = millis();
     
-    // Custom command
-    server.on("/custom_command", HTTP_GET, [this](AsyncWebServerRequest* request) {
-        this->handleCustomCommand(request);
-    });
-    
-    // Test pattern
-    server.on("/test_pattern", HTTP_GET, [this](AsyncWebServerRequest* request) {
-        this->handleTestPattern(request);
-    });
-    
-    // Set Tx Power
-    server.on("/set_tx_power", HTTP_GET, [this](AsyncWebServerRequest* request) {
-        this->handleSetTxPower(request);
-    });
-    
-    // Ping
-    server.on("/ping", HTTP_GET, [this](AsyncWebServerRequest* request) {
-        this->handlePing(request);
-    });
+    ws.cleanupClients(WS_MAX_CLIENTS);
+    if (ws.count() > 0) {
+        ws.textAll("hb " + String(millis() / 1000));
+    }
+}
+
+// SSE 事件名，顺序与 StateEvent 相同
+static const char* const STATE_EVENT_NAMES[STATE_EVENT_COUNT] = {"temperature", "fan", "wifi", "command"};
+
+void WebServer::handleEventConnect(AsyncEventSourceClient* client) {
+    xSemaphoreTake(eventLock, portMAX_DELAY);
+    EventClient* slot = nullptr;
+    for (uint8_t i = 0; i < SSE_MAX_CLIENTS && !slot; i++) {
+        if (!eventClients[i].client) slot = &eventClients[i];
+    }
+    if (slot) {
+        // 已发送版本记为当前版本减 1：第一次推送发送全部状态的当前值；之前的 Notify 不补发
+        slot->client = client;
+        for (uint8_t type = 0; type < STATE_EVENT_COUNT; type++) {
+            slot->sentVersion[type] = eventHub.getVersion(type) - 1;
+        }
+        // 命令结果只推送连接之后完成的
+        slot->sentVersion[STATE_COMMAND]++;
+        slot->sentNotify = eventHub.getNotifySeq();
+    }
+    xSemaphoreGive(eventLock);
     
-    // Get all settings
-    server.on("/get_settings", HTTP_GET, [this](AsyncWebServerRequest* request) {
-        this->handleGetSettings(request);
-    });
+    if (!slot) {
+        Serial.println("[WebServer] Too many event clients, closing");
+        client->close();
+        return;
+    }
+    client->send("connected", "hello", 0, SSE_RETRY_MS);
+}
+
+void WebServer::handleEventDisconnect(AsyncEventSourceClient* client) {
+    xSemaphoreTake(eventLock, portMAX_DELAY);
+    for (uint8_t i = 0; i < SSE_MAX_CLIENTS; i++) {
+        if (eventClients[i].client == client) eventClients[i].client = nullptr;
+    }
+    xSemaphoreGive(eventLock);
+}
+
+void WebServer::pushEvents() {
+    if (!eventLock || events.count() == 0) return;
     
-    // Set settings
-    server.on("/set_settings", HTTP_GET, [this](AsyncWebServerRequest* request) {
-        this->handleSetSettings(request);
-    });
+    uint32_t versions[STATE_EVENT_COUNT];
+    for (uint8_t type = 0; type < STATE_EVENT_COUNT; type++) {
+        versions[type] = eventHub.getVersion(type);
+    }
+    uint32_t notifySeq = eventHub.getNotifySeq();
+    
+    // 同一次推送中各客户端共用格式化结果
+    String states[STATE_EVENT_COUNT];
+    
+    xSemaphoreTake(eventLock, portMAX_DELAY);
+    for (uint8_t i = 0; i < SSE_MAX_CLIENTS; i++) {
+        EventClient& slot = eventClients[i];
+        if (!slot.client || slot.client->packetsWaiting() >= SSE_CLIENT_BACKLOG) continue;
+        
+        // 落后超过 EVENT_NOTIFY_QUEUE 个时，最旧的已被覆盖，从仍保留的开始
+        if (notifySeq - slot.sentNotify > EVENT_NOTIFY_QUEUE) {
+            slot.sentNotify = notifySeq - EVENT_NOTIFY_QUEUE;
+        }
+        NotifyRecord notify;
+        while (slot.sentNotify != notifySeq) {
+            slot.sentNotify++;
+            if (eventHub.getNotify(slot.sentNotify, notify)) {
+                slot.client->send(notifyEventJson(notify).c_str(), "notify", notify.seq);
+            }
+        }
+        
+        for (uint8_t type = 0; type < STATE_EVENT_COUNT; type++) {
+            if (slot.sentVersion[type] == versions[type]) continue;
+            if (!states[type].length()) states[type] = stateEventJson(type);
+            slot.client->send(states[type].c_str(), STATE_EVENT_NAMES[type]);
+            slot.sentVersion[type] = versions[type];
+        }
+    }
+    xSemaphoreGive(eventLock);
+}
+
+String WebServer::stateEventJson(uint8_t type) {
+    switch (type) {
+        case STATE_TEMPERATURE:
+            return "{\"current\":" + String(devInfoMgr.getTemperature()) +
+                   ",\"lower\":" + String(devInfoMgr.getMuteThreshold()) +
+                   ",\"upper\":" + String(devInfoMgr.getStopThreshold()) + "}";
+        case STATE_FAN:
+            return "{\"mode\":" + String(fanCtrl.getMode()) + ",\"pwm\":" + String(fanCtrl.getPWM()) + "}";
+        case STATE_WIFI:
+            return wifiMgr.getStatusJSON(eepromMgr.getSettings().lang);
+        case STATE_COMMAND: {
+            CommandStatus status;
+            return cmdHandler.getLastCompleted(status) ? commandStatusJson(status) : String("{}");
+        }
+        default:
+            return "{}";
+    }
+}
+
+String WebServer::notifyEventJson(const NotifyRecord& event) {
+    char hex[I2C_MAX_FRAME * 2 + 1];
+    for (uint8_t i = 0; i < event.length; i++) {
+        snprintf(hex + i * 2, 3, "%02X", event.frame[i]);
+    }
+    hex[event.length * 2] = '\0';
     
-    // Set language
-    server.on("/set_lang", HTTP_GET, [this](AsyncWebServerRequest* request) {
-        this->handleSetLang(request);
-    });
+    String json = "{\"module\":" + String(event.module) +
+                  ",\"cmd\":" + String(event.length > 0 ? event.frame[0] : 0) +
+                  ",\"result\":" + String(event.length > 2 ? event.frame[2] : 0) +
+                  ",\"frame\":\"" + String(hex) + "\"}";
+    return json;
+}
+
+String WebServer::commandStatusJson(const CommandStatus& status) {
+    return "{\"seq\":" + String(status.seq) + ",\"cmd\":" + String(status.cmd) +
+           ",\"module\":" + String(status.module) + ",\"done\":" + String(status.done ? "true" : "false") +
+           ",\"error\":" + String(status.error) + ",\"attempts\":" + String(status.attempts) + "}";
+}
+
+void WebServer::handleWsEvent(AsyncWebSocketClient* client, AwsEventType type, void* arg,
+                              uint8_t* data, size_t len) {
+    if (type == WS_EVT_CONNECT) {
+        // 连接数已满：关闭新连接，网页继续使用 HTTP
+        if (ws.count() > WS_MAX_CLIENTS) {
+            client->close();
+            return;
+        }
+        Serial.printf("[WebServer] WebSocket client #%u connected (%u total)\n",
+                      (unsigned)client->id(), (unsigned)ws.count());
+        return;
+    }
+    if (type == WS_EVT_DISCONNECT) {
+        Serial.printf("[WebServer] WebSocket client #%u disconnected\n", (unsigned)client->id());
+        return;
+    }
+    if (type != WS_EVT_DATA) return;
     
-    // Set picture quality
-    server.on("/set_pq", HTTP_GET, [this](AsyncWebServerRequest* request) {
-        this->handleSetPQ(request);
+    // 只接受单帧的完整文本消息（控制消息都很短）
+    AwsFrameInfo* info = (AwsFrameInfo*)arg;
+    if (!info->final || info->index != 0 || info->len != len || info->opcode != WS_TEXT) return;
+    if (len > WS_MAX_MESSAGE) {
+        client->text("0 413 Message too long");
+        return;
+    }
+    char message[WS_MAX_MESSAGE + 1];
+    memcpy(message, data, len);
+    message[len] = '\0';
+    handleWsMessage(client, message);
+}
+
+void WebServer::handleWsMessage(AsyncWebSocketClient* client, char* message) {
+    char* name = message;
+    uint32_t seq = strtoul(message, &name, 10);
+    while (*name == ' ') name++;
+    char* query = strchr(name, '?');
+    if (query) *query++ = '\0';
+    
+    ControlReply reply = {404, "text/plain", "Unknown operation"};
+    for (const ControlRoute* route = CONTROL_ROUTES; route->name; route++) {
+        if (strcmp(route->name, name) == 0) {
+            reply = (this->*route->handler)(ControlParams(query ? query : ""));
+            break;
+        }
+    }
+    if (seq != 0) {
+        client->text(String(seq) + " " + String(reply.code) + " " + reply.body);
+    }
+}
+
+void WebServer::setupRoutes() {
+    // Serve web interface
+    server.on("/", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        this->handleRoot(request);
     });
     
-    // Factory reset
-    server.on("/factory_reset", HTTP_GET, [this](AsyncWebServerRequest* request) {
-        this->handleFactoryReset(request);
-    });
+    // Control operations, also reachable over the WebSocket channel
+    for (const ControlRoute* route = CONTROL_ROUTES; route->name; route++) {
+        ControlHandler handler = route->handler;
+        server.on((String("/") + route->name).c_str(), HTTP_GET, [this, handler](AsyncWebServerRequest* request) {
+            ControlReply reply = (this->*handler)(ControlParams(request));
+            request->send(reply.code, reply.type, reply.body);
+        });
+    }
     
-    // Save all parameters
-    server.on("/save_all", HTTP_GET, [this](AsyncWebServerRequest* request) {
-        this->handleSaveAll(request);
+    // WebSocket control channel
+    ws.onEvent([this](AsyncWebSocket* server, AsyncWebSocketClient* client, AwsEventType type,
+                      void* arg, uint8_t* data, size_t len) {
+        this->handleWsEvent(client, type, arg, data, len);
     });
+    server.addHandler(&ws);
     
-    // Get device info
-    server.on("/get_device_info", HTTP_GET, [this](AsyncWebServerRequest* request) {
-        this->handleGetDeviceInfo(request);
+    // Server-Sent Events: notify frames and state changes
+    events.onConnect([this](AsyncEventSourceClient* client) {
+        this->handleEventConnect(client);
     });
-    
-    // Get temperature
-    server.on("/get_temperature", HTTP_GET, [this](AsyncWebServerRequest* request) {
-        this->handleGetTemperature(request);
+    events.onDisconnect([this](AsyncEventSourceClient* client) {
+        this->handleEventDisconnect(client);
     });
+    server.addHandler(&events);
     
     // Get notifications
     server.on("/get_notifications", HTTP_GET, [this](AsyncWebServerRequest* request) {
@@ -147,81 +348,175 @@ void WebServer::setupRoutes() {
         this->handleWiFiDisconnect(request);
     });
     
-    // WiFi status
-    server.on("/wifi_status", HTTP_GET, [this](AsyncWebServerRequest* request) {
-        this->handleWiFiStatus(request);
+    // Write coalescing statistics
+    server.on("/coalesce_stats", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        this->handleCoalesceStats(request);
+    });
+    
+    // Per-command I2C bus statistics
+    server.on("/i2c_stats", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        this->handleI2CStats(request);
+    });
+    
+    // Set I2C bus clock (Hz)
+    server.on("/set_i2c_clock", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        this->handleSetI2CClock(request);
+    });
+    
+    // Binary dump of the recent I2C transactions (?clear=1 empties the capture)
+    server.on("/i2c_capture", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        this->handleI2CCapture(request);
+    });
+    
+    // Upload a firmware/image file to the module in raw-body slices (?target=&size=&offset=)
+    server.on("/module_update", HTTP_POST,
+        [this](AsyncWebServerRequest* request) {
+            this->handleModuleUpdate(request);
+        },
+        nullptr,
+        [this](AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
+            this->handleModuleUpdateBody(request, data, len, index, total);
+        });
+    
+    // Module update progress
+    server.on("/module_update_status", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        this->handleModuleUpdateStatus(request);
+    });
+    
+    // Batched control operations (one I2C burst, one EEPROM commit)
+    server.on("/batch", HTTP_POST,
+        [this](AsyncWebServerRequest* request) {
+            this->handleBatch(request);
+        },
+        nullptr,
+        [this](AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
+            this->handleBatchBody(request, data, len, index, total);
+        });
+    
+    // Optical axis / bi-phase calibration (absolute values, run from loop())
+    server.on("/calibration", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        this->handleGetCalibration(request);
+    });
+    
+    server.on("/set_calibration", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        this->handleSetCalibration(request);
+    });
+    
+    // Save/restore calibration snapshot on the controller
+    server.on("/calibration_snapshot", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        this->handleCalibrationSnapshot(request);
+    });
+    
+    // Result of the last calibration request (the ones above answer 202 + seq)
+    server.on("/calibration_result", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        this->handleCalibrationResult(request);
+    });
+    
+    // Registered projector modules (other routes take ?id=)
+    server.on("/projectors", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        this->handleProjectors(request);
+    });
+    
+    // Macros: list/status, compile+save, run/stop/delete
+    server.on("/macros", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        this->handleMacros(request);
+    });
+    
+    server.on("/set_macro", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        this->handleSetMacro(request);
     });
     
-    // Set fan mode
-    server.on("/set_fan", HTTP_GET, [this](AsyncWebServerRequest* request) {
-        this->handleSetFan(request);
+    server.on("/macro", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        this->handleMacro(request);
     });
 }
 
 void WebServer::handleRoot(AsyncWebServerRequest* request) {
-    File file = SPIFFS.open("/web_interface.html", "r");
-    if (!file) {
-        request->send(404, "text/plain", "HTML file not found");
+    // 浏览器缓存的版本仍是最新：只回 304
+    if (request->hasHeader("If-None-Match") &&
+        request->getHeader("If-None-Match")->value() == WEB_UI_GZ_ETAG) {
+        AsyncWebServerResponse* response = request->beginResponse(304, "text/html", "");
+        response->addHeader("ETag", WEB_UI_GZ_ETAG);
+        response->addHeader("Cache-Control", "public, max-age=" + String(WEB_UI_MAX_AGE_S));
+        request->send(response);
         return;
     }
     
-    String htmlContent;
-    while(file.available()) {
-        htmlContent += file.readString();
+    // 极少数不接受 gzip 的客户端：文件系统中有未压缩的网页时发送它，否则仍发送压缩版本
+    bool acceptsGzip = request->hasHeader("Accept-Encoding") &&
+                       request->getHeader("Accept-Encoding")->value().indexOf("gzip") >= 0;
+    if (!acceptsGzip && mountStorage() && SPIFFS.exists(WEB_UI_PATH)) {
+        request->send(SPIFFS, WEB_UI_PATH, "text/html");
+        return;
     }
-    file.close();
     
-    request->send(200, "text/html", htmlContent);
+    // 直接从 flash 中的常量数组分块发送，不在堆上复制页面
+    AsyncWebServerResponse* response = request->beginResponse(200, "text/html", WEB_UI_GZ, WEB_UI_GZ_LENGTH);
+    response->addHeader("Content-Encoding", "gzip");
+    response->addHeader("Vary", "Accept-Encoding");
+    response->addHeader("ETag", WEB_UI_GZ_ETAG);
+    response->addHeader("Cache-Control", "public, max-age=" + String(WEB_UI_MAX_AGE_S));
+    request->send(response);
 }
 
-void WebServer::handleCommand(AsyncWebServerRequest* request) {
-    if (!request->hasParam("cmd")) {
-        request->send(400, "text/plain", "Missing cmd parameter");
-        return;
+ControlReply WebServer::handleCommand(const ControlParams& params) {
+    if (!params.has("cmd")) {
+        return {400, "text/plain", "Missing cmd parameter"};
     }
     
-    String cmdStr = request->getParam("cmd")->value();
+    String cmdStr = params.get("cmd");
     int cmdIndex = cmdStr.toInt();
     
-    if (cmdIndex < 1 || cmdIndex > 30) {
-        request->send(400, "text/plain", "Invalid command index");
-        return;
+    if (cmdIndex < 1 || cmdIndex > cmdHandler.getCommandCount()) {
+        return {400, "text/plain", "Invalid command index"};
     }
     
-    cmdHandler.sendCommandByIndex(cmdIndex);
-    request->send(200, "text/plain", "Command executed");
+    if (isBroadcast(params)) {
+        const CommandFrame* frame = cmdHandler.getCommand(cmdIndex - 1);
+        uint8_t queued = projectors.broadcast(frame->bytes, frame->length);
+        return {queued == projectors.count() ? 200 : 502, "text/plain",
+                "Command queued on " + String(queued) + "/" + String(projectors.count()) + " modules"};
+    }
+    I2CCommunicator* target = resolveProjector(params);
+    if (!target) {
+        return {404, "text/plain", "Unknown projector id"};
+    }
+    
+    // 只入队不等待：结果由 /command_status?seq= 查询，并作为 SSE command 事件推送
+    uint32_t seq = cmdHandler.sendCommandByIndex(cmdIndex, target);
+    if (!seq) {
+        return {503, "text/plain", "Command not queued (bus busy)"};
+    }
+    return {202, "text/plain", "Command queued (seq " + String(seq) + ")"};
 }
 
-void WebServer::handleKeystone(AsyncWebServerRequest* request) {
-    if (!request->hasParam("pan") || !request->hasParam("tilt") || !request->hasParam("flip")) {
-        request->send(400, "text/plain", "Missing parameters");
-        return;
+ControlReply WebServer::handleKeystone(const ControlParams& params) {
+    if (!params.has("pan") || !params.has("tilt") || !params.has("flip")) {
+        return {400, "text/plain", "Missing parameters"};
     }
     
     SystemSettings settings = eepromMgr.getSettings();
-    settings.pan = request->getParam("pan")->value().toInt();
+    settings.pan = params.get("pan").toInt();
     settings.pan = constrain(settings.pan, PAN_MIN, PAN_MAX);
-    settings.tilt = request->getParam("tilt")->value().toInt();
+    settings.tilt = params.get("tilt").toInt();
     settings.tilt = constrain(settings.tilt, TILT_MIN, TILT_MAX);
-    settings.flip = request->getParam("flip")->value().toInt();
+    settings.flip = params.get("flip").toInt();
     if (settings.flip < 0 || settings.flip > 3) settings.flip = 0;
     
-    i2cComm.sendKeystoneAndFlip(settings.pan, settings.tilt, settings.flip);
-    eepromMgr.saveSettings(settings);
-    request->send(200, "text/plain", "Keystone and Flip updated");
+    // Latest value wins; flushed to the module and EEPROM from loop()
+    coalescer.stage(settings, COALESCE_GEOMETRY);
+    return {200, "text/plain", "Keystone and Flip updated"};
 }
 
-void WebServer::handleCustomCommand(AsyncWebServerRequest* request) {
-    if (!request->hasParam("cmd")) {
-        request->send(400, "text/plain", "Missing cmd parameter");
-        return;
+ControlReply WebServer::handleCustomCommand(const ControlParams& params) {
+    if (!params.has("cmd")) {
+        return {400, "text/plain", "Missing cmd parameter"};
     }
     
-    String customCmd = request->getParam("cmd")->value();
+    String customCmd = params.get("cmd");
     
     if (customCmd.length() % 2 != 0 || customCmd.length() > 50) {
-        request->send(400, "text/plain", "Invalid command format");
-        return;
+        return {400, "text/plain", "Invalid command format"};
     }
     
     // Hex check
@@ -229,44 +524,65 @@ void WebServer::handleCustomCommand(AsyncWebServerRequest* request) {
         char c = customCmd[i];
         bool ok = (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
         if (!ok) {
-            request->send(400, "text/plain", "Invalid hex content");
-            return;
+            return {400, "text/plain", "Invalid hex content"};
         }
     }
     
-    cmdHandler.sendCustomCommand(customCmd.c_str());
-    request->send(200, "text/plain", "Custom command sent");
+    I2CCommunicator* target = resolveProjector(params);
+    if (!target) {
+        return {404, "text/plain", "Unknown projector id"};
+    }
+    
+    uint32_t seq = cmdHandler.sendCustomCommand(customCmd.c_str(), target);
+    if (!seq) {
+        return {503, "text/plain", "Custom command not queued (bus busy)"};
+    }
+    return {202, "text/plain", "Custom command queued (seq " + String(seq) + ")"};
 }
 
-void WebServer::handleTestPattern(AsyncWebServerRequest* request) {
-    if (!request->hasParam("pattern")) {
-        request->send(400, "text/plain", "Missing pattern parameter");
-        return;
+ControlReply WebServer::handleCommandStatus(const ControlParams& params) {
+    CommandStatus status;
+    if (!cmdHandler.getStatus(strtoul(params.get("seq").c_str(), nullptr, 10), status)) {
+        return {404, "text/plain", "Unknown or expired seq"};
+    }
+    return {200, "application/json", commandStatusJson(status)};
+}
+
+ControlReply WebServer::handleTestPattern(const ControlParams& params) {
+    if (!params.has("pattern")) {
+        return {400, "text/plain", "Missing pattern parameter"};
     }
     
-    uint8_t pattern = request->getParam("pattern")->value().toInt();
-    i2cComm.sendTestPattern(pattern);
-    request->send(200, "text/plain", "Test pattern command sent");
+    uint8_t pattern = params.get("pattern").toInt();
+    if (isBroadcast(params)) {
+        projectors.sendTestPattern(pattern);
+    } else {
+        I2CCommunicator* target = resolveProjector(params);
+        if (!target) {
+            return {404, "text/plain", "Unknown projector id"};
+        }
+        target->sendTestPattern(pattern);
+    }
+    return {200, "text/plain", "Test pattern command sent"};
 }
 
-void WebServer::handleSetTxPower(AsyncWebServerRequest* request) {
-    if (!request->hasParam("power")) {
-        request->send(400, "text/plain", "Missing power parameter");
-        return;
+ControlReply WebServer::handleSetTxPower(const ControlParams& params) {
+    if (!params.has("power")) {
+        return {400, "text/plain", "Missing power parameter"};
     }
     
     SystemSettings settings = eepromMgr.getSettings();
-    settings.txPower = request->getParam("power")->value().toInt();
+    settings.txPower = params.get("power").toInt();
     wifiMgr.setTxPower(settings.txPower);
     eepromMgr.saveSettings(settings);
-    request->send(200, "text/plain", "Transmit Power set to " + String(settings.txPower / 4.0) + " dBm");
+    return {200, "text/plain", "Transmit Power set to " + String(settings.txPower / 4.0) + " dBm"};
 }
 
-void WebServer::handlePing(AsyncWebServerRequest* request) {
-    request->send(200, "text/plain", "ok");
+ControlReply WebServer::handlePing(const ControlParams& params) {
+    return {200, "text/plain", "ok"};
 }
 
-void WebServer::handleGetSettings(AsyncWebServerRequest* request) {
+ControlReply WebServer::handleGetSettings(const ControlParams& params) {
     SystemSettings settings = eepromMgr.getSettings();
     
     String json = "{";
@@ -285,145 +601,124 @@ void WebServer::handleGetSettings(AsyncWebServerRequest* request) {
     json += "\"fanMode\":" + String(settings.fanMode);
     json += "}";
     
-    request->send(200, "application/json", json);
+    return {200, "application/json", json};
 }
 
-void WebServer::handleSetSettings(AsyncWebServerRequest* request) {
+ControlReply WebServer::handleSetSettings(const ControlParams& params) {
     SystemSettings settings = eepromMgr.getSettings();
     bool changed = false;
+    bool geometryChanged = false;
     
-    if (request->hasParam("pan")) {
-        settings.pan = request->getParam("pan")->value().toInt();
+    if (params.has("pan")) {
+        settings.pan = params.get("pan").toInt();
         settings.pan = constrain(settings.pan, PAN_MIN, PAN_MAX);
-        changed = true;
+        geometryChanged = true;
     }
     
-    if (request->hasParam("tilt")) {
-        settings.tilt = request->getParam("tilt")->value().toInt();
+    if (params.has("tilt")) {
+        settings.tilt = params.get("tilt").toInt();
         settings.tilt = constrain(settings.tilt, TILT_MIN, TILT_MAX);
-        changed = true;
+        geometryChanged = true;
     }
     
-    if (request->hasParam("flip")) {
-        settings.flip = request->getParam("flip")->value().toInt();
+    if (params.has("flip")) {
+        settings.flip = params.get("flip").toInt();
         if (settings.flip < 0 || settings.flip > 3) settings.flip = 0;
-        changed = true;
+        geometryChanged = true;
     }
     
-    if (request->hasParam("txPower")) {
-        settings.txPower = request->getParam("txPower")->value().toInt();
+    if (params.has("txPower")) {
+        settings.txPower = params.get("txPower").toInt();
         wifiMgr.setTxPower(settings.txPower);
         changed = true;
     }
     
-    if (request->hasParam("lang")) {
-        String l = request->getParam("lang")->value();
+    if (params.has("lang")) {
+        String l = params.get("lang");
         settings.lang = (l == "zh") ? 1 : 0;
         changed = true;
     }
     
-    if (changed) {
-        i2cComm.sendKeystoneAndFlip(settings.pan, settings.tilt, settings.flip);
-        eepromMgr.saveSettings(settings);
+    // 只有几何参数才下发到模块（txPower/lang 与投影模块无关）；
+    // 两者都经合并器的延迟提交写入 EEPROM，拖动滑块时不会每次都 commit
+    if (geometryChanged) {
+        coalescer.stage(settings, COALESCE_GEOMETRY);
+    } else if (changed) {
+        eepromMgr.stageSettings(settings);
     }
     
-    request->send(200, "text/plain", "OK");
+    return {200, "text/plain", "OK"};
 }
 
-void WebServer::handleSetLang(AsyncWebServerRequest* request) {
-    if (!request->hasParam("lang")) {
-        request->send(400, "text/plain", "Missing lang");
-        return;
+ControlReply WebServer::handleSetLang(const ControlParams& params) {
+    if (!params.has("lang")) {
+        return {400, "text/plain", "Missing lang"};
     }
     
     SystemSettings settings = eepromMgr.getSettings();
-    String l = request->getParam("lang")->value();
+    String l = params.get("lang");
     settings.lang = (l == "zh") ? 1 : 0;
     eepromMgr.saveSettings(settings);
-    request->send(200, "text/plain", "Lang updated");
+    return {200, "text/plain", "Lang updated"};
 }
 
-void WebServer::handleSetPQ(AsyncWebServerRequest* request) {
+ControlReply WebServer::handleSetPQ(const ControlParams& params) {
     SystemSettings settings = eepromMgr.getSettings();
-    bool pqChanged = false;
+    uint8_t keys = 0;
     
-    if (request->hasParam("brightness")) {
-        settings.brightness = request->getParam("brightness")->value().toInt();
+    if (params.has("brightness")) {
+        settings.brightness = params.get("brightness").toInt();
         settings.brightness = constrain(settings.brightness, 0, 255);
-        int val = map(settings.brightness, 0, 255, -31, 31);
-        i2cComm.sendPictureQualityCommand(0x43, 0x01, (int8_t)val);
-        pqChanged = true;
+        keys |= COALESCE_BRIGHTNESS;
     }
     
-    if (request->hasParam("contrast")) {
-        settings.contrast = request->getParam("contrast")->value().toInt();
+    if (params.has("contrast")) {
+        settings.contrast = params.get("contrast").toInt();
         settings.contrast = constrain(settings.contrast, 0, 255);
-        int val = map(settings.contrast, 0, 255, -15, 15);
-        i2cComm.sendPictureQualityCommand(0x45, 0x01, (int8_t)val);
-        pqChanged = true;
+        keys |= COALESCE_CONTRAST;
     }
     
-    if (request->hasParam("hueU") && request->hasParam("hueV")) {
-        settings.hueU = request->getParam("hueU")->value().toInt();
+    if (params.has("hueU") && params.has("hueV")) {
+        settings.hueU = params.get("hueU").toInt();
         settings.hueU = constrain(settings.hueU, 0, 255);
-        settings.hueV = request->getParam("hueV")->value().toInt();
+        settings.hueV = params.get("hueV").toInt();
         settings.hueV = constrain(settings.hueV, 0, 255);
-        int u = map(settings.hueU, 0, 255, -15, 15);
-        int v = map(settings.hueV, 0, 255, -15, 15);
-        Wire.beginTransmission(I2C_ADDRESS);
-        Wire.write(0x47); // Set Hue
-        Wire.write(0x02); // OP0=2
-        Wire.write((int8_t)u); // OP1: U
-        Wire.write((int8_t)v); // OP2: V
-        uint8_t error = Wire.endTransmission();
-        Serial.printf("[PQ] Set Hue U/V: %d/%d, I2C error=%d\n", u, v, error);
-        pqChanged = true;
-    }
-    
-    if (request->hasParam("satU") && request->hasParam("satV")) {
-        settings.satU = request->getParam("satU")->value().toInt();
+        keys |= COALESCE_HUE;
+    }
+    
+    if (params.has("satU") && params.has("satV")) {
+        settings.satU = params.get("satU").toInt();
         settings.satU = constrain(settings.satU, 0, 255);
-        settings.satV = request->getParam("satV")->value().toInt();
+        settings.satV = params.get("satV").toInt();
         settings.satV = constrain(settings.satV, 0, 255);
-        int u = map(settings.satU, 0, 255, -15, 15);
-        int v = map(settings.satV, 0, 255, -15, 15);
-        Wire.beginTransmission(I2C_ADDRESS);
-        Wire.write(0x49); // Set Saturation
-        Wire.write(0x02); // OP0=2
-        Wire.write((int8_t)u); // OP1: U
-        Wire.write((int8_t)v); // OP2: V
-        Wire.endTransmission();
-        pqChanged = true;
-    }
-    
-    if (request->hasParam("sharpness")) {
-        settings.sharpness = request->getParam("sharpness")->value().toInt();
-        settings.sharpness = constrain(settings.sharpness, 0, 255);
-        int val = map(settings.sharpness, 0, 255, 0, 8);
-        i2cComm.sendPictureQualityCommand(0x4F, 0x01, (uint8_t)val);
-        pqChanged = true;
+        keys |= COALESCE_SATURATION;
     }
     
-    if (pqChanged) {
-        eepromMgr.saveSettings(settings);
+    if (params.has("sharpness")) {
+        settings.sharpness = params.get("sharpness").toInt();
+        settings.sharpness = constrain(settings.sharpness, 0, 255);
+        keys |= COALESCE_SHARPNESS;
     }
     
-    request->send(200, "text/plain", "PQ updated");
+    // Latest value per field wins; flushed as one 0x41 frame from loop()
+    coalescer.stage(settings, keys);
+    
+    return {200, "text/plain", "PQ updated"};
 }
 
-void WebServer::handleFactoryReset(AsyncWebServerRequest* request) {
+ControlReply WebServer::handleFactoryReset(const ControlParams& params) {
     i2cComm.sendFactoryResetCommand();
-    request->send(200, "text/plain", "Factory reset command sent.");
+    return {200, "text/plain", "Factory reset command sent."};
 }
 
-void WebServer::handleSaveAll(AsyncWebServerRequest* request) {
+ControlReply WebServer::handleSaveAll(const ControlParams& params) {
     i2cComm.sendSaveAllCommand();
-    request->send(200, "text/plain", "Save all command sent.");
+    return {200, "text/plain", "Save all command sent."};
 }
 
-void WebServer::handleGetDeviceInfo(AsyncWebServerRequest* request) {
-    // Request all device information
-    devInfoMgr.requestAll();
+ControlReply WebServer::handleGetDeviceInfo(const ControlParams& params) {
+    // Refresh in loop(); answer immediately with the cached values
+    devInfoMgr.scheduleRefresh(true);
     
     String json = "{";
     json += "\"temperature\":{\"current\":" + String(devInfoMgr.getTemperature()) +
@@ -434,25 +729,42 @@ void WebServer::handleGetDeviceInfo(AsyncWebServerRequest* request) {
             "\",\"parameter\":\"" + devInfoMgr.getParameterVersion() +
             "\",\"data\":\"" + devInfoMgr.getDataVersion() + "\"},";
     json += "\"lot_number\":\"" + devInfoMgr.getLotNumber() + "\",";
-    json += "\"serial_number\":\"" + devInfoMgr.getSerialNumber() + "\"";
+    json += "\"serial_number\":\"" + devInfoMgr.getSerialNumber() + "\",";
+    const ReconcileReport& reconcile = devInfoMgr.getReconcileReport();
+    json += "\"reconcile\":{\"done\":" + String(reconcile.done ? "true" : "false") +
+            ",\"position_read\":" + String(reconcile.geometryRead ? "true" : "false") +
+            ",\"pq_read\":" + String(reconcile.pqRead ? "true" : "false") +
+            ",\"module_stale\":" + String(reconcile.moduleStale) +
+            ",\"eeprom_stale\":" + String(reconcile.eepromStale) + "}";
     json += "}";
     
     Serial.println("[WebServer] Sending device info: " + json);
-    request->send(200, "application/json", json);
+    return {200, "application/json", json};
 }
 
-void WebServer::handleGetTemperature(AsyncWebServerRequest* request) {
-    devInfoMgr.requestTemperature();
+ControlReply WebServer::handleGetTemperature(const ControlParams& params) {
+    devInfoMgr.scheduleRefresh(false);
     
     String json = "{\"temperature\":" + String(devInfoMgr.getTemperature()) +
                   ",\"mute_threshold\":" + String(devInfoMgr.getMuteThreshold()) +
                   ",\"stop_threshold\":" + String(devInfoMgr.getStopThreshold()) + "}";
-    request->send(200, "application/json", json);
+    return {200, "application/json", json};
 }
 
 void WebServer::handleGetNotifications(AsyncWebServerRequest* request) {
-    // Return system status information
-    String json = "{\"notifications\":[]}";
+    // 最近保留的 Notify（与 /events 的 notify 事件格式相同），旧的在前
+    uint32_t last = eventHub.getNotifySeq();
+    uint32_t first = last > EVENT_NOTIFY_QUEUE ? last - EVENT_NOTIFY_QUEUE + 1 : 1;
+    String json = "{\"notifications\":[";
+    bool any = false;
+    NotifyRecord notify;
+    for (uint32_t seq = first; seq <= last; seq++) {
+        if (!eventHub.getNotify(seq, notify)) continue;
+        if (any) json += ",";
+        json += notifyEventJson(notify);
+        any = true;
+    }
+    json += "]}";
     request->send(200, "application/json", json);
 }
 
@@ -547,23 +859,720 @@ void WebServer::handleWiFiDisconnect(AsyncWebServerRequest* request) {
     request->send(200, "text/plain", "Disconnected and returned to AP mode");
 }
 
-void WebServer::handleWiFiStatus(AsyncWebServerRequest* request) {
+ControlReply WebServer::handleWiFiStatus(const ControlParams& params) {
     SystemSettings settings = eepromMgr.getSettings();
-    request->send(200, "application/json", wifiMgr.getStatusJSON(settings.lang));
+    return {200, "application/json", wifiMgr.getStatusJSON(settings.lang)};
 }
 
-void WebServer::handleSetFan(AsyncWebServerRequest* request) {
-    if (!request->hasParam("mode")) {
-        request->send(400, "text/plain", "missing mode");
-        return;
+ControlReply WebServer::handleSetFan(const ControlParams& params) {
+    if (!params.has("mode")) {
+        return {400, "text/plain", "missing mode"};
     }
     
-    uint8_t mode = request->getParam("mode")->value().toInt();
+    uint8_t mode = params.get("mode").toInt();
     
     SystemSettings settings = eepromMgr.getSettings();
     settings.fanMode = mode;
     eepromMgr.saveSettings(settings);
     
     fanCtrl.setMode(mode);
+    return {200, "text/plain", "OK"};
+}
+
+void WebServer::handleCoalesceStats(AsyncWebServerRequest* request) {
+    CoalesceStats stats = coalescer.getStats();
+    
+    String json = "{";
+    json += "\"staged\":" + String(stats.staged) + ",";
+    json += "\"sent\":" + String(stats.sent) + ",";
+    json += "\"dropped\":" + String(stats.dropped) + ",";
+    json += "\"failed\":" + String(stats.failed) + ",";
+    json += "\"flushes\":" + String(stats.flushes) + ",";
+    json += "\"min_interval_ms\":" + String(coalescer.getMinInterval());
+    json += "}";
+    
+    if (request->hasParam("reset")) {
+        coalescer.resetStats();
+    }
+    request->send(200, "application/json", json);
+}
+
+void WebServer::handleI2CStats(AsyncWebServerRequest* request) {
+    I2CCommunicator* target = resolveProjector(ControlParams(request));
+    if (!target) {
+        request->send(404, "text/plain", "Unknown projector id");
+        return;
+    }
+    I2CCommunicator& module = *target;
+    
+    // 只在 async_tcp 任务中使用，静态分配避免占用任务栈
+    static I2CCommandStats stats[I2C_STATS_SLOTS];
+    uint8_t count = module.getCommandStats(stats, I2C_STATS_SLOTS);
+    
+    ModuleStateStats stateStats = module.getModuleStateStats();
+    I2CClockStats clock = module.getClockStats();
+    I2CRecoveryStats recovery = module.getRecoveryStats();
+    
+    String json = "{\"clock_hz\":" + String(clock.clockHz) + ",";
+    json += "\"probed_hz\":" + String(clock.probedHz) + ",";
+    json += "\"clock_fallbacks\":" + String(clock.fallbacks) + ",";
+    json += "\"last_fallback_from_hz\":" + String(clock.lastFallbackFromHz) + ",";
+    json += "\"last_fallback_ms\":" + String(clock.lastFallbackAt) + ",";
+    json += "\"retries\":" + String(recovery.retries) + ",";
+    json += "\"recovered\":" + String(recovery.recovered) + ",";
+    json += "\"surfaced_failures\":" + String(recovery.surfaced) + ",";
+    json += "\"scl_toggles\":" + String(recovery.sclToggles) + ",";
+    json += "\"wire_reinits\":" + String(recovery.reinits) + ",";
+    json += "\"shadow_skips\":" + String(module.getShadowSkips()) + ",";
+    json += "\"module_state\":\"" + String(I2CCommunicator::moduleStateName(module.getModuleState())) + "\",";
+    json += "\"state_deferred\":" + String(stateStats.deferred) + ",";
+    json += "\"state_rejected\":" + String(stateStats.rejected) + ",";
+    json += "\"state_flushed\":" + String(stateStats.flushed) + ",";
+    json += "\"state_transitions\":" + String(stateStats.transitions) + ",";
+    json += "\"lanes\":[";
+    for (uint8_t lane = 0; lane < CXN_LANE_COUNT; lane++) {
+        I2CLaneStats l = module.getLaneStats(lane);
+        if (lane > 0) json += ",";
+        json += "{\"lane\":\"" + String(I2CCommunicator::laneName(lane)) + "\",";
+        json += "\"count\":" + String(l.count) + ",";
+        json += "\"dropped\":" + String(l.dropped) + ",";
+        json += "\"preemptions\":" + String(l.preemptions) + ",";
+        json += "\"avg_latency_us\":" + String(l.count ? (uint32_t)(l.totalLatencyUs / l.count) : 0) + ",";
+        json += "\"max_latency_us\":" + String(l.maxLatencyUs) + "}";
+    }
+    json += "],";
+    json += "\"bucket_bounds_us\":[";
+    for (uint8_t b = 0; b < I2C_STATS_BUCKETS - 1; b++) {
+        if (b > 0) json += ",";
+        json += String(I2C_LATENCY_BOUNDS_US[b]);
+    }
+    json += "],\"commands\":[";
+    for (uint8_t i = 0; i < count; i++) {
+        const I2CCommandStats& s = stats[i];
+        char cmdHex[5];
+        snprintf(cmdHex, sizeof(cmdHex), "0x%02X", s.cmd);
+        
+        if (i > 0) json += ",";
+        json += "{\"cmd\":\"" + String(cmdHex) + "\",";
+        json += "\"count\":" + String(s.count) + ",";
+        json += "\"nacks\":" + String(s.nacks) + ",";
+        json += "\"bus_errors\":" + String(s.busErrors) + ",";
+        json += "\"timeouts\":" + String(s.timeouts) + ",";
+        json += "\"short_reads\":" + String(s.shortReads) + ",";
+        json += "\"tx_bytes\":" + String(s.txBytes) + ",";
+        json += "\"rx_bytes\":" + String(s.rxBytes) + ",";
+        json += "\"avg_us\":" + String(s.count ? (uint32_t)(s.totalUs / s.count) : 0) + ",";
+        json += "\"max_us\":" + String(s.maxUs) + ",";
+        json += "\"histogram\":[";
+        for (uint8_t b = 0; b < I2C_STATS_BUCKETS; b++) {
+            if (b > 0) json += ",";
+            json += String(s.buckets[b]);
+        }
+        json += "]}";
+    }
+    json += "]}";
+    
+    if (request->hasParam("reset")) {
+        module.resetCommandStats();
+    }
+    request->send(200, "application/json", json);
+}
+
+void WebServer::handleModuleUpdateBody(AsyncWebServerRequest* request, uint8_t* data,
+                                       size_t len, size_t index, size_t total) {
+    if (index == 0) {
+        // 每个请求携带镜像的一片：offset 为本片在镜像中的位置，size 为镜像总字节数
+        // 暂存环放不下本片时不接收，由客户端按 503 应答中的 received_bytes 稍后重试
+        uint32_t offset = request->hasParam("offset") ? request->getParam("offset")->value().toInt() : 0;
+        uint32_t size = request->hasParam("size") ? request->getParam("size")->value().toInt() : total;
+        if (updateRequest || total > UPDATE_SLICE_BYTES || offset + total > size) return;
+        
+        if (offset == 0) {
+            if (updater.isActive()) return;   // 已有更新进行中
+            UpdateTarget target = UPDATE_FIRMWARE;
+            if (request->hasParam("target") && request->getParam("target")->value() == "image") {
+                target = UPDATE_IMAGE;
+            }
+            if (!updater.start(target, size)) return;
+        } else if (!updater.isActive() || offset != updater.getStatus().receivedBytes ||
+                   total > updater.space()) {
+            return;
+        }
+        
+        updateRequest = request;
+        request->onDisconnect([this, request]() {
+            if (updateRequest == request) {
+                updater.abort("Client disconnected");
+                updateRequest = nullptr;
+            }
+        });
+    }
+    if (request != updateRequest) return;
+    
+    // 只复制到暂存环，0x9F 块由 loop() 下发，网络任务不等待总线
+    if (!updater.write(data, len)) {
+        updater.abort("Write failed");
+        return;
+    }
+    if (index + len == total) {
+        UpdateStatus status = updater.getStatus();
+        if (status.receivedBytes == status.totalBytes) updater.finish();
+    }
+}
+
+void WebServer::handleModuleUpdate(AsyncWebServerRequest* request) {
+    if (request != updateRequest) {
+        UpdateStatus status = updater.getStatus();
+        bool resume = request->hasParam("offset") && request->getParam("offset")->value().toInt() > 0;
+        if (status.state == UPDATE_FAILED && status.error) {
+            request->send(500, "application/json",
+                          "{\"status\":\"error\",\"message\":\"" + String(status.error) + "\"}");
+        } else if (status.state == UPDATE_RUNNING && resume) {
+            // 暂存环已满或位置不符：客户端从 received_bytes 处重试
+            handleModuleUpdateStatus(request, 503);
+        } else {
+            request->send(409, "application/json",
+                          "{\"status\":\"error\",\"message\":\"Update already in progress or empty body\"}");
+        }
+        return;
+    }
+    updateRequest = nullptr;
+    handleModuleUpdateStatus(request);
+}
+
+void WebServer::handleModuleUpdateStatus(AsyncWebServerRequest* request, int code) {
+    static const char* const stateNames[] = {"idle", "running", "done", "failed"};
+    UpdateStatus status = updater.getStatus();
+    
+    String json = "{";
+    json += "\"state\":\"" + String(stateNames[status.state]) + "\",";
+    json += "\"target\":\"" + String(status.target == UPDATE_IMAGE ? "image" : "firmware") + "\",";
+    json += "\"total_bytes\":" + String(status.totalBytes) + ",";
+    json += "\"received_bytes\":" + String(status.receivedBytes) + ",";
+    json += "\"sent_bytes\":" + String(status.sentBytes) + ",";
+    json += "\"blocks\":" + String(status.blocks) + ",";
+    json += "\"checksum\":" + String(status.checksum) + ",";
+    json += "\"elapsed_ms\":" + String(status.elapsedMs) + ",";
+    json += "\"bytes_per_sec\":" + String(status.bytesPerSec);
+    if (status.error) {
+        json += ",\"error\":\"" + String(status.error) + "\"";
+    }
+    json += "}";
+    request->send(code, "application/json", json);
+}
+
+static String jsonEscape(const String& text) {
+    String out;
+    for (unsigned int i = 0; i < text.length(); i++) {
+        char c = text[i];
+        if (c == '"' || c == '\\') out += '\\';
+        if ((uint8_t)c >= 0x20) out += c;
+    }
+    return out;
+}
+
+static const int TX_POWER_LEVELS[] = {78, 76, 74, 68, 60, 52, 44, 34, 28, 20, 8, -4};
+
+// 整数参数：必须存在、只含数字（可带负号）且在 [min, max] 内
+static bool intParam(const ControlParams& params, const char* name, long min, long max,
+                     long& value, String& error) {
+    String text = params.get(name);
+    bool digits = text.length() > 0 && text != "-";
+    for (unsigned int i = 0; i < text.length() && digits; i++) {
+        digits = isDigit(text[i]) || (i == 0 && text[i] == '-');
+    }
+    if (!digits) {
+        error = String("Missing or invalid ") + name;
+        return false;
+    }
+    value = text.toInt();
+    if (value < min || value > max) {
+        error = String(name) + " out of range";
+        return false;
+    }
+    return true;
+}
+
+bool WebServer::applyBatchOp(const char* name, const ControlParams& params, SystemSettings& settings,
+                             bool execute, String& result, uint8_t& modules) {
+    long v1, v2, v3;
+    modules = 0;
+    
+    if (strcmp(name, "keystone") == 0) {
+        if (!intParam(params, "pan", PAN_MIN, PAN_MAX, v1, result) ||
+            !intParam(params, "tilt", TILT_MIN, TILT_MAX, v2, result) ||
+            !intParam(params, "flip", 0, 3, v3, result)) return false;
+        settings.pan = v1;
+        settings.tilt = v2;
+        settings.flip = v3;
+        // 几何只写主模块：各模块的梯形/翻转取决于各自的安装位置，EEPROM 也只保存主模块的一组，
+        // 与 /set_settings、写入合并器和启动时的对齐一致（画质为共用设置，发往所有模块）
+        if (execute) {
+            coalescer.cancel(COALESCE_GEOMETRY);
+            if (i2cComm.sendKeystoneAndFlip(settings.pan, settings.tilt, settings.flip)) {
+                modules = 1;
+            } else {
+                result = "Not queued (queue full)";
+            }
+        }
+        return true;
+    }
+    
+    if (strcmp(name, "set_pq") == 0) {
+        // 与 /set_pq 相同的字段，U/V 成对出现；至少一项
+        uint8_t keys = 0;
+        if (params.has("brightness")) {
+            if (!intParam(params, "brightness", 0, 255, v1, result)) return false;
+            settings.brightness = v1;
+            keys |= COALESCE_BRIGHTNESS;
+        }
+        if (params.has("contrast")) {
+            if (!intParam(params, "contrast", 0, 255, v1, result)) return false;
+            settings.contrast = v1;
+            keys |= COALESCE_CONTRAST;
+        }
+        if (params.has("hueU") || params.has("hueV")) {
+            if (!intParam(params, "hueU", 0, 255, v1, result) ||
+                !intParam(params, "hueV", 0, 255, v2, result)) return false;
+            settings.hueU = v1;
+            settings.hueV = v2;
+            keys |= COALESCE_HUE;
+        }
+        if (params.has("satU") || params.has("satV")) {
+            if (!intParam(params, "satU", 0, 255, v1, result) ||
+                !intParam(params, "satV", 0, 255, v2, result)) return false;
+            settings.satU = v1;
+            settings.satV = v2;
+            keys |= COALESCE_SATURATION;
+        }
+        if (params.has("sharpness")) {
+            if (!intParam(params, "sharpness", 0, 255, v1, result)) return false;
+            settings.sharpness = v1;
+            keys |= COALESCE_SHARPNESS;
+        }
+        if (!keys) {
+            result = "No picture quality fields";
+            return false;
+        }
+        if (execute) {
+            coalescer.cancel(keys);
+            modules = projectors.sendPictureQuality(settings);
+            if (modules != projectors.count()) {
+                result = "Queued on " + String(modules) + "/" + String(projectors.count()) + " modules";
+            }
+        }
+        return true;
+    }
+    
+    if (strcmp(name, "set_tx_power") == 0) {
+        if (!intParam(params, "power", -4, 78, v1, result)) return false;
+        bool supported = false;
+        for (int level : TX_POWER_LEVELS) supported |= level == v1;
+        if (!supported) {
+            result = "Unsupported power level";
+            return false;
+        }
+        settings.txPower = v1;
+        if (execute) wifiMgr.setTxPower(settings.txPower);
+        return true;
+    }
+    
+    if (strcmp(name, "set_fan") == 0) {
+        if (!intParam(params, "mode", 0, 4, v1, result)) return false;
+        settings.fanMode = v1;
+        if (execute) fanCtrl.setMode(settings.fanMode);
+        return true;
+    }
+    
+    if (strcmp(name, "command") == 0) {
+        if (!intParam(params, "cmd", 1, cmdHandler.getCommandCount(), v1, result)) return false;
+        bool broadcast = isBroadcast(params);
+        I2CCommunicator* target = broadcast ? nullptr : resolveProjector(params);
+        if (!broadcast && !target) {
+            result = "Unknown projector id";
+            return false;
+        }
+        if (!execute) return true;
+        
+        if (broadcast) {
+            const CommandFrame* frame = cmdHandler.getCommand(v1 - 1);
+            modules = projectors.broadcast(frame->bytes, frame->length);
+            if (modules != projectors.count()) {
+                result = "Queued on " + String(modules) + "/" + String(projectors.count()) + " modules";
+            }
+        } else if (cmdHandler.sendCommandByIndex(v1, target)) {
+            modules = 1;
+        } else {
+            result = "Not queued (bus busy)";
+        }
+        return true;
+    }
+    
+    result = "Unknown operation";
+    return false;
+}
+
+void WebServer::handleBatchBody(AsyncWebServerRequest* request, uint8_t* data,
+                                size_t len, size_t index, size_t total) {
+    if (total > BATCH_MAX_BYTES) return;
+    if (index == 0) {
+        // 由库在请求结束时释放
+        request->_tempObject = malloc(total + 1);
+    }
+    char* body = (char*)request->_tempObject;
+    if (!body || index + len > total) return;
+    memcpy(body + index, data, len);
+    if (index + len == total) body[total] = '\0';
+}
+
+void WebServer::handleBatch(AsyncWebServerRequest* request) {
+    char* body = (char*)request->_tempObject;
+    if (!body || request->contentLength() == 0) {
+        request->send(request->contentLength() > BATCH_MAX_BYTES ? 413 : 400, "text/plain",
+                      "Body must be 1.." + String(BATCH_MAX_BYTES) + " bytes");
+        return;
+    }
+    
+    // 拆成 "名称" 和 "k=v&..."，跳过空行
+    const char* names[BATCH_MAX_OPS];
+    const char* queries[BATCH_MAX_OPS];
+    uint8_t count = 0;
+    char* saveptr = nullptr;
+    for (char* line = strtok_r(body, "\r\n", &saveptr); line; line = strtok_r(nullptr, "\r\n", &saveptr)) {
+        while (*line == ' ') line++;
+        if (!*line) continue;
+        if (count == BATCH_MAX_OPS) {
+            request->send(413, "text/plain", "More than " + String(BATCH_MAX_OPS) + " operations");
+            return;
+        }
+        char* query = strchr(line, '?');
+        if (query) *query++ = '\0';
+        names[count] = line;
+        queries[count] = query ? query : "";
+        count++;
+    }
+    
+    // 第一遍只校验（设置改动作用在副本上），任一无效时整批拒绝
+    SystemSettings original = eepromMgr.getSettings();
+    SystemSettings settings = original;
+    String results[BATCH_MAX_OPS];
+    uint8_t modules[BATCH_MAX_OPS] = {};
+    bool valid = true;
+    for (uint8_t i = 0; i < count; i++) {
+        if (!applyBatchOp(names[i], ControlParams(queries[i]), settings, false, results[i], modules[i])) {
+            valid = false;
+        }
+    }
+    
+    // 第二遍按顺序异步入队，期间占住所有总线：释放后整批写入紧接执行，中间不夹杂其它事务
+    unsigned long start = millis();
+    if (valid) {
+        settings = original;
+        projectors.beginBatch();
+        for (uint8_t i = 0; i < count; i++) {
+            applyBatchOp(names[i], ControlParams(queries[i]), settings, true, results[i], modules[i]);
+        }
+        projectors.endBatch();
+    }
+    
+    // 所有持久化字段一次提交
+    bool persist = valid && (settings.pan != original.pan || settings.tilt != original.tilt ||
+                             settings.flip != original.flip || settings.txPower != original.txPower ||
+                             settings.brightness != original.brightness || settings.contrast != original.contrast ||
+                             settings.hueU != original.hueU || settings.hueV != original.hueV ||
+                             settings.satU != original.satU || settings.satV != original.satV ||
+                             settings.sharpness != original.sharpness || settings.fanMode != original.fanMode);
+    if (persist) {
+        eepromMgr.saveSettings(settings);
+    }
+    
+    // 每个操作只报告是否已入队及入队的模块数（几何只写主模块，画质与广播命令为所有模块），
+    // 不等待 I2C 写入完成；写入结果由命令状态/SSE 和模块状态得知
+    String json = "{\"accepted\":" + String(valid ? "true" : "false") +
+                  ",\"committed\":" + String(persist ? "true" : "false") + ",\"results\":[";
+    for (uint8_t i = 0; i < count; i++) {
+        if (i > 0) json += ",";
+        json += "{\"op\":\"" + jsonEscape(names[i]) + "\",\"queued\":" +
+                String(valid && !results[i].length() ? "true" : "false") +
+                ",\"modules\":" + String(modules[i]);
+        if (results[i].length()) {
+            json += ",\"error\":\"" + jsonEscape(results[i]) + "\"";
+        } else if (!valid) {
+            json += ",\"skipped\":true";
+        }
+        json += "}";
+    }
+    json += "]}";
+    
+    if (valid) {
+        Serial.printf("[WebServer] Batch: %d operation(s) in %lu ms, EEPROM %s\n",
+                      count, millis() - start, persist ? "committed" : "unchanged");
+    }
+    request->send(valid ? 200 : 400, "application/json", json);
+}
+
+void WebServer::handleSetI2CClock(AsyncWebServerRequest* request) {
+    I2CCommunicator* target = resolveProjector(ControlParams(request));
+    if (!target) {
+        request->send(404, "text/plain", "Unknown projector id");
+        return;
+    }
+    I2CCommunicator& module = *target;
+    
+    if (!request->hasParam("hz")) {
+        request->send(400, "text/plain", "Missing hz parameter");
+        return;
+    }
+    
+    uint32_t hz = request->getParam("hz")->value().toInt();
+    if (hz < I2C_CLOCK_SLOW_HZ || hz > I2C_CLOCK_FAST_HZ) {
+        request->send(400, "text/plain", "Clock out of range");
+        return;
+    }
+    module.setClock(hz);
     request->send(200, "text/plain", "OK");
 }
+
+void WebServer::handleI2CCapture(AsyncWebServerRequest* request) {
+    // 只在 async_tcp 任务中使用，静态分配避免占用任务栈
+    static uint8_t dump[CAPTURE_DUMP_MAX];
+    size_t length = busCapture.dump(dump);
+    if (request->hasParam("clear") && request->getParam("clear")->value() == "1") {
+        busCapture.clear();
+    }
+    
+    AsyncResponseStream* response = request->beginResponseStream("application/octet-stream");
+    response->addHeader("Content-Disposition", "attachment; filename=i2c_capture.bin");
+    response->write(dump, length);
+    request->send(response);
+}
+
+static String calibrationToJson(const CalibrationResult& result) {
+    String json = "{\"seq\":" + String(result.seq) + ",\"state\":\"";
+    json += !result.done ? "pending" : result.message ? "failed" : "done";
+    json += "\"";
+    if (result.message) {
+        json += ",\"message\":\"" + String(result.message) + "\"";
+        if (result.error) json += ",\"i2c_error\":" + String(result.error);
+    }
+    if (result.hasSnapshot) {
+        const CalibrationSnapshot& snapshot = result.snapshot;
+        char biPhase[11];
+        snprintf(biPhase, sizeof(biPhase), "%08lX", (unsigned long)snapshot.biPhase);
+        
+        json += ",\"h\":[";
+        for (uint8_t i = 0; i < 5; i++) {
+            if (i > 0) json += ",";
+            json += String(snapshot.optical.horizontal[i]);
+        }
+        json += "],\"v\":[";
+        for (uint8_t i = 0; i < 5; i++) {
+            if (i > 0) json += ",";
+            json += String(snapshot.optical.vertical[i]);
+        }
+        json += "],\"biphase\":\"" + String(biPhase) + "\"";
+    }
+    json += "}";
+    return json;
+}
+
+// 解析 "a,b,c,d,e" 形式的 5 个偏移值
+static bool parseOffsets(const String& text, int8_t* out) {
+    int start = 0;
+    for (uint8_t i = 0; i < 5; i++) {
+        int end = text.indexOf(',', start);
+        if (end < 0) end = text.length();
+        if (end <= start || (i < 4 && end == (int)text.length())) return false;
+        int value = text.substring(start, end).toInt();
+        if (value < -128 || value > 127) return false;
+        out[i] = (int8_t)value;
+        start = end + 1;
+    }
+    return start > (int)text.length();
+}
+
+// 解析 1~8 位十六进制的双相位值（DDCCBBAA）
+static bool parseBiPhase(const String& text, uint32_t& out) {
+    if (text.length() < 1 || text.length() > 8) return false;
+    for (unsigned int i = 0; i < text.length(); i++) {
+        if (!isxdigit((unsigned char)text[i])) return false;   // 不接受符号、空白和 0x 前缀
+    }
+    char* end = nullptr;
+    out = strtoul(text.c_str(), &end, 16);
+    return end && *end == '\0';
+}
+
+// 校准的 I2C 读写由 loop() 执行，这里只排入请求；结果经 /calibration_result?seq= 查询
+void WebServer::scheduleCalibration(AsyncWebServerRequest* request, const CalibrationRequest& calRequest) {
+    uint32_t seq = calibration.schedule(calRequest);
+    if (!seq) {
+        request->send(503, "text/plain", "Calibration busy");
+        return;
+    }
+    request->send(202, "application/json", "{\"seq\":" + String(seq) + ",\"state\":\"pending\"}");
+}
+
+void WebServer::handleGetCalibration(AsyncWebServerRequest* request) {
+    I2CCommunicator* target = resolveProjector(ControlParams(request));
+    if (!target) {
+        request->send(404, "text/plain", "Unknown projector id");
+        return;
+    }
+    
+    CalibrationRequest calRequest = {};
+    calRequest.action = CAL_ACTION_READ;
+    calRequest.target = target;
+    scheduleCalibration(request, calRequest);
+}
+
+void WebServer::handleSetCalibration(AsyncWebServerRequest* request) {
+    I2CCommunicator* target = resolveProjector(ControlParams(request));
+    if (!target) {
+        request->send(404, "text/plain", "Unknown projector id");
+        return;
+    }
+    
+    CalibrationRequest calRequest = {};
+    calRequest.action = CAL_ACTION_WRITE;
+    calRequest.target = target;
+    calRequest.hasH = request->hasParam("h");
+    calRequest.hasV = request->hasParam("v");
+    calRequest.hasBiPhase = request->hasParam("biphase");
+    if (!calRequest.hasH && !calRequest.hasV && !calRequest.hasBiPhase) {
+        request->send(400, "text/plain", "Missing h/v/biphase parameter");
+        return;
+    }
+    
+    OpticalAxisOffsets& offsets = calRequest.values.optical;
+    if (calRequest.hasH && !parseOffsets(request->getParam("h")->value(), offsets.horizontal)) {
+        request->send(400, "text/plain", "Invalid h (expected 5 comma-separated values)");
+        return;
+    }
+    if (calRequest.hasV && !parseOffsets(request->getParam("v")->value(), offsets.vertical)) {
+        request->send(400, "text/plain", "Invalid v (expected 5 comma-separated values)");
+        return;
+    }
+    if (calRequest.hasBiPhase && !parseBiPhase(request->getParam("biphase")->value(), calRequest.values.biPhase)) {
+        request->send(400, "text/plain", "Invalid biphase (expected 1-8 hex digits)");
+        return;
+    }
+    scheduleCalibration(request, calRequest);
+}
+
+void WebServer::handleCalibrationSnapshot(AsyncWebServerRequest* request) {
+    String action = request->hasParam("action") ? request->getParam("action")->value() : "";
+    
+    CalibrationRequest calRequest = {};
+    calRequest.action = action == "save" ? CAL_ACTION_CAPTURE :
+                        action == "restore" ? CAL_ACTION_RESTORE : CAL_ACTION_LOAD;
+    scheduleCalibration(request, calRequest);
+}
+
+void WebServer::handleCalibrationResult(AsyncWebServerRequest* request) {
+    CalibrationResult result = calibration.getResult();
+    if (request->hasParam("seq") && (uint32_t)request->getParam("seq")->value().toInt() != result.seq) {
+        // 只保留最近一次请求的结果
+        request->send(404, "text/plain", "Unknown or superseded seq");
+        return;
+    }
+    request->send(result.done ? result.code : 202, "application/json", calibrationToJson(result));
+}
+
+I2CCommunicator* WebServer::resolveProjector(const ControlParams& params) {
+    if (!params.has("id")) return &i2cComm;
+    String id = params.get("id");
+    if (id.length() == 0 || id.length() > 3 || !isDigit(id[0])) return nullptr;
+    return projectors.get(id.toInt());
+}
+
+bool WebServer::isBroadcast(const ControlParams& params) {
+    return params.has("id") && params.get("id") == "all";
+}
+
+void WebServer::handleProjectors(AsyncWebServerRequest* request) {
+    String json = "[";
+    for (uint8_t id = 0; id < projectors.count(); id++) {
+        I2CCommunicator* module = projectors.get(id);
+        char address[5];
+        snprintf(address, sizeof(address), "0x%02X", module->getAddress());
+        
+        if (id > 0) json += ",";
+        json += "{\"id\":" + String(id) + ",";
+        json += "\"address\":\"" + String(address) + "\",";
+        json += "\"mux_channel\":" + String(module->getMuxChannel()) + ",";
+        json += "\"com_req_pin\":" + String(module->getComReqPin()) + ",";
+        json += "\"clock_hz\":" + String(module->getClockStats().clockHz) + ",";
+        json += "\"module_state\":\"" + String(I2CCommunicator::moduleStateName(module->getModuleState())) + "\"}";
+    }
+    json += "]";
+    request->send(200, "application/json", json);
+}
+
+void WebServer::handleMacros(AsyncWebServerRequest* request) {
+    macros.ensureLoaded();
+    MacroStatus status = macros.getStatus();
+    
+    String json = "{\"state\":\"" + String(MacroEngine::stateName(status.state)) + "\",";
+    json += "\"slot\":" + String(status.slot) + ",";
+    json += "\"steps\":" + String(status.steps) + ",";
+    json += "\"elapsed_ms\":" + String(status.elapsedMs) + ",";
+    json += "\"error\":\"" + String(status.error ? status.error : "") + "\",";
+    json += "\"macros\":[";
+    for (uint8_t slot = 0; slot < MACRO_SLOTS; slot++) {
+        if (slot > 0) json += ",";
+        json += "{\"slot\":" + String(slot) + ",";
+        json += "\"name\":\"" + jsonEscape(macros.getName(slot)) + "\",";
+        json += "\"bytes\":" + String(macros.getLength(slot)) + ",";
+        json += "\"script\":\"" + jsonEscape(macros.getScript(slot)) + "\"}";
+    }
+    json += "]}";
+    request->send(200, "application/json", json);
+}
+
+void WebServer::handleSetMacro(AsyncWebServerRequest* request) {
+    if (!request->hasParam("slot") || !request->hasParam("script")) {
+        request->send(400, "text/plain", "Missing slot or script parameter");
+        return;
+    }
+    
+    uint8_t slot = request->getParam("slot")->value().toInt();
+    String name = request->hasParam("name") ? request->getParam("name")->value() : "Macro " + String(slot);
+    String error;
+    if (!macros.save(slot, name, request->getParam("script")->value(), error)) {
+        request->send(400, "text/plain", error);
+        return;
+    }
+    request->send(200, "application/json", "{\"bytes\":" + String(macros.getLength(slot)) + "}");
+}
+
+void WebServer::handleMacro(AsyncWebServerRequest* request) {
+    String action = request->hasParam("action") ? request->getParam("action")->value() : "run";
+    if (action == "stop") {
+        macros.stop();
+        request->send(200, "text/plain", "OK");
+        return;
+    }
+    
+    if (!request->hasParam("slot")) {
+        request->send(400, "text/plain", "Missing slot parameter");
+        return;
+    }
+    uint8_t slot = request->getParam("slot")->value().toInt();
+    if (slot >= MACRO_SLOTS) {
+        request->send(400, "text/plain", "Invalid slot");
+        return;
+    }
+    
+    if (action == "delete") {
+        macros.remove(slot);
+        request->send(200, "text/plain", "OK");
+    } else if (action == "run") {
+        if (!macros.run(slot)) {
+            request->send(409, "text/plain", "Macro busy or empty");
+            return;
+        }
+        request->send(200, "text/plain", "Macro started");
+    } else {
+        request->send(400, "text/plain", "Invalid action");
+    }
+}
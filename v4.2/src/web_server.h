@@ -2,6 +2,8 @@
 #define WEB_SERVER_H
 
 #include <ESPAsyncWebServer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 #include "config.h"
 #include "eeprom_manager.h"
 #include "command_handler.h"
@@ -9,6 +11,38 @@
 #include "device_info.h"
 #include "fan_controller.h"
 #include "wifi_manager.h"
+#include "write_coalescer.h"
+#include "module_updater.h"
+#include "calibration_store.h"
+#include "projector_registry.h"
+#include "macro_engine.h"
+#include "bus_capture.h"
+#include "event_hub.h"
+
+// 控制操作的参数：HTTP 查询参数，或 WebSocket 消息中 '?' 之后的 k=v&k=v（不做 URL 解码）
+class ControlParams {
+public:
+    explicit ControlParams(AsyncWebServerRequest* request);
+    explicit ControlParams(const char* query);
+    
+    bool has(const char* name) const;
+    String get(const char* name) const;     // 不存在时为空串
+    
+private:
+    static const uint8_t MAX_PARAMS = 10;
+    
+    AsyncWebServerRequest* request;
+    String names[MAX_PARAMS];
+    String values[MAX_PARAMS];
+    uint8_t count;
+};
+
+// 控制操作的结果；WebSocket 回复使用同样的状态码和正文
+struct ControlReply {
+    int code;
+    const char* type;
+    String body;
+};
 
 class WebServer {
 public:
@@ -18,11 +52,28 @@ public:
               I2CCommunicator& i2cComm,
               DeviceInfoManager& devInfoMgr,
               FanController& fanCtrl,
-              WiFiManager& wifiMgr);
+              WiFiManager& wifiMgr,
+              WriteCoalescer& coalescer,
+              ModuleUpdater& updater,
+              CalibrationStore& calibration,
+              ProjectorRegistry& projectors,
+              MacroEngine& macros);
     
     void begin();
     
+    // 在 loop() 中调用：推送变化的状态和新的 Notify，清理断开的 WebSocket 客户端并定时发送心跳
+    void loop();
+    
 private:
+    typedef ControlReply (WebServer::*ControlHandler)(const ControlParams& params);
+    
+    // HTTP 和 WebSocket 共用的控制操作（名称即 HTTP 路径去掉 '/'）
+    struct ControlRoute {
+        const char* name;
+        ControlHandler handler;
+    };
+    static const ControlRoute CONTROL_ROUTES[];
+    
     AsyncWebServer& server;
     EEPROMManager& eepromMgr;
     CommandHandler& cmdHandler;
@@ -30,25 +81,66 @@ private:
     DeviceInfoManager& devInfoMgr;
     FanController& fanCtrl;
     WiFiManager& wifiMgr;
+    WriteCoalescer& coalescer;
+    ModuleUpdater& updater;
+    CalibrationStore& calibration;
+    ProjectorRegistry& projectors;
+    MacroEngine& macros;
+    AsyncWebServerRequest* updateRequest;   // 正在上传镜像的请求
+    AsyncWebSocket ws;
+    unsigned long lastHeartbeat;
+    
+    // 每个 SSE 客户端已发送的状态版本和 Notify 序号；client 为 nullptr 表示空闲
+    struct EventClient {
+        AsyncEventSourceClient* client;
+        uint32_t sentVersion[STATE_EVENT_COUNT];
+        uint32_t sentNotify;
+    };
+    AsyncEventSource events;
+    EventClient eventClients[SSE_MAX_CLIENTS];
+    SemaphoreHandle_t eventLock;             // 连接/断开（async_tcp）与推送（loop）互斥
     
     void setupRoutes();
     
+    // 按 ?id= 选择模块（缺省为主模块），ID 无效时返回 nullptr
+    I2CCommunicator* resolveProjector(const ControlParams& params);
+    
+    // ?id=all 时广播到所有模块
+    static bool isBroadcast(const ControlParams& params);
+    
+    // WebSocket 消息："<seq> <name>[?k=v&...]"，回复 "<seq> <code> <body>"；seq 为 0 时不回复
+    void handleWsEvent(AsyncWebSocketClient* client, AwsEventType type, void* arg, uint8_t* data, size_t len);
+    void handleWsMessage(AsyncWebSocketClient* client, char* message);
+    
+    // SSE：客户端积压未超过 SSE_CLIENT_BACKLOG 时先发 Notify，再发每种变化过的状态的当前值
+    void handleEventConnect(AsyncEventSourceClient* client);
+    void handleEventDisconnect(AsyncEventSourceClient* client);
+    void pushEvents();
+    String stateEventJson(uint8_t type);
+    static String notifyEventJson(const NotifyRecord& event);
+    static String commandStatusJson(const CommandStatus& status);
+    
+    // Control handlers (HTTP GET and WebSocket)
+    ControlReply handleCommand(const ControlParams& params);
+    ControlReply handleKeystone(const ControlParams& params);
+    ControlReply handleCustomCommand(const ControlParams& params);
+    ControlReply handleCommandStatus(const ControlParams& params);
+    ControlReply handleTestPattern(const ControlParams& params);
+    ControlReply handleSetTxPower(const ControlParams& params);
+    ControlReply handlePing(const ControlParams& params);
+    ControlReply handleGetSettings(const ControlParams& params);
+    ControlReply handleSetSettings(const ControlParams& params);
+    ControlReply handleSetLang(const ControlParams& params);
+    ControlReply handleSetPQ(const ControlParams& params);
+    ControlReply handleFactoryReset(const ControlParams& params);
+    ControlReply handleSaveAll(const ControlParams& params);
+    ControlReply handleGetDeviceInfo(const ControlParams& params);
+    ControlReply handleGetTemperature(const ControlParams& params);
+    ControlReply handleWiFiStatus(const ControlParams& params);
+    ControlReply handleSetFan(const ControlParams& params);
+    
     // Route handlers
     void handleRoot(AsyncWebServerRequest* request);
-    void handleCommand(AsyncWebServerRequest* request);
-    void handleKeystone(AsyncWebServerRequest* request);
-    void handleCustomCommand(AsyncWebServerRequest* request);
-    void handleTestPattern(AsyncWebServerRequest* request);
-    void handleSetTxPower(AsyncWebServerRequest* request);
-    void handlePing(AsyncWebServerRequest* request);
-    void handleGetSettings(AsyncWebServerRequest* request);
-    void handleSetSettings(AsyncWebServerRequest* request);
-    void handleSetLang(AsyncWebServerRequest* request);
-    void handleSetPQ(AsyncWebServerRequest* request);
-    void handleFactoryReset(AsyncWebServerRequest* request);
-    void handleSaveAll(AsyncWebServerRequest* request);
-    void handleGetDeviceInfo(AsyncWebServerRequest* request);
-    void handleGetTemperature(AsyncWebServerRequest* request);
     void handleGetNotifications(AsyncWebServerRequest* request);
     void handleClearEEPROM(AsyncWebServerRequest* request);
     void handleReboot(AsyncWebServerRequest* request);
@@ -57,8 +149,34 @@ private:
     void handleSetWiFiMode(AsyncWebServerRequest* request);
     void handleWiFiConnect(AsyncWebServerRequest* request);
     void handleWiFiDisconnect(AsyncWebServerRequest* request);
-    void handleWiFiStatus(AsyncWebServerRequest* request);
-    void handleSetFan(AsyncWebServerRequest* request);
+    void handleCoalesceStats(AsyncWebServerRequest* request);
+    void handleI2CStats(AsyncWebServerRequest* request);
+    void handleSetI2CClock(AsyncWebServerRequest* request);
+    void handleI2CCapture(AsyncWebServerRequest* request);
+    void handleModuleUpdate(AsyncWebServerRequest* request);
+    void handleModuleUpdateBody(AsyncWebServerRequest* request, uint8_t* data,
+                                size_t len, size_t index, size_t total);
+    void handleModuleUpdateStatus(AsyncWebServerRequest* request, int code = 200);
+    
+    // POST /batch：正文每行一个操作，语法同 WebSocket 消息但不带序号（"keystone?pan=3&tilt=0&flip=0"）
+    // 先校验全部操作，任一无效则都不执行；否则按顺序连续下发 I2C 写入，最后只提交一次 EEPROM
+    void handleBatch(AsyncWebServerRequest* request);
+    void handleBatchBody(AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total);
+    
+    // 校验一个批量操作并把设置改动应用到 settings；execute 为 true 时同时异步入队
+    // 返回 false 时 result 为校验错误；未能全部入队时原因也写入 result
+    // modules 为入队的模块数（只影响本机的设置为 0）；入队不代表 I2C 写入已完成
+    bool applyBatchOp(const char* name, const ControlParams& params, SystemSettings& settings,
+                      bool execute, String& result, uint8_t& modules);
+    void handleGetCalibration(AsyncWebServerRequest* request);
+    void handleSetCalibration(AsyncWebServerRequest* request);
+    void handleCalibrationSnapshot(AsyncWebServerRequest* request);
+    void handleCalibrationResult(AsyncWebServerRequest* request);
+    void scheduleCalibration(AsyncWebServerRequest* request, const CalibrationRequest& calRequest);
+    void handleProjectors(AsyncWebServerRequest* request);
+    void handleMacros(AsyncWebServerRequest* request);
+    void handleSetMacro(AsyncWebServerRequest* request);
+    void handleMacro(AsyncWebServerRequest* request);
 };
 
 #endif // WEB_SERVER_H
@@ -1,11 +1,12 @@
 #include "wifi_manager.h"
 #include "config.h"
+#include "event_hub.h"
 
 WiFiManager::WiFiManager(AsyncWebServer& server) 
     : server(server), wifiManager(&server, nullptr), 
       wifiConfigured(false), scanningWiFi(false), scanRequested(false),
       scanStartTime(0), wifiScanResults("[]"), waitingForWiFi(false),
-      connectStartTime(0) {
+      connectStartTime(0), linkConnected(false) {
 }
 
 void WiFiManager::begin() {
@@ -28,6 +29,7 @@ void WiFiManager::startAPMode() {
     } else {
         Serial.println("[WiFi] Failed to start AP!");
     }
+    eventHub.changed(STATE_WIFI);
     
     // 启动时扫描并缓存
     startScan();
@@ -44,6 +46,7 @@ void WiFiManager::startSTAMode(const String& ssid, const String& pwd) {
         connectStartTime = millis();
         waitingForWiFi = true;
         Serial.printf("[WiFi] Trying to connect to SSID: %s\n", ssid.c_str());
+        eventHub.changed(STATE_WIFI);
     } else {
         Serial.println("[WiFi] No credentials provided, fallback to AP.");
         wifiConfigured = false;
@@ -52,6 +55,9 @@ void WiFiManager::startSTAMode(const String& ssid, const String& pwd) {
 }
 
 void WiFiManager::setWifiConfigured(bool configured) {
+    if (configured != wifiConfigured) {
+        eventHub.changed(STATE_WIFI);
+    }
     wifiConfigured = configured;
 }
 
@@ -156,6 +162,13 @@ void WiFiManager::enableMDNS() {
 }
 
 void WiFiManager::checkReconnectFallback() {
+    // 连接和断开（包括连接后掉线）都推送给网页
+    bool connected = WiFi.status() == WL_CONNECTED;
+    if (connected != linkConnected) {
+        linkConnected = connected;
+        eventHub.changed(STATE_WIFI);
+    }
+    
     if (waitingForWiFi) {
         wl_status_t status = WiFi.status();
         
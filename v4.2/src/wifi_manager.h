@@ -68,6 +68,7 @@ private:
     String wifiScanResults;
     bool waitingForWiFi;
     unsigned long connectStartTime;
+    bool linkConnected;          // 上次检查时 STA 是否已连接，变化时推送 wifi 事件
     
     void enableMDNS();
 };
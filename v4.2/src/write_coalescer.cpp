@@ -0,0 +1,109 @@
+#include "write_coalescer.h"
+#include "config.h"
+
+static inline uint8_t countKeys(uint8_t keys) {
+    uint8_t n = 0;
+    for (; keys; keys &= keys - 1) n++;
+    return n;
+}
+
+WriteCoalescer::WriteCoalescer()
+    : i2cComm(nullptr), eepromMgr(nullptr), projectors(nullptr), minIntervalMs(COALESCE_MIN_INTERVAL_MS),
+      lastFlush(0), pending(), dirtyKeys(0), stats() {
+}
+
+void WriteCoalescer::begin(I2CCommunicator* i2c, EEPROMManager* eeprom, ProjectorRegistry* projectors) {
+    i2cComm = i2c;
+    eepromMgr = eeprom;
+    this->projectors = projectors;
+}
+
+void WriteCoalescer::setMinInterval(uint16_t intervalMs) {
+    minIntervalMs = intervalMs;
+}
+
+void WriteCoalescer::stage(const SystemSettings& settings, uint8_t keys) {
+    if (!keys) return;
+    
+    portENTER_CRITICAL(&lock);
+    stats.staged += countKeys(keys);
+    stats.dropped += countKeys(keys & dirtyKeys);
+    if (keys & COALESCE_GEOMETRY) {
+        pending.pan = settings.pan;
+        pending.tilt = settings.tilt;
+        pending.flip = settings.flip;
+    }
+    if (keys & COALESCE_BRIGHTNESS) pending.brightness = settings.brightness;
+    if (keys & COALESCE_CONTRAST) pending.contrast = settings.contrast;
+    if (keys & COALESCE_HUE) {
+        pending.hueU = settings.hueU;
+        pending.hueV = settings.hueV;
+    }
+    if (keys & COALESCE_SATURATION) {
+        pending.satU = settings.satU;
+        pending.satV = settings.satV;
+    }
+    if (keys & COALESCE_SHARPNESS) pending.sharpness = settings.sharpness;
+    dirtyKeys |= keys;
+    portEXIT_CRITICAL(&lock);
+    
+    // EEPROM 只更新缓存，稳定后由 process() 统一提交
+    if (eepromMgr) eepromMgr->stageSettings(settings);
+}
+
+void WriteCoalescer::cancel(uint8_t keys) {
+    portENTER_CRITICAL(&lock);
+    stats.dropped += countKeys(keys & dirtyKeys);
+    dirtyKeys &= ~keys;
+    portEXIT_CRITICAL(&lock);
+}
+
+void WriteCoalescer::process() {
+    if (eepromMgr) eepromMgr->commitIfIdle(EEPROM_COMMIT_DELAY_MS);
+    
+    if (!dirtyKeys || !i2cComm) return;
+    if (millis() - lastFlush < minIntervalMs) return;
+    
+    portENTER_CRITICAL(&lock);
+    uint8_t keys = dirtyKeys;
+    SystemSettings snapshot = pending;
+    dirtyKeys = 0;
+    stats.flushes++;
+    portEXIT_CRITICAL(&lock);
+    lastFlush = millis();
+    
+    uint8_t failedKeys = 0;
+    if ((keys & COALESCE_GEOMETRY) &&
+        !i2cComm->sendKeystoneAndFlip(snapshot.pan, snapshot.tilt, snapshot.flip)) {
+        failedKeys |= COALESCE_GEOMETRY;
+    }
+    if (keys & COALESCE_PQ_MASK) {
+        // 0x41 一帧携带全部画质字段，未改动的字段取当前值
+        SystemSettings pq = eepromMgr ? eepromMgr->getSettings() : snapshot;
+        if (keys & COALESCE_BRIGHTNESS) pq.brightness = snapshot.brightness;
+        if (keys & COALESCE_CONTRAST) pq.contrast = snapshot.contrast;
+        if (keys & COALESCE_HUE) { pq.hueU = snapshot.hueU; pq.hueV = snapshot.hueV; }
+        if (keys & COALESCE_SATURATION) { pq.satU = snapshot.satU; pq.satV = snapshot.satV; }
+        if (keys & COALESCE_SHARPNESS) pq.sharpness = snapshot.sharpness;
+        bool queued = projectors ? projectors->sendPictureQuality(pq) == projectors->count()
+                                 : i2cComm->sendPictureQuality(pq);
+        if (!queued) failedKeys |= keys & COALESCE_PQ_MASK;
+    }
+    
+    // 未能入队的键重新标记，下一批再发；期间有新值时直接发新值
+    portENTER_CRITICAL(&lock);
+    stats.sent += countKeys(keys & ~failedKeys);
+    stats.failed += countKeys(failedKeys);
+    dirtyKeys |= failedKeys;
+    portEXIT_CRITICAL(&lock);
+}
+
+CoalesceStats WriteCoalescer::getStats() const {
+    return stats;
+}
+
+void WriteCoalescer::resetStats() {
+    portENTER_CRITICAL(&lock);
+    stats = CoalesceStats();
+    portEXIT_CRITICAL(&lock);
+}
@@ -0,0 +1,67 @@
+#ifndef WRITE_COALESCER_H
+#define WRITE_COALESCER_H
+
+#include <Arduino.h>
+#include "eeprom_manager.h"
+#include "i2c_communicator.h"
+#include "projector_registry.h"
+
+// 合并键：同一键上未下发的旧值会被新值覆盖
+enum CoalesceKey : uint8_t {
+    COALESCE_GEOMETRY   = 1 << 0,   // pan/tilt/flip（0x26 一帧）
+    COALESCE_BRIGHTNESS = 1 << 1,
+    COALESCE_CONTRAST   = 1 << 2,
+    COALESCE_HUE        = 1 << 3,   // hue U/V
+    COALESCE_SATURATION = 1 << 4,   // sat U/V
+    COALESCE_SHARPNESS  = 1 << 5,
+    COALESCE_PQ_MASK    = COALESCE_BRIGHTNESS | COALESCE_CONTRAST | COALESCE_HUE |
+                          COALESCE_SATURATION | COALESCE_SHARPNESS
+};
+
+// 合并统计
+struct CoalesceStats {
+    uint32_t staged;     // 收到的参数写入次数（按键计）
+    uint32_t sent;       // 实际下发到总线的次数（按键计）
+    uint32_t dropped;    // 未下发即被新值覆盖的次数
+    uint32_t failed;     // 总线队列已满、未能入队的次数（按键计，之后重新下发）
+    uint32_t flushes;    // 总线下发批次
+};
+
+class WriteCoalescer {
+public:
+    WriteCoalescer();
+    
+    // 设置依赖模块；给出 projectors 时画质下发到所有模块，几何仍只写主模块
+    void begin(I2CCommunicator* i2c, EEPROMManager* eeprom, ProjectorRegistry* projectors = nullptr);
+    
+    // 设置两次总线下发之间的最小间隔（即最大下发速率）
+    void setMinInterval(uint16_t intervalMs);
+    uint16_t getMinInterval() const { return minIntervalMs; }
+    
+    // 暂存新设置；keys 为本次改动的 CoalesceKey 组合（供HTTP处理函数调用）
+    void stage(const SystemSettings& settings, uint8_t keys);
+    
+    // 丢弃 keys 上尚未下发的值（调用者已直接写入模块，避免之后被旧值覆盖）
+    void cancel(uint8_t keys);
+    
+    // 按速率下发待写入的值，并在设置稳定后提交 EEPROM（在loop中调用）
+    void process();
+    
+    // 获取/清零统计
+    CoalesceStats getStats() const;
+    void resetStats();
+    
+private:
+    I2CCommunicator* i2cComm;
+    EEPROMManager* eepromMgr;
+    ProjectorRegistry* projectors;
+    uint16_t minIntervalMs;
+    unsigned long lastFlush;
+    
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    SystemSettings pending;
+    uint8_t dirtyKeys;
+    CoalesceStats stats;
+};
+
+#endif // WRITE_COALESCER_H